@@ -54,6 +54,13 @@ struct AbstractBound {
   // tracking storage -- it's only implemented for the bounds
   // representations we really care about.
   virtual int getStorage(int whichMetric) const { return 0; }
+
+  // returns true if the bound's value at a node depends only on values
+  // stored in the node, so it can change only when the node itself is
+  // backed up.  true for point bounds; false for representations like
+  // maxPlanes and sawtooth, where a backup anywhere can change the value
+  // at other nodes.
+  virtual bool isNodeLocal(void) const { return false; }
 };
 
 }; // namespace zmdp
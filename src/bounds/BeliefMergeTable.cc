@@ -0,0 +1,145 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    BeliefMergeTable.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "zmdpCommonDefs.h"
+#include "MatrixUtils.h"
+#include "BeliefMergeTable.h"
+
+using namespace std;
+using namespace MatrixUtils;
+
+namespace zmdp {
+
+/**********************************************************************
+ * LOCAL HELPER FUNCTIONS
+ **********************************************************************/
+
+// returns the L1 distance between x and y
+static double getL1Distance(const cvector& x, const cvector& y)
+{
+  double result = 0.0;
+  typeof(x.data.begin()) xi = x.data.begin(), xend = x.data.end();
+  typeof(y.data.begin()) yi = y.data.begin(), yend = y.data.end();
+  while (xi != xend || yi != yend) {
+    if (yi == yend || (xi != xend && xi->index < yi->index)) {
+      result += fabs(xi->value);
+      xi++;
+    } else if (xi == xend || yi->index < xi->index) {
+      result += fabs(yi->value);
+      yi++;
+    } else {
+      result += fabs(xi->value - yi->value);
+      xi++;
+      yi++;
+    }
+  }
+  return result;
+}
+
+/**********************************************************************
+ * BELIEF MERGE TABLE
+ **********************************************************************/
+
+BeliefMergeTable::BeliefMergeTable(double _radius, int _numTables) :
+  radius(_radius),
+  numTables(_numTables),
+  cellWidth(4 * _radius),
+  numLookups(0),
+  numMerges(0),
+  mergeDistanceSum(0.0)
+{
+  assert(radius > 0 && numTables >= 1);
+  tables.resize(numTables);
+}
+
+// the key lists the grid cell of each entry of s.  table t's grid is
+// offset by t/numTables of a cell.  entries that fall in cell 0 are
+// omitted, so a small entry matches a missing one.
+void BeliefMergeTable::getKey(std::string& key, const state_vector& s, int t) const
+{
+  double offset = cellWidth * t / numTables;
+  key.clear();
+  FOR_CV (s) {
+    int cell = (int) floor((CV_VAL(s) + offset) / cellWidth);
+    if (0 != cell) {
+      int entry[2];
+      entry[0] = CV_INDEX(s);
+      entry[1] = cell;
+      key.append((const char*) entry, sizeof(entry));
+    }
+  }
+}
+
+void BeliefMergeTable::addNode(MDPNode* cn)
+{
+  std::string key;
+  FOR (t, numTables) {
+    getKey(key, cn->s, t);
+    tables[t][key].push_back(cn);
+  }
+}
+
+MDPNode* BeliefMergeTable::findNear(const state_vector& s, double& distance)
+{
+  MDPNode* best = NULL;
+  double bestDistance = radius;
+  std::string key;
+
+  numLookups++;
+  FOR (t, numTables) {
+    getKey(key, s, t);
+    BucketMap::const_iterator bucket = tables[t].find(key);
+    if (tables[t].end() == bucket) continue;
+    FOR_EACH (ni, bucket->second) {
+      double d = getL1Distance(s, (*ni)->s);
+      if (d <= bestDistance) {
+	best = *ni;
+	bestDistance = d;
+      }
+    }
+  }
+
+  if (NULL != best) {
+    distance = bestDistance;
+    numMerges++;
+    mergeDistanceSum += bestDistance;
+  }
+  return best;
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,74 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    BeliefMergeTable.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCBeliefMergeTable_h
+#define INCBeliefMergeTable_h
+
+#include <string>
+#include <vector>
+
+#include "zmdpCommonTypes.h"
+#include "MDPCache.h"
+
+namespace zmdp {
+
+// an index of search graph nodes that finds an existing node whose state
+// is close to a query state in L1 distance, used to merge nearly
+// identical beliefs (see beliefMergeRadius in zmdp.config).  it uses
+// locality-sensitive hashing: each of several tables quantizes the
+// state entries on a grid of width 4*radius, with the grids of
+// different tables offset from one another.  states within the radius
+// usually share a cell in at least one table.  the search is
+// approximate; a near node may be missed, but any node returned is
+// within the radius.
+struct BeliefMergeTable {
+  double radius;
+  int numTables;
+  double cellWidth;
+  int numLookups;
+  int numMerges;
+  double mergeDistanceSum;
+
+  BeliefMergeTable(double _radius, int _numTables);
+
+  void addNode(MDPNode* cn);
+  // returns the closest indexed node within radius of s, or NULL if none
+  // was found.  if a node is returned, distance is set to its L1
+  // distance from s.
+  MDPNode* findNear(const state_vector& s, double& distance);
+
+protected:
+  typedef EXT_NAMESPACE::hash_map<std::string, std::vector<MDPNode*> > BucketMap;
+  std::vector<BucketMap> tables;
+
+  void getKey(std::string& key, const state_vector& s, int t) const;
+};
+
+}; // namespace zmdp
+
+#endif // INCBeliefMergeTable_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
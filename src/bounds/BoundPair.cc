@@ -36,6 +36,7 @@
 #include "AbstractBound.h"
 #include "BoundPair.h"
 #include "MaxPlanesLowerBound.h"
+#include "SawtoothUpperBound.h"
 
 #define BP_INITIALIZATION_PRECISION_FACTOR (1e-2)
 
@@ -45,6 +46,82 @@ using namespace MatrixUtils;
 
 namespace zmdp {
 
+/**********************************************************************
+ * LOCAL HELPER FUNCTIONS
+ **********************************************************************/
+
+// returns true if the successor bounds that Qa depends on may have
+// changed since Qa was last computed
+static bool getQEntryIsDirty(const MDPQEntry& Qa)
+{
+  bool hasOutcome = false;
+  FOR (o, Qa.getNumOutcomes()) {
+    const MDPEdge* e = Qa.outcomes[o];
+    if (NULL != e) {
+      if (e->seenBoundsVersion != e->nextState->boundsVersion) return true;
+      hasOutcome = true;
+    }
+  }
+  // with no outcomes there is nothing to track, so always recompute
+  return !hasOutcome;
+}
+
+static bool getNodeIsDirty(const MDPNode& cn)
+{
+  FOR (a, cn.getNumActions()) {
+    if (getQEntryIsDirty(cn.Q[a])) return true;
+  }
+  return false;
+}
+
+static void markSuccessorsSeen(MDPNode& cn)
+{
+  FOR (a, cn.getNumActions()) {
+    MDPQEntry& Qa = cn.Q[a];
+    FOR (o, Qa.getNumOutcomes()) {
+      MDPEdge* e = Qa.outcomes[o];
+      if (NULL != e) {
+	e->seenBoundsVersion = e->nextState->boundsVersion;
+      }
+    }
+  }
+}
+
+// records the current version of each successor of cn, in edge order.
+// used when a backup is computed before it is applied, so that the
+// versions it was computed from can be marked seen afterward.
+static void getSuccessorVersions(std::vector<int>& versions, const MDPNode& cn)
+{
+  versions.clear();
+  FOR (a, cn.getNumActions()) {
+    const MDPQEntry& Qa = cn.Q[a];
+    FOR (o, Qa.getNumOutcomes()) {
+      const MDPEdge* e = Qa.outcomes[o];
+      if (NULL != e) {
+	versions.push_back(e->nextState->boundsVersion);
+      }
+    }
+  }
+}
+
+static void markSuccessorsSeen(MDPNode& cn, const std::vector<int>& versions)
+{
+  int i = 0;
+  FOR (a, cn.getNumActions()) {
+    MDPQEntry& Qa = cn.Q[a];
+    FOR (o, Qa.getNumOutcomes()) {
+      MDPEdge* e = Qa.outcomes[o];
+      if (NULL != e) {
+	e->seenBoundsVersion = versions[i++];
+      }
+    }
+  }
+}
+
+/**********************************************************************
+ * BOUND PAIR
+ **********************************************************************/
+
 BoundPair::BoundPair(bool _maintainLowerBound,
 		     bool _maintainUpperBound,
 		     bool _useUpperBoundRunTimeActionSelection,
@@ -56,9 +133,27 @@ BoundPair::BoundPair(bool _maintainLowerBound,
   maintainLowerBound(_maintainLowerBound),
   maintainUpperBound(_maintainUpperBound),
   useUpperBoundRunTimeActionSelection(_useUpperBoundRunTimeActionSelection),
-  dualPointBounds(_dualPointBounds)
+  dualPointBounds(_dualPointBounds),
+  isSnapshot(false),
+  mergeTable(NULL)
 {}
 
+BoundPair::~BoundPair(void)
+{
+  if (NULL != threadPool) {
+    delete threadPool;
+    threadPool = NULL;
+  }
+  if (isSnapshot) {
+    delete lowerBound;
+    delete lookup;
+  }
+  if (NULL != mergeTable) {
+    delete mergeTable;
+    mergeTable = NULL;
+  }
+}
+
 void BoundPair::updateDualPointBounds(MDPNode& cn, int* maxUBActionP)
 {
   double lbVal, ubVal;
@@ -68,21 +163,29 @@ void BoundPair::updateDualPointBounds(MDPNode& cn, int* maxUBActionP)
 
   FOR (a, cn.getNumActions()) {
     MDPQEntry& Qa = cn.Q[a];
-    lbVal = 0;
-    ubVal = 0;
-    FOR (o, Qa.getNumOutcomes()) {
-      MDPEdge* e = Qa.outcomes[o];
-      if (NULL != e) {
-	MDPNode& sn = *e->nextState;
-	double oprob = e->obsProb;
-	lbVal += oprob * sn.lbVal;
-	ubVal += oprob * sn.ubVal;
+    if (useDirtyTracking && !getQEntryIsDirty(Qa)) {
+      // the successors haven't changed, so the cached values are current
+      lbVal = Qa.lbVal;
+      ubVal = Qa.ubVal;
+      numQBackupsSkipped++;
+    } else {
+      lbVal = 0;
+      ubVal = 0;
+      FOR (o, Qa.getNumOutcomes()) {
+	MDPEdge* e = Qa.outcomes[o];
+	if (NULL != e) {
+	  MDPNode& sn = *e->nextState;
+	  double oprob = e->obsProb;
+	  lbVal += oprob * (sn.lbVal - e->approximationError);
+	  ubVal += oprob * (sn.ubVal + e->approximationError);
+	}
       }
+      lbVal = Qa.immediateReward + problem->getDiscount() * lbVal;
+      ubVal = Qa.immediateReward + problem->getDiscount() * ubVal;
+      Qa.lbVal = lbVal;
+      Qa.ubVal = ubVal;
+      numQBackups++;
     }
-    lbVal = Qa.immediateReward + problem->getDiscount() * lbVal;
-    ubVal = Qa.immediateReward + problem->getDiscount() * ubVal;
-    Qa.lbVal = lbVal;
-    Qa.ubVal = ubVal;
 
     maxLBVal = std::max(maxLBVal, lbVal);
     if (ubVal > maxUBVal) {
@@ -118,9 +221,45 @@ void BoundPair::initialize(MDP* _problem,
   lookup = new MDPHash();
   root = NULL;
 
+  int nodeExpansionThreads = config->getInt("nodeExpansionThreads");
+  if (nodeExpansionThreads <= 0) {
+    nodeExpansionThreads = ThreadPool::getNumProcessors();
+  }
+  if (nodeExpansionThreads > 1 && NULL == threadPool) {
+    threadPool = new ThreadPool(nodeExpansionThreads);
+  }
+
   numStatesTouched = 0;
   numStatesExpanded = 0;
   numBackups = 0;
+  numBackupsSkipped = 0;
+  numQBackups = 0;
+  numQBackupsSkipped = 0;
+
+  // dirty tracking is exact only if the bounds at a node change just
+  // when the node is backed up.  mode 2 also applies it to other bounds,
+  // in which case improvements that reach a node through backups
+  // elsewhere are picked up later than they would be otherwise.
+  int dirtyTrackingMode = config->getInt("useDirtyTracking");
+  bool boundsAreNodeLocal =
+    (!maintainLowerBound || lowerBound->isNodeLocal())
+    && (!maintainUpperBound || upperBound->isNodeLocal());
+  useDirtyTracking = (dirtyTrackingMode >= 2)
+    || (1 == dirtyTrackingMode && boundsAreNodeLocal);
+  numSuccessorsGenerated = 0;
+  numSuccessorsTruncated = 0;
+  truncatedMassSum = 0.0;
+  maxTruncatedMass = 0.0;
+
+  double beliefMergeRadius = config->getDouble("beliefMergeRadius");
+  if (beliefMergeRadius > 0 && NULL == mergeTable) {
+    if (problem->getValueRange() <= 0) {
+      fprintf(stderr, "ERROR: beliefMergeRadius is only supported for POMDP models with discount < 1\n");
+      exit(EXIT_FAILURE);
+    }
+    mergeTable = new BeliefMergeTable(beliefMergeRadius,
+				      config->getInt("beliefMergeNumTables"));
+  }
 }
 
 MDPNode* BoundPair::getRootNode(void)
@@ -154,6 +293,9 @@ MDPNode* BoundPair::getNode(const state_vector& s)
       cn.lbVal = -1; // n/a
     }
     (*lookup)[hs] = &cn;
+    if (NULL != mergeTable) {
+      mergeTable->addNode(&cn);
+    }
 
     FOR_EACH (hstructP, getNodeHandlers) {
       (*hstructP->h)(cn, hstructP->hdata);
@@ -177,16 +319,140 @@ MDPNode* BoundPair::getNodeOrNull(const state_vector& s) const
   }
 }
 
+// returns the node for successor state s of edge e.  if belief merging is
+// enabled and s is not already in the search graph, an existing node
+// close to s may be returned instead, in which case e.approximationError
+// is increased to account for the difference.
+MDPNode* BoundPair::getSuccessorNode(const state_vector& s, MDPEdge& e)
+{
+  if (NULL != mergeTable) {
+    MDPNode* cn = getNodeOrNull(s);
+    if (NULL != cn) return cn;
+
+    double distance;
+    cn = mergeTable->findNear(s, distance);
+    if (NULL != cn) {
+      // for beliefs b and c and any alpha vector, |alpha.(b-c)| is at
+      // most |b-c|_1 times half the range of alpha's entries
+      e.approximationError += 0.5 * distance * problem->getValueRange();
+      return cn;
+    }
+  }
+  return getNode(s);
+}
+
+// per-action successor information generated in parallel by expandParallel()
+struct BPExpandAction {
+  double immediateReward;
+  outcome_prob_vector opv;
+  std::vector<state_vector> nextStates;
+  std::vector<double> truncatedMass;
+};
+
+struct BPExpandData {
+  MDP* problem;
+  const MDPNode* cn;
+  std::vector<BPExpandAction> actions;
+};
+
+static void bpExpandActionTask(void* taskData, int a)
+{
+  BPExpandData& x = *((BPExpandData*) taskData);
+  BPExpandAction& xa = x.actions[a];
+  // each task has its own workspace, so work is shared between the
+  // outcomes of an action but not between actions
+  MDPWorkspace ws;
+  ws.beginCaching(x.cn->s);
+  xa.immediateReward = x.problem->getReward(x.cn->s, a);
+  x.problem->getOutcomeProbVector(xa.opv, x.cn->s, a, ws);
+  xa.nextStates.resize(xa.opv.size());
+  xa.truncatedMass.resize(xa.opv.size());
+  FOR (o, xa.opv.size()) {
+    if (xa.opv(o) > OBS_IS_ZERO_EPS) {
+      x.problem->getNextState(xa.nextStates[o], x.cn->s, a, o, ws);
+      xa.truncatedMass[o] = x.problem->truncateState(xa.nextStates[o]);
+    }
+  }
+  ws.endCaching();
+}
+
+// generates the successor states of cn for each action, in parallel if
+// there is a thread pool.  only reads the model and cn.s.
+void BoundPair::getSuccessorStates(BPExpandData& x, const MDPNode& cn)
+{
+  int numActions = problem->getNumActions();
+  x.problem = problem;
+  x.cn = &cn;
+  x.actions.resize(numActions);
+  if (NULL != threadPool) {
+    threadPool->run(numActions, &bpExpandActionTask, &x);
+  } else {
+    FOR (a, numActions) {
+      bpExpandActionTask(&x, a);
+    }
+  }
+}
+
+// links fringe node cn to the successors generated by
+// getSuccessorStates().  node lookup and initialization of new nodes
+// modify shared data structures, so this is done serially and in the
+// same (a,o) order as expand().
+void BoundPair::addSuccessors(MDPNode& cn, BPExpandData& x)
+{
+  int numActions = problem->getNumActions();
+  cn.Q.resize(numActions);
+  FOR (a, numActions) {
+    MDPQEntry& Qa = cn.Q[a];
+    BPExpandAction& xa = x.actions[a];
+    Qa.immediateReward = xa.immediateReward;
+    Qa.outcomes.resize(xa.opv.size());
+    FOR (o, xa.opv.size()) {
+      double oprob = xa.opv(o);
+      if (oprob > OBS_IS_ZERO_EPS) {
+	MDPEdge* e = new MDPEdge();
+	Qa.outcomes[o] = e;
+	e->obsProb = oprob;
+	recordTruncation(xa.truncatedMass[o]);
+	e->approximationError = xa.truncatedMass[o] * problem->getValueRange();
+	e->nextState = getSuccessorNode(xa.nextStates[o], *e);
+      } else {
+	Qa.outcomes[o] = NULL;
+      }
+    }
+    Qa.ubVal = BP_QVAL_UNDEFINED;
+  }
+  numStatesExpanded++;
+}
+
+// same result as expand(), but the successor states for each action are
+// generated in parallel.
+void BoundPair::expandParallel(MDPNode& cn)
+{
+  BPExpandData x;
+  getSuccessorStates(x, cn);
+  addSuccessors(cn, x);
+}
+
 void BoundPair::expand(MDPNode& cn)
 {
-  // set up successors for this fringe node (possibly creating new fringe nodes)
+  if (NULL != threadPool) {
+    expandParallel(cn);
+    return;
+  }
+
+  // set up successors for this fringe node (possibly creating new fringe nodes).
+  // cn.s is not modified during expansion, so the model may cache
+  // intermediate results (such as T_a' * b for a POMDP) in ws and reuse
+  // them across actions and outcomes.
   outcome_prob_vector opv;
   state_vector sp;
+  MDPWorkspace ws;
+  ws.beginCaching(cn.s);
   cn.Q.resize(problem->getNumActions());
   FOR (a, problem->getNumActions()) {
     MDPQEntry& Qa = cn.Q[a];
     Qa.immediateReward = problem->getReward(cn.s, a);
-    problem->getOutcomeProbVector(opv, cn.s, a);
+    problem->getOutcomeProbVector(opv, cn.s, a, ws);
     Qa.outcomes.resize(opv.size());
     FOR (o, opv.size()) {
       double oprob = opv(o);
@@ -194,21 +460,46 @@ void BoundPair::expand(MDPNode& cn)
 	MDPEdge* e = new MDPEdge();
         Qa.outcomes[o] = e;
         e->obsProb = oprob;
-        e->nextState = getNode(problem->getNextState(sp, cn.s, a, o));
+        problem->getNextState(sp, cn.s, a, o, ws);
+        double truncatedMass = problem->truncateState(sp);
+        recordTruncation(truncatedMass);
+        e->approximationError = truncatedMass * problem->getValueRange();
+        e->nextState = getSuccessorNode(sp, *e);
       } else {
         Qa.outcomes[o] = NULL;
       }
     }
     Qa.ubVal = BP_QVAL_UNDEFINED;
   }
+  ws.endCaching();
   numStatesExpanded++;
 }
 
 void BoundPair::update(MDPNode& cn, int* maxUBActionP)
 {
+  if (NULL != sharedLock) {
+    updateShared(cn, maxUBActionP);
+    return;
+  }
+
   if (cn.isFringe()) {
     expand(cn);
   }
+
+  if (useDirtyTracking && !getNodeIsDirty(cn)) {
+    // no successor has changed since cn was last backed up, so a backup
+    // would reproduce the current values
+    // (skipped backups still count toward numBackups, so that
+    // terminateNumBackups and the bounds log behave as without tracking)
+    numBackupsSkipped++;
+    numQBackupsSkipped += cn.getNumActions();
+    numBackups++;
+    if (NULL != maxUBActionP) *maxUBActionP = getMaxUBAction(cn);
+    return;
+  }
+
+  double oldLBVal = cn.lbVal;
+  double oldUBVal = cn.ubVal;
   if (dualPointBounds) {
     // updateDualPointBounds is an optimized procedure that only works if both lower
     // and upper bound are point bounds
@@ -222,11 +513,91 @@ void BoundPair::update(MDPNode& cn, int* maxUBActionP)
     if (maintainUpperBound) {
       upperBound->update(cn, maxUBActionP);
     }
+    numQBackups += cn.getNumActions();
   }
 
+  if (useDirtyTracking) {
+    markSuccessorsSeen(cn);
+  }
+  if (cn.lbVal != oldLBVal || cn.ubVal != oldUBVal) {
+    cn.boundsVersion++;
+    noteNodeChange(cn);
+  }
   numBackups++;
 }
 
+// same result as update(), for use when sharedLock is set.  the caller
+// holds the read lock.  the successor states and the new bounds are
+// computed under the read lock, concurrently with other threads, and
+// the write lock is held only while they are added to the graph and the
+// bound representations.
+void BoundPair::updateShared(MDPNode& cn, int* maxUBActionP)
+{
+  if (cn.isFringe()) {
+    BPExpandData x;
+    getSuccessorStates(x, cn);
+    beginExclusive();
+    // another thread may have expanded cn while we were working
+    if (cn.isFringe()) {
+      addSuccessors(cn, x);
+    }
+    endExclusive();
+  }
+
+  if (useDirtyTracking && !getNodeIsDirty(cn)) {
+    // other threads may be skipping backups at the same time
+    __atomic_fetch_add(&numBackupsSkipped, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&numQBackupsSkipped, cn.getNumActions(), __ATOMIC_RELAXED);
+    __atomic_fetch_add(&numBackups, 1, __ATOMIC_RELAXED);
+    if (NULL != maxUBActionP) *maxUBActionP = getMaxUBAction(cn);
+    return;
+  }
+
+  // point bounds are cheap to update, so dualPointBounds does all of its
+  // work under the write lock
+  std::vector<int> seenVersions;
+  void* lbBackup = NULL;
+  void* ubBackup = NULL;
+  if (!dualPointBounds) {
+    if (useDirtyTracking) {
+      getSuccessorVersions(seenVersions, cn);
+    }
+    if (maintainLowerBound) {
+      lbBackup = lowerBound->getBackup(cn);
+    }
+    if (maintainUpperBound) {
+      ubBackup = upperBound->getBackup(cn);
+    }
+  }
+
+  beginExclusive();
+  double oldLBVal = cn.lbVal;
+  double oldUBVal = cn.ubVal;
+  if (dualPointBounds) {
+    updateDualPointBounds(cn, maxUBActionP);
+    if (useDirtyTracking) {
+      markSuccessorsSeen(cn);
+    }
+  } else {
+    if (maintainLowerBound) {
+      lowerBound->setBackup(cn, lbBackup);
+    }
+    if (maintainUpperBound) {
+      upperBound->setBackup(cn, ubBackup, maxUBActionP);
+    }
+    numQBackups += cn.getNumActions();
+    if (useDirtyTracking) {
+      markSuccessorsSeen(cn, seenVersions);
+    }
+  }
+  if (cn.lbVal != oldLBVal || cn.ubVal != oldUBVal) {
+    cn.boundsVersion++;
+    noteNodeChange(cn);
+  }
+  numBackups++;
+  endExclusive();
+}
+
 // this implementation is not very efficient, but it is guaranteed not
 // to modify the algorithm state, so it can safely be used for
 // simulation testing in the middle of a run.
@@ -337,6 +708,56 @@ void BoundPair::writePolicy(const std::string& outFileName, bool canModifyBounds
   mlb->writeToFile(outFileName);
 }
 
+void BoundPair::writeUpperBound(const std::string& outFileName, bool canModifyBounds)
+{
+  SawtoothUpperBound* sub = (SawtoothUpperBound*) upperBound;
+  if (canModifyBounds) {
+    sub->prune(numBackups);
+  }
+  sub->writeToFile(outFileName);
+}
+
+void BoundPair::printApproximationStats(void) const
+{
+  BoundPairCore::printApproximationStats();
+  if (NULL != mergeTable && mergeTable->numMerges > 0) {
+    printf("belief merging: merged %d of %d new successor beliefs into existing nodes, mean L1 distance %g\n",
+	   mergeTable->numMerges, mergeTable->numLookups,
+	   mergeTable->mergeDistanceSum / mergeTable->numMerges);
+  }
+}
+
+// only the lower bound is copied, since it is what chooseAction() uses
+// unless useUpperBoundRunTimeActionSelection is set.  the copy has an
+// empty node lookup table, which makes no difference to the policy.
+BoundPair* BoundPair::newPolicySnapshot(void) const
+{
+  if (!maintainLowerBound || useUpperBoundRunTimeActionSelection) {
+    return NULL;
+  }
+  IncrementalLowerBound* lbSnapshot = lowerBound->newSnapshot();
+  if (NULL == lbSnapshot) {
+    return NULL;
+  }
+
+  BoundPair* result = new BoundPair(/* maintainLowerBound = */ true,
+				    /* maintainUpperBound = */ false,
+				    /* useUpperBoundRunTimeActionSelection = */ false,
+				    /* dualPointBounds = */ false);
+  result->problem = problem;
+  result->config = config;
+  result->targetPrecision = targetPrecision;
+  result->lowerBound = lbSnapshot;
+  result->lookup = new MDPHash();
+  result->root = NULL;
+  result->numStatesTouched = 0;
+  result->numStatesExpanded = 0;
+  result->numBackups = numBackups;
+  result->isSnapshot = true;
+
+  return result;
+}
+
 }; // namespace zmdp
 
 /***************************************************************************
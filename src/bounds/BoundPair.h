@@ -30,11 +30,14 @@
 #include "BoundPairCore.h"
 #include "IncrementalLowerBound.h"
 #include "IncrementalUpperBound.h"
+#include "BeliefMergeTable.h"
 
 using namespace sla;
 
 namespace zmdp {
 
+struct BPExpandData;
+
 struct BoundPair : public BoundPairCore {
   MDP* problem;
   const ZMDPConfig* config;
@@ -45,11 +48,18 @@ struct BoundPair : public BoundPairCore {
   bool useUpperBoundRunTimeActionSelection;
   bool dualPointBounds;
   double targetPrecision;
+  // true if this is a copy made by newPolicySnapshot(), which owns its
+  // lower bound
+  bool isSnapshot;
+  // if non-NULL, used to merge nearly identical successor beliefs (see
+  // beliefMergeRadius in zmdp.config)
+  BeliefMergeTable* mergeTable;
 
   BoundPair(bool _maintainLowerBound,
 	    bool _maintainUpperBound,
 	    bool _useUpperBoundRunTimeActionSelection,
 	    bool _dualPointBounds);
+  ~BoundPair(void);
 
   void updateDualPointBounds(MDPNode& cn, int* maxUBActionP);
 
@@ -59,12 +69,26 @@ struct BoundPair : public BoundPairCore {
   MDPNode* getRootNode(void);
   MDPNode* getNode(const state_vector& s);
   MDPNode* getNodeOrNull(const state_vector& s) const;
+  MDPNode* getSuccessorNode(const state_vector& s, MDPEdge& e);
+  void getSuccessorStates(BPExpandData& x, const MDPNode& cn);
+  void addSuccessors(MDPNode& cn, BPExpandData& x);
   void expand(MDPNode& cn);
+  void expandParallel(MDPNode& cn);
   void update(MDPNode& cn, int* maxUBActionP);
+  void updateShared(MDPNode& cn, int* maxUBActionP);
   int chooseAction(const state_vector& s) const;
   ValueInterval getValueAt(const state_vector& s) const;
   ValueInterval getQValue(const state_vector& s, int a) const;
   void writePolicy(const std::string& outFileName, bool canModifyBounds);
+  void writeUpperBound(const std::string& outFileName, bool canModifyBounds);
+
+  // returns a newly allocated copy of the current policy that can be
+  // executed and written out while this BoundPair continues to be
+  // updated, or NULL if the bounds don't support it.  the copy supports
+  // chooseAction(), getValueAt() and writePolicy().
+  BoundPair* newPolicySnapshot(void) const;
+
+  void printApproximationStats(void) const;
 };
 
 }; // namespace zmdp
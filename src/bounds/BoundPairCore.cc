@@ -47,6 +47,70 @@ void BoundPairCore::addGetNodeHandler(GetNodeHandler getNodeHandler, void* handl
   getNodeHandlers.push_back(GetNodeHandlerStruct(getNodeHandler, handlerData));
 }
 
+void BoundPairCore::setRootChangeHandler(RootChangeHandler handler, void* handlerData)
+{
+  rootChangeHandler = handler;
+  rootChangeHandlerData = handlerData;
+}
+
+// the read lock is released before the write lock is requested, so
+// another thread may modify the graph in between.  callers must
+// re-check anything they decided under the read lock.
+void BoundPairCore::beginExclusive(void)
+{
+  if (NULL == sharedLock) return;
+  pthread_rwlock_unlock(sharedLock);
+  pthread_rwlock_wrlock(sharedLock);
+}
+
+void BoundPairCore::endExclusive(void)
+{
+  if (NULL == sharedLock) return;
+  pthread_rwlock_unlock(sharedLock);
+  pthread_rwlock_rdlock(sharedLock);
+}
+
+void BoundPairCore::setNodeUBVal(MDPNode& cn, double val)
+{
+  beginExclusive();
+  cn.setUBVal(val);
+  noteNodeChange(cn);
+  endExclusive();
+}
+
+void BoundPairCore::noteNodeChange(MDPNode& cn)
+{
+  if (&cn == root && NULL != rootChangeHandler) {
+    (*rootChangeHandler)(cn, rootChangeHandlerData);
+  }
+}
+
+void BoundPairCore::recordTruncation(double truncatedMass)
+{
+  numSuccessorsGenerated++;
+  if (truncatedMass > 0) {
+    numSuccessorsTruncated++;
+    truncatedMassSum += truncatedMass;
+    maxTruncatedMass = std::max(maxTruncatedMass, truncatedMass);
+  }
+}
+
+void BoundPairCore::printApproximationStats(void) const
+{
+  if (0 == numSuccessorsTruncated) return;
+  printf("belief truncation: truncated %d of %d successor beliefs, removed mass mean %g max %g\n",
+	 numSuccessorsTruncated, numSuccessorsGenerated,
+	 truncatedMassSum / numSuccessorsTruncated, maxTruncatedMass);
+}
+
+void BoundPairCore::printDirtyTrackingStats(void) const
+{
+  if (!useDirtyTracking) return;
+  printf("dirty tracking: skipped %d of %d backups and %d of %d Q value computations\n",
+	 numBackupsSkipped, numBackups,
+	 numQBackupsSkipped, numQBackupsSkipped + numQBackups);
+}
+
 // relies on correct cached Q values!
 int BoundPairCore::getMaxUBAction(MDPNode& cn)
 {
@@ -62,9 +126,9 @@ int BoundPairCore::getMaxUBAction(MDPNode& cn)
   return bestAction;
 }
 
-int BoundPairCore::getSimulatedOutcome(MDPNode& cn, int a)
+int BoundPairCore::getSimulatedOutcome(MDPNode& cn, int a, RandomStream& rng)
 {
-  double r = unit_rand();
+  double r = rng.unitRand();
   int result = 0;
   MDPQEntry& Qa = cn.Q[a];
   FOR (o, Qa.getNumOutcomes()) {
@@ -29,6 +29,8 @@
 
 #include "MDPCache.h"
 #include "MDPModel.h"
+#include "ThreadPool.h"
+#include "zmdpRandom.h"
 
 #define BP_QVAL_UNDEFINED (-99e+20)
 
@@ -44,15 +46,58 @@ struct GetNodeHandlerStruct {
   GetNodeHandlerStruct(GetNodeHandler _h, void* _hdata) : h(_h), hdata(_hdata) {}
 };
 
+// called after the bounds at the root node change
+typedef void (*RootChangeHandler)(MDPNode& root, void* callbackData);
+
 struct BoundPairCore {
   int numStatesTouched;
   int numStatesExpanded;
   int numBackups;
+  // belief truncation statistics
+  int numSuccessorsGenerated;
+  int numSuccessorsTruncated;
+  double truncatedMassSum;
+  double maxTruncatedMass;
+  // dirty tracking (see useDirtyTracking in zmdp.config): if enabled,
+  // update() skips the Q value computations, or entire backups, whose
+  // successors have not changed since they were last computed
+  bool useDirtyTracking;
+  int numBackupsSkipped;
+  int numQBackups;
+  int numQBackupsSkipped;
   std::vector<GetNodeHandlerStruct> getNodeHandlers;
 
   MDPNode* root;
   MDPHash* lookup;
 
+  // if non-NULL, used to parallelize work within a single node
+  // expansion or backup (see nodeExpansionThreads in zmdp.config)
+  ThreadPool* threadPool;
+
+  // if non-NULL, several threads are searching the bounds at once (see
+  // Portfolio).  each of them holds sharedLock for reading while it
+  // searches, and trades it for the write lock whenever it modifies
+  // the search graph or the bound representations.  update() and
+  // setNodeUBVal() do this internally; callers must not write to nodes
+  // directly.  threadPool must be NULL in this mode.
+  pthread_rwlock_t* sharedLock;
+  RootChangeHandler rootChangeHandler;
+  void* rootChangeHandlerData;
+
+  BoundPairCore(void) :
+    numSuccessorsGenerated(0),
+    numSuccessorsTruncated(0),
+    truncatedMassSum(0.0),
+    maxTruncatedMass(0.0),
+    useDirtyTracking(false),
+    numBackupsSkipped(0),
+    numQBackups(0),
+    numQBackupsSkipped(0),
+    threadPool(NULL),
+    sharedLock(NULL),
+    rootChangeHandler(NULL),
+    rootChangeHandlerData(NULL)
+  {}
   virtual ~BoundPairCore(void) {}
 
   virtual void initialize(MDP* _problem,
@@ -67,13 +112,35 @@ struct BoundPairCore {
   virtual ValueInterval getQValue(const state_vector& s, int a) const = 0;
 
   virtual void writePolicy(const std::string& outFileName, bool canModifyBounds) { assert(0); }
+  virtual void writeUpperBound(const std::string& outFileName, bool canModifyBounds) { assert(0); }
 
   void addGetNodeHandler(GetNodeHandler getNodeHandler, void* handlerData);
+  void setRootChangeHandler(RootChangeHandler handler, void* handlerData);
+
+  // if sharedLock is set, trade the caller's read lock for the write
+  // lock and back again; otherwise do nothing
+  void beginExclusive(void);
+  void endExclusive(void);
+  // sets cn.ubVal outside of update(), as LRTDP and HDP do when they
+  // manage the Q values themselves
+  void setNodeUBVal(MDPNode& cn, double val);
+  // calls the root change handler if cn is the root
+  void noteNodeChange(MDPNode& cn);
+
+  // records that a successor was generated and truncatedMass was
+  // removed from it by belief truncation
+  void recordTruncation(double truncatedMass);
+  // prints statistics on belief truncation and merging, if either
+  // occurred
+  virtual void printApproximationStats(void) const;
+  // prints how many backups dirty tracking skipped, if it was enabled
+  void printDirtyTrackingStats(void) const;
 
   // relies on correct cached Q values!
   static int getMaxUBAction(MDPNode& cn);
 
-  static int getSimulatedOutcome(MDPNode& cn, int a);
+  // draws an outcome of action a according to the cached obsProb values
+  static int getSimulatedOutcome(MDPNode& cn, int a, RandomStream& rng);
 };
 
 }; // namespace zmdp
@@ -37,11 +37,22 @@ namespace zmdp {
 struct IncrementalLowerBound : public AbstractBound {
   virtual void initNodeBound(MDPNode& cn) = 0;
   virtual void update(MDPNode& cn) = 0;
+  // together equivalent to update(cn), split so that the expensive part
+  // can run while other threads read the bound (see
+  // BoundPairCore::sharedLock).  getBackup() must not modify anything;
+  // it returns a newly allocated result that setBackup() applies and
+  // frees.  by default, all of the work is done in setBackup().
+  virtual void* getBackup(MDPNode& cn) { return NULL; }
+  virtual void setBackup(MDPNode& cn, void* backup) { update(cn); }
   virtual int chooseAction(const state_vector& s) {
     // signal to fall back to default implementation if derived class
     // does not implement chooseAction()
     return -1;
   }
+  // returns a newly allocated, read-only copy of the bound that can be
+  // queried with getValue() while this bound continues to change, or
+  // NULL if the derived class does not support snapshots
+  virtual IncrementalLowerBound* newSnapshot(void) const { return NULL; }
 };
 
 }; // namespace zmdp
@@ -37,6 +37,11 @@ namespace zmdp {
 struct IncrementalUpperBound : public AbstractBound {
   virtual void initNodeBound(MDPNode& cn) = 0;
   virtual void update(MDPNode& cn, int* maxUBActionP) = 0;
+  // see IncrementalLowerBound::getBackup()
+  virtual void* getBackup(MDPNode& cn) { return NULL; }
+  virtual void setBackup(MDPNode& cn, void* backup, int* maxUBActionP) {
+    update(cn, maxUBActionP);
+  }
 };
 
 }; // namespace zmdp
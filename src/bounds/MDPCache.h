@@ -40,6 +40,21 @@ struct MDPNode;
 struct MDPEdge {
   double obsProb;
   MDPNode* nextState;
+  // if nextState only approximates the true successor (because belief
+  // truncation or merging was applied), a bound on how far the value of
+  // the true successor can be from the value of nextState.  bounds must
+  // widen their backups by this amount to remain valid.
+  double approximationError;
+  // the boundsVersion of nextState when the edge's source was last
+  // backed up (-1 if it never was), used to skip redundant backups
+  int seenBoundsVersion;
+
+  MDPEdge(void) :
+    obsProb(0.0),
+    nextState(NULL),
+    approximationError(0.0),
+    seenBoundsVersion(-1)
+  {}
 };
 
 struct MDPQEntry {
@@ -59,6 +74,25 @@ struct MDPNode {
   //   strategy and value function representation
   void* searchData;
   void* boundsData;
+  // incremented whenever lbVal or ubVal changes
+  int boundsVersion;
+
+  MDPNode(void) : boundsVersion(0) {}
+
+  // use these rather than assigning lbVal or ubVal directly, so that
+  // boundsVersion is kept up to date
+  void setLBVal(double val) {
+    if (val != lbVal) {
+      lbVal = val;
+      boundsVersion++;
+    }
+  }
+  void setUBVal(double val) {
+    if (val != ubVal) {
+      ubVal = val;
+      boundsVersion++;
+    }
+  }
 
   bool isFringe(void) const { return Q.empty(); }
   size_t getNumActions(void) const { return Q.size(); }
@@ -93,7 +93,7 @@ void PointLowerBound::update(MDPNode& cn)
       if (NULL != e) {
 	MDPNode& sn = *e->nextState;
 	double oprob = e->obsProb;
-	lbVal += oprob * sn.lbVal;
+	lbVal += oprob * (sn.lbVal - e->approximationError);
       }
     }
     lbVal = Qa.immediateReward + problem->getDiscount() * lbVal;
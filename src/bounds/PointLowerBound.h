@@ -62,6 +62,7 @@ struct PointLowerBound : public IncrementalLowerBound {
   void initNodeBound(MDPNode& cn);
   void update(MDPNode& cn);
   int getStorage(int whichMetric) const;
+  bool isNodeLocal(void) const { return true; }
 };
 
 }; // namespace zmdp
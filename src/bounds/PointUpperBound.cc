@@ -82,7 +82,7 @@ double PointUpperBound::getNewUBValueQ(MDPNode& cn, int a)
     if (NULL != e) {
       MDPNode& sn = *e->nextState;
       double oprob = e->obsProb;
-      ubVal += oprob * sn.ubVal;
+      ubVal += oprob * (sn.ubVal + e->approximationError);
     }
   }
   ubVal = Qa.immediateReward + problem->getDiscount() * ubVal;
@@ -114,7 +114,7 @@ void PointUpperBound::updateSimple(MDPNode& cn, int* maxUBActionP)
       if (NULL != e) {
 	MDPNode& sn = *e->nextState;
 	double oprob = e->obsProb;
-	ubVal += oprob * sn.ubVal;
+	ubVal += oprob * (sn.ubVal + e->approximationError);
       }
     }
     ubVal = Qa.immediateReward + problem->getDiscount() * ubVal;
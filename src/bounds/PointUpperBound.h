@@ -65,6 +65,7 @@ struct PointUpperBound : public IncrementalUpperBound {
   void updateUseCache(MDPNode& cn, int* maxUBActionP);
   void update(MDPNode& cn, int* maxUBActionP);
   int getStorage(int whichMetric) const;
+  bool isNodeLocal(void) const { return true; }
 };
 
 }; // namespace zmdp
@@ -0,0 +1,100 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    AliasTable.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#include "AliasTable.h"
+
+using namespace std;
+using namespace sla;
+
+namespace zmdp {
+
+int AliasTableArena::addTable(int& numBuckets, const dvector& probs)
+{
+  int offset = buckets.size();
+
+  // one bucket per non-zero outcome
+  double sum = 0.0;
+  numBuckets = 0;
+  FOR (o, probs.size()) {
+    if (probs(o) > 0) {
+      AliasBucket b;
+      b.threshold = probs(o);
+      b.outcome = o;
+      b.aliasOutcome = o;
+      buckets.push_back(b);
+      sum += probs(o);
+      numBuckets++;
+    }
+  }
+  assert(numBuckets > 0);
+  AliasBucket* t = &buckets[offset];
+
+  // Vose's method: scale the probabilities so the average is 1, then
+  // repeatedly fill up an underfull bucket with the excess from an
+  // overfull one.
+  std::vector<int> small, large;
+  FOR (i, numBuckets) {
+    t[i].threshold *= numBuckets / sum;
+    if (t[i].threshold < 1.0) {
+      small.push_back(i);
+    } else {
+      large.push_back(i);
+    }
+  }
+  while (!small.empty() && !large.empty()) {
+    int s = small.back();
+    small.pop_back();
+    int l = large.back();
+    t[s].aliasOutcome = t[l].outcome;
+    t[l].threshold -= (1.0 - t[s].threshold);
+    if (t[l].threshold < 1.0) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // whatever is left over is full up to round-off error
+  FOR_EACH (li, large) {
+    t[*li].threshold = 1.0;
+  }
+  FOR_EACH (si, small) {
+    t[*si].threshold = 1.0;
+  }
+
+  return offset;
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,77 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    AliasTable.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCAliasTable_h
+#define INCAliasTable_h
+
+#include <vector>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTypes.h"
+#include "zmdpRandom.h"
+
+namespace zmdp {
+
+// one bucket of a Walker/Vose alias table.  to sample, a bucket is
+// chosen uniformly at random, then the bucket's own outcome is returned
+// with probability threshold, otherwise its alias.
+struct AliasBucket {
+  double threshold;
+  int outcome;
+  int aliasOutcome;
+};
+
+// stores many alias tables back to back in a single vector, so that
+// building a table does not require a separate heap allocation and
+// tables are close together in memory.  a table is identified by the
+// offset of its first bucket and its number of buckets, which is the
+// number of non-zero outcome probabilities it was built from.
+struct AliasTableArena {
+  std::vector<AliasBucket> buckets;
+
+  // builds a table for the distribution probs (outcome o has
+  // probability probs(o)), returns its offset and sets numBuckets.
+  // probs need only be normalized up to round-off error.
+  int addTable(int& numBuckets, const sla::dvector& probs);
+
+  // draws an outcome from a table built by addTable() in constant time
+  int sample(int offset, int numBuckets, RandomStream& rng) const {
+    double u = rng.unitRand() * numBuckets;
+    int i = (int) u;
+    if (i >= numBuckets) i = numBuckets-1; // guard against round-off
+    const AliasBucket& bucket = buckets[offset + i];
+    return (u - i < bucket.threshold) ? bucket.outcome : bucket.aliasOutcome;
+  }
+
+  void clear(void) { buckets.clear(); }
+  size_t getNumBytes(void) const { return buckets.size() * sizeof(AliasBucket); }
+};
+
+}; // namespace zmdp
+
+#endif // INCAliasTable_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,412 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    AsyncLog.cc
+ @brief   Output streams for periodic logs (bounds, incremental
+          evaluation, storage) that are written to disk by a background
+          thread.
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#include "zmdpCommonDefs.h"
+#include "AsyncLog.h"
+
+using namespace std;
+
+namespace zmdp {
+
+/**********************************************************************
+ * SINKS AND DRAIN THREAD
+ **********************************************************************/
+
+// the consumer side of a sink (drain thread, close, exit and signal
+// handlers) is serialized by drainLock.  sinks live in a static table
+// and are never freed, so a signal handler can safely look at any of
+// them.
+struct AsyncLogSink {
+  int inUse;               // protected by drainLock
+  int fd;
+  char* ring;
+  uint64_t head;           // written only by the producer
+  uint64_t tail;           // written only by the drain lock holder
+  int drainLock;
+  int writeErrno;          // 0 unless a write failed
+  std::string fileName;
+};
+
+static AsyncLogSink sinksG[AL_MAX_STREAMS];
+static double flushIntervalG = 1.0;
+
+static pthread_mutex_t loggerMutexG = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loggerWakeG = PTHREAD_COND_INITIALIZER;
+static pthread_t loggerThreadG;
+static bool loggerStartedG = false;
+static bool loggerStoppingG = false;
+static bool loggerWakeRequestedG = false;
+
+static const int AL_SIGNALS[] = { SIGINT, SIGTERM, SIGHUP };
+static const int AL_NUM_SIGNALS = sizeof(AL_SIGNALS) / sizeof(AL_SIGNALS[0]);
+
+// returns false if the lock could not be acquired within maxTries
+// attempts (maxTries < 0 means wait indefinitely)
+static bool lockSink(AsyncLogSink& sink, int maxTries)
+{
+  for (int i = 0; maxTries < 0 || i < maxTries; i++) {
+    if (0 == __atomic_exchange_n(&sink.drainLock, 1, __ATOMIC_ACQUIRE)) {
+      return true;
+    }
+    sched_yield();
+  }
+  return false;
+}
+
+static void unlockSink(AsyncLogSink& sink)
+{
+  __atomic_store_n(&sink.drainLock, 0, __ATOMIC_RELEASE);
+}
+
+// writes everything in the ring.  only async-signal-safe calls are used,
+// since this also runs in the signal handler.  the caller holds the
+// drain lock.
+static void drainSinkLocked(AsyncLogSink& sink)
+{
+  if (!sink.inUse) return;
+
+  uint64_t tail = sink.tail;
+  uint64_t head = __atomic_load_n(&sink.head, __ATOMIC_ACQUIRE);
+  while (tail < head) {
+    size_t offset = tail & (AL_RING_BYTES-1);
+    size_t len = std::min((size_t) (head - tail), (size_t) AL_RING_BYTES - offset);
+    const char* p = sink.ring + offset;
+    size_t left = len;
+    while (left > 0 && 0 == sink.writeErrno) {
+      ssize_t n = write(sink.fd, p, left);
+      if (n < 0) {
+	if (EINTR == errno) continue;
+	sink.writeErrno = errno;
+	break;
+      }
+      p += n;
+      left -= n;
+    }
+    // if writing failed, data is discarded so the producer never blocks
+    tail += len;
+    __atomic_store_n(&sink.tail, tail, __ATOMIC_RELEASE);
+  }
+}
+
+static void drainAllSinks(int maxTries)
+{
+  FOR (i, AL_MAX_STREAMS) {
+    AsyncLogSink& sink = sinksG[i];
+    if (!__atomic_load_n(&sink.inUse, __ATOMIC_ACQUIRE)) continue;
+    if (lockSink(sink, maxTries)) {
+      drainSinkLocked(sink);
+      unlockSink(sink);
+    }
+  }
+}
+
+static void wakeLogger(void)
+{
+  pthread_mutex_lock(&loggerMutexG);
+  loggerWakeRequestedG = true;
+  pthread_cond_signal(&loggerWakeG);
+  pthread_mutex_unlock(&loggerMutexG);
+}
+
+static void* loggerMain(void* arg)
+{
+  pthread_mutex_lock(&loggerMutexG);
+  while (!loggerStoppingG) {
+    if (!loggerWakeRequestedG) {
+      timeval now;
+      gettimeofday(&now, NULL);
+      double deadline = now.tv_sec + now.tv_usec * 1e-6 + flushIntervalG;
+      timespec ts;
+      ts.tv_sec = (time_t) deadline;
+      ts.tv_nsec = (long) ((deadline - ts.tv_sec) * 1e+9);
+      pthread_cond_timedwait(&loggerWakeG, &loggerMutexG, &ts);
+    }
+    loggerWakeRequestedG = false;
+    pthread_mutex_unlock(&loggerMutexG);
+
+    drainAllSinks(/* maxTries = */ -1);
+
+    pthread_mutex_lock(&loggerMutexG);
+  }
+  pthread_mutex_unlock(&loggerMutexG);
+
+  return NULL;
+}
+
+// flushes the rings and then lets the signal take its default action
+static void loggerSignalHandler(int sig)
+{
+  // the interrupted thread may itself hold a drain lock, so give up on
+  // a sink rather than deadlock
+  drainAllSinks(/* maxTries = */ 1000);
+
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+
+static void stopLogger(void)
+{
+  pthread_mutex_lock(&loggerMutexG);
+  bool started = loggerStartedG;
+  loggerStoppingG = true;
+  pthread_cond_signal(&loggerWakeG);
+  pthread_mutex_unlock(&loggerMutexG);
+
+  if (started) {
+    pthread_join(loggerThreadG, NULL);
+  }
+  drainAllSinks(/* maxTries = */ -1);
+}
+
+// called with loggerMutexG held
+static void startLoggerLocked(void)
+{
+  if (loggerStartedG || loggerStoppingG) return;
+
+  // the drain thread never handles signals, so a signal handler never
+  // interrupts it while it holds a drain lock
+  sigset_t all, old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  pthread_create(&loggerThreadG, NULL, &loggerMain, NULL);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  loggerStartedG = true;
+
+  atexit(&stopLogger);
+
+  FOR (i, AL_NUM_SIGNALS) {
+    struct sigaction act;
+    sigaction(AL_SIGNALS[i], NULL, &act);
+    if (SIG_DFL == act.sa_handler) {
+      memset(&act, 0, sizeof(act));
+      act.sa_handler = &loggerSignalHandler;
+      sigemptyset(&act.sa_mask);
+      sigaction(AL_SIGNALS[i], &act, NULL);
+    }
+  }
+}
+
+/**********************************************************************
+ * ASYNC LOG BUF
+ **********************************************************************/
+
+AsyncLogBuf::AsyncLogBuf(void) :
+  sink(NULL)
+{
+  setp(localBuf, localBuf + AL_LOCAL_BYTES);
+}
+
+AsyncLogBuf::~AsyncLogBuf(void)
+{
+  close();
+}
+
+bool AsyncLogBuf::open(const std::string& fileName)
+{
+  assert(NULL == sink);
+
+  int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (-1 == fd) return false;
+
+  pthread_mutex_lock(&loggerMutexG);
+  FOR (i, AL_MAX_STREAMS) {
+    AsyncLogSink& s = sinksG[i];
+    if (!s.inUse && NULL == s.ring) {
+      s.fd = fd;
+      s.ring = (char*) malloc(AL_RING_BYTES);
+      s.head = 0;
+      s.tail = 0;
+      s.writeErrno = 0;
+      s.fileName = fileName;
+      __atomic_store_n(&s.inUse, 1, __ATOMIC_RELEASE);
+      sink = &s;
+      break;
+    }
+  }
+  if (NULL == sink) {
+    fprintf(stderr, "ERROR: more than %d async log streams open at once\n",
+	    AL_MAX_STREAMS);
+    exit(EXIT_FAILURE);
+  }
+  startLoggerLocked();
+  pthread_mutex_unlock(&loggerMutexG);
+
+  return true;
+}
+
+void AsyncLogBuf::close(void)
+{
+  if (NULL == sink) return;
+
+  commitLocal();
+
+  lockSink(*sink, /* maxTries = */ -1);
+  drainSinkLocked(*sink);
+  if (0 != sink->writeErrno) {
+    fprintf(stderr, "WARNING: couldn't write to %s: %s\n",
+	    sink->fileName.c_str(), strerror(sink->writeErrno));
+  }
+  __atomic_store_n(&sink->inUse, 0, __ATOMIC_RELEASE);
+  ::close(sink->fd);
+  unlockSink(*sink);
+
+  // the slot is reusable once its ring is freed
+  pthread_mutex_lock(&loggerMutexG);
+  free(sink->ring);
+  sink->ring = NULL;
+  pthread_mutex_unlock(&loggerMutexG);
+
+  sink = NULL;
+}
+
+// copies the local buffer into the ring.  if the ring is full, drains it
+// on this thread rather than dropping output.
+void AsyncLogBuf::commitLocal(void)
+{
+  const char* p = pbase();
+  size_t left = pptr() - pbase();
+  setp(localBuf, localBuf + AL_LOCAL_BYTES);
+  if (NULL == sink) return;
+
+  uint64_t head = sink->head;
+  while (left > 0) {
+    uint64_t tail = __atomic_load_n(&sink->tail, __ATOMIC_ACQUIRE);
+    size_t used = head - tail;
+    size_t space = AL_RING_BYTES - used;
+    if (0 == space) {
+      lockSink(*sink, /* maxTries = */ -1);
+      drainSinkLocked(*sink);
+      unlockSink(*sink);
+      continue;
+    }
+
+    size_t offset = head & (AL_RING_BYTES-1);
+    size_t len = std::min(std::min(left, space), (size_t) AL_RING_BYTES - offset);
+    memcpy(sink->ring + offset, p, len);
+    p += len;
+    left -= len;
+    head += len;
+    __atomic_store_n(&sink->head, head, __ATOMIC_RELEASE);
+
+    // bound the amount of unwritten data as well as its age
+    if (used < AL_RING_BYTES/2 && used + len >= AL_RING_BYTES/2) {
+      wakeLogger();
+    }
+  }
+}
+
+int AsyncLogBuf::overflow(int c)
+{
+  commitLocal();
+  if (traits_type::eof() != c) {
+    *pptr() = (char) c;
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+int AsyncLogBuf::sync(void)
+{
+  commitLocal();
+  return 0;
+}
+
+/**********************************************************************
+ * ASYNC LOG STREAM
+ **********************************************************************/
+
+AsyncLogStream::AsyncLogStream(const std::string& fileName) :
+  std::ostream(NULL)
+{
+  init(&buf);
+  if (!buf.open(fileName)) {
+    setstate(std::ios::failbit);
+  }
+}
+
+AsyncLogStream::~AsyncLogStream(void)
+{
+  close();
+}
+
+void AsyncLogStream::close(void)
+{
+  buf.close();
+}
+
+/**********************************************************************
+ * EXPORTED API
+ **********************************************************************/
+
+void setAsyncLogFlushInterval(double seconds)
+{
+  pthread_mutex_lock(&loggerMutexG);
+  flushIntervalG = seconds;
+  pthread_mutex_unlock(&loggerMutexG);
+}
+
+std::ostream* newLogStream(const std::string& fileName)
+{
+  std::ostream* out;
+  if (flushIntervalG > 0) {
+    out = new AsyncLogStream(fileName);
+  } else {
+    out = new std::ofstream(fileName.c_str());
+  }
+  if (! (*out)) {
+    fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
+	    fileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  return out;
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,110 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    AsyncLog.h
+ @brief   Output streams for periodic logs (bounds, incremental
+          evaluation, storage) that are written to disk by a background
+          thread.
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCAsyncLog_h
+#define INCAsyncLog_h
+
+#include <stdint.h>
+
+#include <iostream>
+#include <string>
+
+// How it works.  Each stream formats into a small local buffer.  When
+// the stream is flushed (including by endl) or the local buffer fills,
+// its contents are copied into a per-stream ring buffer of AL_RING_BYTES
+// bytes.  The ring has a single producer (the thread writing to the
+// stream) and a single consumer at a time, so the producer side needs no
+// lock.  A background thread drains all rings with write(2) every
+// flush interval, or sooner when a ring is half full.  If a ring is
+// full the producer drains it itself rather than dropping output.
+//
+// Everything that has been flushed into a ring is written when the
+// stream is closed, at exit(), and when the process is killed by
+// SIGINT, SIGTERM or SIGHUP (unless the program installed its own
+// handler for the signal, in which case it is expected to exit
+// normally).
+
+// size of each stream's ring buffer (must be a power of 2)
+#define AL_RING_BYTES (1 << 20)
+
+// size of each stream's local formatting buffer
+#define AL_LOCAL_BYTES (1 << 12)
+
+// maximum number of async log streams open at once
+#define AL_MAX_STREAMS (32)
+
+namespace zmdp {
+
+struct AsyncLogSink;
+
+struct AsyncLogBuf : public std::streambuf {
+  AsyncLogBuf(void);
+  ~AsyncLogBuf(void);
+
+  bool open(const std::string& fileName);
+  bool is_open(void) const { return NULL != sink; }
+  void close(void);
+
+protected:
+  AsyncLogSink* sink;
+  char localBuf[AL_LOCAL_BYTES];
+
+  void commitLocal(void);
+  virtual int overflow(int c);
+  virtual int sync(void);
+};
+
+// an output file stream whose data is written by the background thread
+struct AsyncLogStream : public std::ostream {
+  AsyncLogStream(const std::string& fileName);
+  ~AsyncLogStream(void);
+
+  bool is_open(void) const { return buf.is_open(); }
+
+  // flushes the stream and waits until all of its data is written
+  void close(void);
+
+protected:
+  AsyncLogBuf buf;
+};
+
+// sets the maximum time in seconds between a log line being flushed and
+// it being written to disk.  if seconds <= 0, newLogStream() returns
+// ordinary synchronous file streams.  call before opening any streams.
+void setAsyncLogFlushInterval(double seconds);
+
+// opens fileName for writing, exiting with an error message on failure.
+// returns an AsyncLogStream, or a std::ofstream if async logging is
+// disabled.  the caller deletes the stream to close it.
+std::ostream* newLogStream(const std::string& fileName);
+
+}; // namespace zmdp
+
+#endif // INCAsyncLog_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
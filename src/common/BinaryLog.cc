@@ -0,0 +1,521 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    BinaryLog.cc
+ @brief   Compact binary form of the simulation trace, state index
+          and backups logs.
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <iomanip>
+
+#include "BinaryLog.h"
+#include "MatrixUtils.h"
+
+using namespace std;
+using namespace sla;
+using namespace MatrixUtils;
+
+namespace zmdp {
+
+/**********************************************************************
+ * LOCAL HELPER FUNCTIONS
+ **********************************************************************/
+
+static const size_t BL_FILE_HEADER_BYTES = 8 + 2*sizeof(uint32_t);
+static const size_t BL_BLOCK_HEADER_BYTES = 4*sizeof(uint32_t);
+
+static uint32_t getChecksum(const unsigned char* bytes, size_t numBytes)
+{
+  uint32_t h = 2166136261U;
+  FOR (i, numBytes) {
+    h = (h ^ bytes[i]) * 16777619U;
+  }
+  return h;
+}
+
+static bool getVectorsEqual(const state_vector& x, const state_vector& y)
+{
+  if (x.size() != y.size() || x.filled() != y.filled()) return false;
+  FOR (i, x.filled()) {
+    if (x.data[i].index != y.data[i].index
+	|| x.data[i].value != y.data[i].value) return false;
+  }
+  return true;
+}
+
+/**********************************************************************
+ * BINARY LOG WRITER
+ **********************************************************************/
+
+BinaryLogWriter::BinaryLogWriter(const std::string& _fileName, int kind) :
+  fileName(_fileName),
+  numBlockRecords(0),
+  lastNextStateValid(false),
+  closing(false),
+  closed(false)
+{
+  out = fopen(fileName.c_str(), "wb");
+  if (NULL == out) {
+    fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
+	    fileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  uint32_t header[2] = { BL_FORMAT_VERSION, (uint32_t) kind };
+  fwrite(BL_FILE_MAGIC, 1, 8, out);
+  fwrite(header, sizeof(header), 1, out);
+
+  block.reserve(BL_BLOCK_BYTES + BL_BLOCK_HEADER_BYTES);
+  block.resize(BL_BLOCK_HEADER_BYTES);
+
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&blockQueued, NULL);
+  pthread_cond_init(&blockWritten, NULL);
+  pthread_create(&writerThread, NULL, &BinaryLogWriter::writerMainEntry, this);
+}
+
+BinaryLogWriter::~BinaryLogWriter(void)
+{
+  close();
+  pthread_mutex_destroy(&mutex);
+  pthread_cond_destroy(&blockQueued);
+  pthread_cond_destroy(&blockWritten);
+}
+
+void BinaryLogWriter::writeBegin(void)
+{
+  beginRecord(BL_BEGIN);
+  endRecord();
+}
+
+void BinaryLogWriter::writeStep(const state_vector& s, int a,
+				const state_vector& nextState, int o)
+{
+  beginRecord(BL_STEP);
+  putVarint(a);
+  putVarint(o);
+  // consecutive steps of a trial share a state, so it is usually
+  // stored only once
+  if (lastNextStateValid && getVectorsEqual(s, lastNextState)) {
+    putVarint(1);
+  } else {
+    putVarint(0);
+    putVector(s);
+  }
+  putVector(nextState);
+  lastNextState = nextState;
+  lastNextStateValid = true;
+  endRecord();
+}
+
+void BinaryLogWriter::writeTerminated(void)
+{
+  beginRecord(BL_TERMINATED);
+  endRecord();
+}
+
+void BinaryLogWriter::writeState(const state_vector& s)
+{
+  beginRecord(BL_STATE);
+  putVector(s);
+  endRecord();
+}
+
+void BinaryLogWriter::writeBackup(int stateId)
+{
+  beginRecord(BL_BACKUP);
+  putVarint(stateId);
+  endRecord();
+}
+
+void BinaryLogWriter::close(void)
+{
+  if (closed) return;
+
+  if (numBlockRecords > 0) {
+    flushBlock();
+  }
+  pthread_mutex_lock(&mutex);
+  closing = true;
+  pthread_cond_signal(&blockQueued);
+  pthread_mutex_unlock(&mutex);
+  pthread_join(writerThread, NULL);
+
+  if (0 != fclose(out)) {
+    fprintf(stderr, "ERROR: couldn't write to %s: %s\n",
+	    fileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  closed = true;
+}
+
+void BinaryLogWriter::beginRecord(int type)
+{
+  assert(!closed);
+  putVarint(type);
+}
+
+void BinaryLogWriter::endRecord(void)
+{
+  numBlockRecords++;
+  if (block.size() >= BL_BLOCK_BYTES + BL_BLOCK_HEADER_BYTES) {
+    flushBlock();
+  }
+}
+
+void BinaryLogWriter::putVarint(uint64_t x)
+{
+  while (x >= 0x80) {
+    block.push_back((unsigned char) (x | 0x80));
+    x >>= 7;
+  }
+  block.push_back((unsigned char) x);
+}
+
+void BinaryLogWriter::putVector(const state_vector& v)
+{
+  putVarint(v.size());
+  putVarint(v.filled());
+  // each entry is the index delta, shifted left one bit; the low bit is
+  // set if the value repeats the previous entry's value, in which case
+  // the value is omitted.  beliefs are often spread evenly over many
+  // states, so this saves much of their size.
+  unsigned int lastIndex = 0;
+  double lastVal = 0.0;
+  FOR_CV (v) {
+    double val = CV_VAL(v);
+    bool repeat = (val == lastVal);
+    putVarint((((uint64_t) (CV_INDEX(v) - lastIndex)) << 1) | (repeat ? 1 : 0));
+    lastIndex = CV_INDEX(v);
+    if (!repeat) {
+      size_t n = block.size();
+      block.resize(n + sizeof(val));
+      memcpy(&block[n], &val, sizeof(val));
+      lastVal = val;
+    }
+  }
+}
+
+// fills in the header of the current block and hands it to the writer
+// thread
+void BinaryLogWriter::flushBlock(void)
+{
+  uint32_t header[4];
+  header[0] = BL_BLOCK_MAGIC;
+  header[1] = block.size() - BL_BLOCK_HEADER_BYTES;
+  header[2] = numBlockRecords;
+  header[3] = getChecksum(&block[BL_BLOCK_HEADER_BYTES], header[1]);
+  memcpy(&block[0], header, sizeof(header));
+
+  std::vector<unsigned char>* full = new std::vector<unsigned char>();
+  full->swap(block);
+
+  pthread_mutex_lock(&mutex);
+  while (queue.size() >= BL_MAX_QUEUED_BLOCKS) {
+    pthread_cond_wait(&blockWritten, &mutex);
+  }
+  queue.push_back(full);
+  pthread_cond_signal(&blockQueued);
+  pthread_mutex_unlock(&mutex);
+
+  block.reserve(BL_BLOCK_BYTES + BL_BLOCK_HEADER_BYTES);
+  block.resize(BL_BLOCK_HEADER_BYTES);
+  numBlockRecords = 0;
+  lastNextStateValid = false;
+}
+
+void BinaryLogWriter::writerMain(void)
+{
+  pthread_mutex_lock(&mutex);
+  while (1) {
+    while (queue.empty() && !closing) {
+      pthread_cond_wait(&blockQueued, &mutex);
+    }
+    if (queue.empty()) break;
+
+    std::vector<unsigned char>* full = queue.front();
+    pthread_mutex_unlock(&mutex);
+
+    if (1 != fwrite(&(*full)[0], full->size(), 1, out)) {
+      fprintf(stderr, "ERROR: couldn't write to %s: %s\n",
+	      fileName.c_str(), strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    delete full;
+
+    pthread_mutex_lock(&mutex);
+    queue.pop_front();
+    pthread_cond_signal(&blockWritten);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+void* BinaryLogWriter::writerMainEntry(void* writer)
+{
+  ((BinaryLogWriter*) writer)->writerMain();
+  return NULL;
+}
+
+/**********************************************************************
+ * BINARY LOG READER
+ **********************************************************************/
+
+BinaryLogReader::BinaryLogReader(const std::string& _fileName) :
+  fileName(_fileName),
+  data(NULL),
+  dataSize(0),
+  blockEnd(0),
+  blockRecordsLeft(0),
+  numStates(0)
+{
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (-1 == fd) {
+    fprintf(stderr, "ERROR: couldn't open %s for reading: %s\n",
+	    fileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  struct stat st;
+  if (0 != fstat(fd, &st) || (size_t) st.st_size < BL_FILE_HEADER_BYTES) {
+    fprintf(stderr, "ERROR: %s is not a binary log\n", fileName.c_str());
+    exit(EXIT_FAILURE);
+  }
+  dataSize = st.st_size;
+  void* mapped = mmap(NULL, dataSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (MAP_FAILED == mapped) {
+    fprintf(stderr, "ERROR: couldn't map %s: %s\n",
+	    fileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  data = (const unsigned char*) mapped;
+  madvise(mapped, dataSize, MADV_SEQUENTIAL);
+
+  uint32_t header[2];
+  memcpy(header, data + 8, sizeof(header));
+  if (0 != memcmp(data, BL_FILE_MAGIC, 8) || BL_FORMAT_VERSION != header[0]) {
+    fprintf(stderr, "ERROR: %s is not a binary log of a version this program can read\n",
+	    fileName.c_str());
+    exit(EXIT_FAILURE);
+  }
+  kind = header[1];
+  pos = blockEnd = BL_FILE_HEADER_BYTES;
+}
+
+BinaryLogReader::~BinaryLogReader(void)
+{
+  munmap((void*) data, dataSize);
+}
+
+bool BinaryLogReader::next(BinaryLogRecord& rec)
+{
+  if (0 == blockRecordsLeft) {
+    if (!beginBlock()) return false;
+  }
+  blockRecordsLeft--;
+
+  rec.type = getVarint();
+  switch (rec.type) {
+  case BL_BEGIN:
+  case BL_TERMINATED:
+    break;
+  case BL_STEP:
+    rec.action = getVarint();
+    rec.outcome = getVarint();
+    if (1 == getVarint()) {
+      rec.state = lastNextState;
+    } else {
+      getVector(rec.state);
+    }
+    getVector(rec.nextState);
+    lastNextState = rec.nextState;
+    break;
+  case BL_STATE:
+    rec.stateId = numStates++;
+    getVector(rec.state);
+    break;
+  case BL_BACKUP:
+    rec.stateId = getVarint();
+    break;
+  default:
+    fprintf(stderr, "ERROR: %s: unknown record type %d at offset %lu\n",
+	    fileName.c_str(), rec.type, (unsigned long) pos);
+    exit(EXIT_FAILURE);
+  }
+  return true;
+}
+
+bool BinaryLogReader::isBinaryLog(const std::string& fileName)
+{
+  char magic[8];
+  FILE* in = fopen(fileName.c_str(), "rb");
+  if (NULL == in) return false;
+  bool result = (1 == fread(magic, sizeof(magic), 1, in))
+    && (0 == memcmp(magic, BL_FILE_MAGIC, sizeof(magic)));
+  fclose(in);
+  return result;
+}
+
+// moves to the start of the next block.  returns false at the end of
+// the log.
+bool BinaryLogReader::beginBlock(void)
+{
+  pos = blockEnd;
+  if (pos == dataSize) return false;
+
+  uint32_t header[4];
+  if (pos + BL_BLOCK_HEADER_BYTES <= dataSize) {
+    memcpy(header, data + pos, sizeof(header));
+  }
+  if (pos + BL_BLOCK_HEADER_BYTES > dataSize
+      || pos + BL_BLOCK_HEADER_BYTES + header[1] > dataSize) {
+    // the run that wrote the log was probably interrupted
+    fprintf(stderr, "WARNING: %s: ignoring incomplete block at end of log\n",
+	    fileName.c_str());
+    return false;
+  }
+  if (BL_BLOCK_MAGIC != header[0]
+      || getChecksum(data + pos + BL_BLOCK_HEADER_BYTES, header[1]) != header[3]) {
+    fprintf(stderr, "ERROR: %s: corrupt block at offset %lu\n",
+	    fileName.c_str(), (unsigned long) pos);
+    exit(EXIT_FAILURE);
+  }
+  pos += BL_BLOCK_HEADER_BYTES;
+  blockEnd = pos + header[1];
+  blockRecordsLeft = header[2];
+  lastNextState.resize(0);
+  return (blockRecordsLeft > 0) || beginBlock();
+}
+
+uint64_t BinaryLogReader::getVarint(void)
+{
+  uint64_t x = 0;
+  int shift = 0;
+  while (1) {
+    checkPos(1);
+    unsigned char c = data[pos++];
+    x |= ((uint64_t) (c & 0x7f)) << shift;
+    if (!(c & 0x80)) return x;
+    shift += 7;
+  }
+}
+
+void BinaryLogReader::getVector(state_vector& v)
+{
+  unsigned int size = getVarint();
+  unsigned int filled = getVarint();
+  v.resize(size);
+  unsigned int index = 0;
+  double val = 0.0;
+  FOR (i, filled) {
+    uint64_t x = getVarint();
+    index += (unsigned int) (x >> 1);
+    if (!(x & 1)) {
+      checkPos(sizeof(val));
+      memcpy(&val, data + pos, sizeof(val));
+      pos += sizeof(val);
+    }
+    v.push_back(index, val);
+  }
+}
+
+void BinaryLogReader::checkPos(size_t numBytes)
+{
+  if (pos + numBytes > blockEnd) {
+    fprintf(stderr, "ERROR: %s: record overruns block ending at offset %lu\n",
+	    fileName.c_str(), (unsigned long) blockEnd);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**********************************************************************
+ * TEXT FORM
+ **********************************************************************/
+
+void writeTextLogHeader(std::ostream& out, int kind)
+{
+  switch (kind) {
+  case BL_SIM_TRACE:
+    break;
+  case BL_STATE_INDEX:
+    out << "# This file is an index of states (or POMDP beliefs) referenced in other log\n"
+	<< "# files.  Each state is given a unique id number in the line of the form\n"
+	<< "# 'state <id>'.  (Note that the id numbers are guaranteed to appear in order\n"
+	<< "# starting with 0.)  Subsequent lines after each 'state' line specify the\n"
+	<< "# state as a sparse vector.  Each line has the form '<index> <value>'\n"
+	<< "# specifying one entry of the vector, and entries that do not appear have\n"
+	<< "# value 0.\n";
+    break;
+  case BL_BACKUPS:
+    out << "# This file is a log of backups.  All backups performed by the heuristic\n"
+	<< "# search algorithm appear in order.  The line for a backup gives the\n"
+	<< "# index number of the backed up state; these index numbers reference states\n"
+	<< "# listed in the state index file.\n";
+    break;
+  default:
+    assert(0); // never reach this point
+  }
+}
+
+void writeTextLogRecord(std::ostream& out, const BinaryLogRecord& rec)
+{
+  switch (rec.type) {
+  case BL_BEGIN:
+    out << ">>> begin" << endl;
+    break;
+  case BL_STEP:
+    out << "sim: [" << sparseRep(rec.state) << "] " << rec.action << " ["
+	<< sparseRep(rec.nextState) << "] " << rec.outcome << endl;
+    break;
+  case BL_TERMINATED:
+    out << "terminated" << endl;
+    break;
+  case BL_STATE:
+    out << "state " << rec.stateId << endl;
+    FOR_CV (rec.state) {
+      out << CV_INDEX(rec.state) << " " << setprecision(20) << CV_VAL(rec.state) << endl;
+    }
+    break;
+  case BL_BACKUP:
+    out << rec.stateId << endl;
+    break;
+  default:
+    assert(0); // never reach this point
+  }
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
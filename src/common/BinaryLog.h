@@ -0,0 +1,181 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    BinaryLog.h
+ @brief   Compact binary form of the simulation trace, state index
+          and backups logs.
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCBinaryLog_h
+#define INCBinaryLog_h
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTypes.h"
+
+// File layout.  A binary log starts with the 8-byte magic string
+// BL_FILE_MAGIC, a uint32 format version and a uint32 log kind
+// (BinaryLogKindEnum).  The rest of the file is a sequence of blocks,
+// each with a header of four uint32 fields (BL_BLOCK_MAGIC, payload
+// length, number of records, FNV-1a checksum of the payload) followed by
+// the payload.  Fixed-size fields are in host byte order.
+//
+// The payload is a sequence of records.  Integers are LEB128 varints,
+// vector entry values are 8-byte doubles, and vectors are stored
+// sparsely with delta-coded indices, omitting values that repeat the
+// previous entry's value.  In a step record a state that equals the
+// previous step's next state is stored as a one-byte back-reference.
+// Blocks decode independently, so if a run is killed only the partly
+// written block at the end of the file is lost.
+
+#define BL_FILE_MAGIC "ZMDPLOG\x01"
+#define BL_FORMAT_VERSION (1)
+#define BL_BLOCK_MAGIC (0x4b4c425aU)
+
+// records are gathered into blocks of about this size before they are
+// handed to the writer thread
+#define BL_BLOCK_BYTES (1 << 16)
+
+// if this many blocks are waiting to be written, the logging thread
+// waits for the writer thread to catch up
+#define BL_MAX_QUEUED_BLOCKS (16)
+
+namespace zmdp {
+
+enum BinaryLogKindEnum {
+  BL_SIM_TRACE   = 1,
+  BL_STATE_INDEX = 2,
+  BL_BACKUPS     = 3
+};
+
+enum BinaryLogRecordEnum {
+  BL_BEGIN      = 1, // start of a simulation trial
+  BL_STEP       = 2, // state, action, next state and outcome of one step
+  BL_TERMINATED = 3, // simulation trial reached a terminal state
+  BL_STATE      = 4, // state index entry; ids are assigned in order
+  BL_BACKUP     = 5  // id of a backed up state
+};
+
+struct BinaryLogRecord {
+  int type;
+  int action, outcome;     // BL_STEP
+  int stateId;             // BL_STATE, BL_BACKUP
+  state_vector state;      // BL_STEP, BL_STATE
+  state_vector nextState;  // BL_STEP
+};
+
+// appends records to a binary log.  encoding happens on the calling
+// thread, and full blocks are written to disk by a background thread,
+// so the caller does not wait for I/O unless the writer falls behind.
+struct BinaryLogWriter {
+  std::string fileName;
+
+  BinaryLogWriter(const std::string& _fileName, int kind);
+  ~BinaryLogWriter(void);
+
+  void writeBegin(void);
+  void writeStep(const state_vector& s, int a, const state_vector& nextState, int o);
+  void writeTerminated(void);
+  void writeState(const state_vector& s);
+  void writeBackup(int stateId);
+
+  // writes any buffered records and waits for the writer thread to
+  // finish.  called by the destructor if not called earlier.
+  void close(void);
+
+protected:
+  FILE* out;
+  std::vector<unsigned char> block;
+  int numBlockRecords;
+  state_vector lastNextState;
+  bool lastNextStateValid;
+
+  // blocks waiting to be written, protected by mutex
+  pthread_t writerThread;
+  pthread_mutex_t mutex;
+  pthread_cond_t blockQueued;
+  pthread_cond_t blockWritten;
+  std::deque< std::vector<unsigned char>* > queue;
+  bool closing;
+  bool closed;
+
+  void beginRecord(int type);
+  void endRecord(void);
+  void putVarint(uint64_t x);
+  void putVector(const state_vector& v);
+  void flushBlock(void);
+  void writerMain(void);
+  static void* writerMainEntry(void* writer);
+};
+
+// reads a binary log.  the file is memory-mapped rather than read, so
+// opening even a very large log is fast, and pages are only touched as
+// records are decoded.
+struct BinaryLogReader {
+  std::string fileName;
+  int kind;
+
+  BinaryLogReader(const std::string& _fileName);
+  ~BinaryLogReader(void);
+
+  // reads the next record into rec.  returns false at the end of the
+  // log.
+  bool next(BinaryLogRecord& rec);
+
+  // returns true if fileName exists and starts with BL_FILE_MAGIC
+  static bool isBinaryLog(const std::string& fileName);
+
+protected:
+  const unsigned char* data;
+  size_t dataSize;
+  size_t blockEnd;
+  size_t pos;
+  int blockRecordsLeft;
+  int numStates;
+  state_vector lastNextState;
+
+  bool beginBlock(void);
+  uint64_t getVarint(void);
+  void getVector(state_vector& v);
+  void checkPos(size_t numBytes);
+};
+
+// writes the comment header of the text form of a log of the given
+// kind.  the text writers and the binary-to-text converter share these
+// functions so that the two forms always agree.
+void writeTextLogHeader(std::ostream& out, int kind);
+
+// writes the text form of a record
+void writeTextLogRecord(std::ostream& out, const BinaryLogRecord& rec);
+
+}; // namespace zmdp
+
+#endif // INCBinaryLog_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
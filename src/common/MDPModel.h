@@ -30,6 +30,8 @@
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTypes.h"
 #include "zmdpConfig.h"
+#include "zmdpRandom.h"
+#include "MatrixUtils.h"
 
 using namespace sla;
 
@@ -37,6 +39,33 @@ namespace zmdp {
 
 struct AbstractBound;
 
+// scratch storage passed to the MDP functions below that take a
+// workspace argument, so that they need not allocate temporaries.  each
+// caller (e.g. a simulator or an executive) owns its own workspace, so
+// concurrent callers do not interfere with each other.
+//
+// a caller that makes several calls about the same state s (e.g. for
+// every action and outcome when expanding s) can bracket them with
+// beginCaching(s) and endCaching().  in between, models may keep
+// intermediate results computed from s in cache[] (with cacheValid[i]
+// marking slot i as filled), and the caller must not modify s.
+struct MDPWorkspace {
+  sla::sparse_accumulator accum;
+  cvector ctmp;
+  outcome_prob_vector opv;
+  const state_vector* cacheState;
+  std::vector<cvector> cache;
+  std::vector<bool> cacheValid;
+
+  MDPWorkspace(void) : cacheState(NULL) {}
+
+  void beginCaching(const state_vector& s) {
+    cacheState = &s;
+    cacheValid.assign(cacheValid.size(), false);
+  }
+  void endCaching(void) { cacheState = NULL; }
+};
+
 // Represents an MDP where state is continuous, time is discrete,
 // actions are discrete, and the possible outcomes of an action form a
 // discrete probability distribution.  This data structure can
@@ -68,9 +97,56 @@ struct MDP {
   virtual state_vector& getNextState(state_vector& result, const state_vector& s, int a,
 				     int o) = 0;
 
+  // same as above, but models may use ws for temporary storage.  the
+  // default implementation ignores ws.
+  virtual outcome_prob_vector& getOutcomeProbVector(outcome_prob_vector& result,
+						    const state_vector& s, int a,
+						    MDPWorkspace& ws)
+    { return getOutcomeProbVector(result, s, a); }
+
+  // same as above, but models that need temporary storage to calculate
+  // the next state should use ws rather than allocating it.  the
+  // default implementation ignores ws.
+  virtual state_vector& getNextState(state_vector& result, const state_vector& s, int a,
+				     int o, MDPWorkspace& ws)
+    { return getNextState(result, s, a, o); }
+
+  // draws an outcome index o according to the outcome probabilities
+  // when from state s action a is selected.  the default implementation
+  // scans the vector returned by getOutcomeProbVector(); models that
+  // can cache per-state data should override it to sample faster.
+  virtual int sampleOutcome(const state_vector& s, int a, RandomStream& rng,
+			    MDPWorkspace& ws) {
+    getOutcomeProbVector(ws.opv, s, a);
+    return MatrixUtils::chooseFromDistribution(ws.opv, rng);
+  }
+
   // returns the expected immediate reward when from state s action a is selected
   virtual double getReward(const state_vector& s, int a) = 0;
 
+  // models whose states are beliefs may support truncating small
+  // entries of successor states (see beliefTruncationThreshold in
+  // zmdp.config).  truncateState() truncates s in place and returns the
+  // probability mass removed; the value of the truncated state differs
+  // from the value of the original by at most that mass times
+  // getValueRange().  it must be safe to call from multiple threads.
+  // the defaults do no truncation.  getValueRange() is also used to
+  // bound the error from merging nearby beliefs (see beliefMergeRadius);
+  // a model that returns 0 doesn't support merging.
+  virtual double truncateState(state_vector& s) { return 0.0; }
+  virtual double getValueRange(void) { return 0.0; }
+
+  // returns s as it should appear in logs such as the simulation
+  // trace, using storage if a copy is needed.  models that renumber
+  // their states internally map s back to the states of the model file.
+  virtual const state_vector& getLogState(state_vector& storage, const state_vector& s)
+    { return s; }
+
+  // returns a readable representation of s for logs such as the
+  // simulation trace
+  std::string getStateString(const state_vector& s)
+    { state_vector storage; return MatrixUtils::sparseRep(getLogState(storage, s)); }
+
   // returns a new lower bound or upper bound that is valid for
   // this MDP.  notes:
   // * the resulting bound must be initialized before it is used, and
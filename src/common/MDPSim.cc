@@ -42,9 +42,11 @@ using namespace MatrixUtils;
 namespace zmdp {
 
 MDPSim::MDPSim(MDP* _model) :
-  model(_model)
+  model(_model),
+  rng(getThreadRandomStream().split())
 {
   simOutFile = NULL;
+  simLog = NULL;
   restart();
 }
 
@@ -53,6 +55,7 @@ MDPSim::MDPSim(MDP* _model) :
 void MDPSim::restart(void) {
   elapsedTime = 0;
   rewardSoFar = 0;
+  discountFactor = 1.0;
   lastOutcomeIndex = -1;
   terminated = false;
   state.resize(model->getInitialState().size());
@@ -60,6 +63,9 @@ void MDPSim::restart(void) {
   if (simOutFile) {
     (*simOutFile) << ">>> begin" << endl;
   }
+  if (simLog) {
+    simLog->writeBegin();
+  }
 }
 
 void MDPSim::performAction(int a) {
@@ -71,23 +77,25 @@ void MDPSim::performAction(int a) {
 
   // increment reward
   double imm_reward = model->getReward(state,a);
-  rewardSoFar += pow(model->discount, elapsedTime) * imm_reward;
+  rewardSoFar += discountFactor * imm_reward;
 
-  // draw outcome index o and corresponding successor state sp
-  outcome_prob_vector opv;
-  state_vector sp;
-  model->getOutcomeProbVector(opv, state, a);
-  int o = chooseFromDistribution(opv);
-  model->getNextState(sp, state, a, o);
+  // draw outcome index o and corresponding successor state
+  int o = model->sampleOutcome(state, a, rng, workspace);
+  model->getNextState(nextState, state, a, o, workspace);
 
   // log transition information
   if (simOutFile) {
-    (*simOutFile) << "sim: [" << sparseRep(state) << "] " << a << " ["
-		  << sparseRep(sp) << "] " << o << endl;
+    (*simOutFile) << "sim: [" << model->getStateString(state) << "] " << a << " ["
+		  << model->getStateString(nextState) << "] " << o << endl;
+  }
+  if (simLog) {
+    simLog->writeStep(model->getLogState(logStorage, state), a,
+		      model->getLogState(nextLogStorage, nextState), o);
   }
 
   // bring sim variables up to date
-  state = sp;
+  state.swap(nextState);
+  discountFactor *= model->discount;
   elapsedTime++;
   lastOutcomeIndex = o;
 
@@ -97,6 +105,9 @@ void MDPSim::performAction(int a) {
     if (simOutFile) {
       (*simOutFile) << "terminated" << endl;
     }
+    if (simLog) {
+      simLog->writeTerminated();
+    }
   }
 }
 
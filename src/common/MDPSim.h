@@ -24,6 +24,8 @@
 #define INCMDPSim_h
 
 #include "MDPModel.h"
+#include "zmdpRandom.h"
+#include "BinaryLog.h"
 
 namespace zmdp {
 
@@ -33,8 +35,21 @@ struct MDPSim {
   double rewardSoFar;
   bool terminated;
   std::ostream *simOutFile;
+  // if set, the trace is also written here in binary form
+  BinaryLogWriter *simLog;
   int elapsedTime;
   int lastOutcomeIndex;
+  // outcomes are drawn from rng; by default it is split off the creating
+  // thread's stream, but callers may reseed it for reproducible runs
+  RandomStream rng;
+  // preallocated storage, so that once the first few steps have grown
+  // it to the right size, performAction() does not allocate (unless
+  // logging to simOutFile)
+  MDPWorkspace workspace;
+  state_vector nextState;
+  state_vector logStorage, nextLogStorage;
+  // discount^elapsedTime
+  double discountFactor;
   
   MDPSim(MDP* _model);
 
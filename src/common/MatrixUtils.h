@@ -39,6 +39,7 @@
 
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTypes.h"
+#include "zmdpRandom.h"
 
 #include "slaMatrixUtils.h"
 
@@ -48,10 +49,13 @@ namespace MatrixUtils {
    * FUNCTION PROTOTYPES
    **********************************************************************/
 
-  // seed random number generator (may also do other things in the future)
-  void init_matrix_utils(void);
+  // seed random number generator (may also do other things in the future).
+  //   a negative seed means generate one from the time and process id.
+  //   returns the seed used.
+  long init_matrix_utils(long randomSeed = -1);
 
-  // Generate a sample from a uniform distribution over [0,1].
+  // Generate a sample from a uniform distribution over (0,1), using the
+  //   calling thread's default random stream.
   double unit_rand(void);
 
   // Generate a matrix where each sample is drawn according to unit_rand().
@@ -67,6 +71,10 @@ namespace MatrixUtils {
   int chooseFromDistribution(const dvector& b);
   int chooseFromDistribution(const cvector& b);
 
+  // Same, but draws from the stream rng instead of the thread default.
+  int chooseFromDistribution(const dvector& b, zmdp::RandomStream& rng);
+  int chooseFromDistribution(const cvector& b, zmdp::RandomStream& rng);
+
   // Returns a string representation of b, suitable for hashing
   const char* hashable(const dvector& b);
   const char* hashable(const cvector& b);
@@ -90,18 +98,16 @@ namespace MatrixUtils {
    * FUNCTIONS
    **********************************************************************/
 
-  inline void init_matrix_utils(void)
+  inline long init_matrix_utils(long randomSeed)
   {
-  // Initialize the random number generator
-    srand(time(0));
-    // Seems the random number generator needs to "clear its throat" on some systems.
-    rand();
+    // Initialize the random number generator
+    return zmdp::setRandomSeed(randomSeed);
   }
 
-  // Generate a sample from a uniform distribution over [0,1].
+  // Generate a sample from a uniform distribution over (0,1).
   inline double unit_rand(void)
   {
-    return ((double)std::rand())/RAND_MAX;
+    return zmdp::getThreadRandomStream().unitRand();
   }
 
   // Generate a matrix where each sample is drawn according to unit_rand().
@@ -170,7 +176,15 @@ namespace MatrixUtils {
   // b represents a discrete probability distribution Pr(outcome = i) = b(i).
   // Chooses an outcome according to the distribution.
   inline int chooseFromDistribution(const dvector& b) {
-    double r = unit_rand();
+    return chooseFromDistribution(b, zmdp::getThreadRandomStream());
+  }
+
+  inline int chooseFromDistribution(const cvector& b) {
+    return chooseFromDistribution(b, zmdp::getThreadRandomStream());
+  }
+
+  inline int chooseFromDistribution(const dvector& b, zmdp::RandomStream& rng) {
+    double r = rng.unitRand();
     FOR (i, b.size()) {
       r -= b(i);
       if (r <= 0) return i;
@@ -184,8 +198,8 @@ namespace MatrixUtils {
     return 0;
   }
 
-  inline int chooseFromDistribution(const cvector& b) {
-    double r = unit_rand();
+  inline int chooseFromDistribution(const cvector& b, zmdp::RandomStream& rng) {
+    double r = rng.unitRand();
     FOR_CV(b) {
       r -= CV_VAL(b);
       if (r <= 0) return CV_INDEX(b);
@@ -201,8 +215,9 @@ namespace MatrixUtils {
 
   inline const char* hashable(const dvector& b)
   {
-    static char *buf = NULL;
-    static unsigned int n = 0;
+    // per-thread, so policy evaluation can run alongside the solver
+    static __thread char *buf = NULL;
+    static __thread unsigned int n = 0;
 
     if (b.size() > n) {
       n = b.size();
@@ -220,8 +235,9 @@ namespace MatrixUtils {
 
   inline const char* hashable(const cvector& b)
   {
-    static char *buf = NULL;
-    static unsigned int n = 0;
+    // per-thread, so policy evaluation can run alongside the solver
+    static __thread char *buf = NULL;
+    static __thread unsigned int n = 0;
 
     if (b.size() > n) {
       n = b.size();
@@ -302,6 +318,45 @@ namespace MatrixUtils {
     quantile2 = getQuantile(bvals, (1.0 - alpha/2));
   }
 
+  // Streaming estimate of the mean of a sequence of samples and a 95%
+  // confidence interval for it, updated in constant time per sample
+  // (Welford's method).  Assumes the samples are roughly normal, which
+  // holds for batch means.
+  struct RunningMeanInterval {
+    int n;
+    double mean;
+    double m2; // sum of squared deviations from the mean
+
+    RunningMeanInterval(void) { clear(); }
+    void clear(void) { n = 0; mean = 0; m2 = 0; }
+
+    void add(double x) {
+      n++;
+      double delta = x - mean;
+      mean += delta / n;
+      m2 += delta * (x - mean);
+    }
+
+    double getStdev(void) const {
+      return (n > 1) ? sqrt(m2 / (n-1)) : -1;
+    }
+
+    // half-width of the 95% confidence interval for the mean, using
+    // the Student t distribution.  returns -1 if n < 2.
+    double getConf95HalfWidth(void) const {
+      static const double T975[] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+      };
+      if (n < 2) return -1;
+      int df = n-1;
+      // beyond the table, 1.96 + 2.5/df is within 0.002 of the true value
+      double t = (df <= 30) ? T975[df-1] : (1.96 + 2.5/df);
+      return t * getStdev() / sqrt((double) n);
+    }
+  };
+
   struct IndPair {
     int ind;
     double val;
@@ -0,0 +1,159 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-10 18:02:11 $
+
+ @file    ThreadPool.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "zmdpCommonDefs.h"
+#include "ThreadPool.h"
+
+namespace zmdp {
+
+ThreadPool::ThreadPool(int _numThreads) :
+  numThreads(_numThreads),
+  task(NULL),
+  taskData(NULL),
+  numTasks(0),
+  nextTaskIndex(0),
+  numTasksDone(0),
+  jobId(0),
+  shuttingDown(false)
+{
+  assert(numThreads >= 1);
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&workAvailable, NULL);
+  pthread_cond_init(&workDone, NULL);
+
+  workers.resize(numThreads-1);
+  FOR (i, workers.size()) {
+    int err = pthread_create(&workers[i], NULL, &ThreadPool::workerMain, this);
+    if (0 != err) {
+      fprintf(stderr, "ERROR: couldn't start worker thread: %s\n", strerror(err));
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+ThreadPool::~ThreadPool(void)
+{
+  pthread_mutex_lock(&mutex);
+  shuttingDown = true;
+  pthread_cond_broadcast(&workAvailable);
+  pthread_mutex_unlock(&mutex);
+
+  FOR_EACH (wi, workers) {
+    pthread_join(*wi, NULL);
+  }
+
+  pthread_cond_destroy(&workDone);
+  pthread_cond_destroy(&workAvailable);
+  pthread_mutex_destroy(&mutex);
+}
+
+void ThreadPool::run(int _numTasks, ThreadPoolTask _task, void* _taskData)
+{
+  if (workers.empty() || _numTasks <= 1) {
+    // no point in waking up the workers
+    FOR (i, _numTasks) {
+      (*_task)(_taskData, i);
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&mutex);
+  task = _task;
+  taskData = _taskData;
+  numTasks = _numTasks;
+  nextTaskIndex = 0;
+  numTasksDone = 0;
+  jobId++;
+  pthread_cond_broadcast(&workAvailable);
+
+  // the calling thread pitches in too
+  runTasks();
+
+  while (numTasksDone < numTasks) {
+    pthread_cond_wait(&workDone, &mutex);
+  }
+  task = NULL;
+  pthread_mutex_unlock(&mutex);
+}
+
+// claims and runs tasks from the current job until none are left.  must
+// be called with mutex locked; returns with mutex locked.
+void ThreadPool::runTasks(void)
+{
+  while (nextTaskIndex < numTasks) {
+    int i = nextTaskIndex++;
+    ThreadPoolTask t = task;
+    void* d = taskData;
+
+    pthread_mutex_unlock(&mutex);
+    (*t)(d, i);
+    pthread_mutex_lock(&mutex);
+
+    numTasksDone++;
+    if (numTasksDone == numTasks) {
+      pthread_cond_signal(&workDone);
+    }
+  }
+}
+
+void* ThreadPool::workerMain(void* poolArg)
+{
+  ThreadPool& pool = *((ThreadPool*) poolArg);
+  int lastJobId = 0;
+
+  pthread_mutex_lock(&pool.mutex);
+  while (1) {
+    while (!pool.shuttingDown && pool.jobId == lastJobId) {
+      pthread_cond_wait(&pool.workAvailable, &pool.mutex);
+    }
+    if (pool.shuttingDown) break;
+    lastJobId = pool.jobId;
+    pool.runTasks();
+  }
+  pthread_mutex_unlock(&pool.mutex);
+
+  return NULL;
+}
+
+int ThreadPool::getNumProcessors(void)
+{
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n >= 1) ? ((int) n) : 1;
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
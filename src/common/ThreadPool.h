@@ -0,0 +1,80 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-10 18:02:11 $
+
+ @file    ThreadPool.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCThreadPool_h
+#define INCThreadPool_h
+
+#include <pthread.h>
+
+#include <vector>
+
+namespace zmdp {
+
+// a task function is called once for each index in [0,numTasks) by
+// ThreadPool::run().  calls for different indices may run concurrently,
+// so a task should only write to data that belongs to its own index.
+typedef void (*ThreadPoolTask)(void* taskData, int taskIndex);
+
+// a fixed set of worker threads that execute 'parallel for' loops.  the
+// thread that calls run() also executes tasks, so a pool with
+// numThreads=N starts only N-1 workers.  run() returns only after all
+// tasks have completed, so callers can merge per-task results serially
+// afterward, in a deterministic order.
+struct ThreadPool {
+  int numThreads;
+
+  ThreadPool(int _numThreads);
+  ~ThreadPool(void);
+
+  void run(int numTasks, ThreadPoolTask task, void* taskData);
+
+  // returns the number of processors online, or 1 if unknown
+  static int getNumProcessors(void);
+
+protected:
+  std::vector<pthread_t> workers;
+  pthread_mutex_t mutex;
+  pthread_cond_t workAvailable;
+  pthread_cond_t workDone;
+
+  // the current job, protected by mutex
+  ThreadPoolTask task;
+  void* taskData;
+  int numTasks;
+  int nextTaskIndex;
+  int numTasksDone;
+  int jobId;
+  bool shuttingDown;
+
+  void runTasks(void);
+  static void* workerMain(void* pool);
+};
+
+}; // namespace zmdp
+
+#endif // INCThreadPool_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
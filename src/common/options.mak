@@ -24,6 +24,16 @@ CFLAGS += -DZMDP_VERSION=1.1.7
 
 #CFLAGS += -DUSE_HSVI_ADAPTIVE_DEPTH=1
 
+# storage options for sparse vectors and matrices (see sla.h).
+# ZMDP_COMPACT_STORAGE stores entry values as float instead of double.
+# ZMDP_COMPACT_INDEX stores entry indices in 16 bits, which limits
+# models to 65535 states and observations.  Kernels still accumulate in
+# double precision; run with --validateCompactStorage 1 to see the
+# resulting error bound for a particular model.
+
+#CFLAGS += -DZMDP_COMPACT_STORAGE=1
+#CFLAGS += -DZMDP_COMPACT_INDEX=1
+
 # debug/optimization options
 
 USER_CFLAGS := -O3
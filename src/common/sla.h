@@ -26,6 +26,8 @@
 #include <math.h>
 #include <errno.h>
 #include <string.h>
+#include <float.h>
+#include <limits.h>
 #include <vector>
 #include <iostream>
 #include <fstream>
@@ -39,6 +41,34 @@
 // dmatrix = dense matrix
 // kmatrix = coordinate matrix
 // cmatrix = compressed matrix
+// bcmatrix = block compressed matrix
+
+// Storage types for sparse vector and matrix entries.  By default
+// entries are stored as (unsigned int, double) pairs.  Compile with
+// -DZMDP_COMPACT_STORAGE=1 to store values as float, and with
+// -DZMDP_COMPACT_INDEX=1 to store indices in 16 bits (only usable for
+// models with at most SLA_MAX_INDEX states and observations).  In
+// either case the kernels below accumulate in double precision; only
+// the stored entries lose precision.  See src/common/options.mak.
+#if ZMDP_COMPACT_STORAGE
+typedef float sla_value_t;
+#  define SLA_VALUE_ROUNDOFF (FLT_EPSILON/2)
+#else
+typedef double sla_value_t;
+#  define SLA_VALUE_ROUNDOFF (DBL_EPSILON/2)
+#endif
+
+#if ZMDP_COMPACT_INDEX
+typedef unsigned short sla_index_t;
+#  define SLA_MAX_INDEX (USHRT_MAX)
+// without packing, the entry would be padded back out to the
+// alignment of the value type and the smaller index would buy nothing
+#  define SLA_ENTRY_ATTRIBUTES __attribute__((packed))
+#else
+typedef unsigned int sla_index_t;
+#  define SLA_MAX_INDEX (UINT_MAX)
+#  define SLA_ENTRY_ATTRIBUTES
+#endif
 
 namespace sla {
 
@@ -47,6 +77,7 @@ namespace sla {
   struct dmatrix;
   struct kmatrix;
   struct cmatrix;
+  struct bcmatrix;
 
   /**********************************************************************
    * DVECTOR
@@ -77,8 +108,8 @@ namespace sla {
    **********************************************************************/
 
   struct cvector_entry {
-    unsigned int index;
-    double value;
+    sla_index_t index;
+    sla_value_t value;
 
     cvector_entry(void) {}
     cvector_entry(unsigned int _index,
@@ -86,7 +117,7 @@ namespace sla {
       index(_index),
       value(_value)
     {}
-  };
+  } SLA_ENTRY_ATTRIBUTES;
   
   struct cvector {
     unsigned int size_;
@@ -107,9 +138,21 @@ namespace sla {
     void push_back(unsigned int index, double value);
     void canonicalize(void) {}
     void clear(void) { data.clear(); }
+    // exchanges contents with x without copying or allocating
+    void swap(cvector& x) { std::swap(size_, x.size_); data.swap(x.data); }
 
     void read(std::istream& in);
   };
+
+  // scratch space for the variant of mult() that does not allocate.
+  // values and used are all zero between calls.  once its buffers have
+  // grown to the size of the problem, an accumulator can be reused
+  // indefinitely without further allocation.
+  struct sparse_accumulator {
+    std::vector<double> values;
+    std::vector<char> used;
+    std::vector<unsigned int> indices;
+  };
   
   /**********************************************************************
    * DMATRIX
@@ -193,9 +236,48 @@ namespace sla {
 
     void clear(void) { data.clear(); }
 
+    // number of bytes used to store the matrix
+    size_t get_bytes(void) const;
+
     void read(std::istream& in);
     void write(std::ostream& out) const;
   };
+
+  /**********************************************************************
+   * BCMATRIX
+   **********************************************************************/
+
+  // largest block dimension considered when choosing a block size
+#define SLA_MAX_BLOCK_SIZE (4)
+
+  // like a cmatrix, but the units of storage are dense block_size1 x
+  // block_size2 blocks whose corners lie on multiples of the block
+  // size, so one index is stored per block rather than per entry.  the
+  // blocks of each block column are sorted by block row, and the
+  // entries of a block are stored in column-major order.  matrices made
+  // of small dense blocks (e.g. transitions that leave some state
+  // variables unchanged and randomize others) take less space and
+  // multiply faster in this form.  read-only: build one with copy().
+  struct bcmatrix {
+    unsigned int size1_, size2_;
+    unsigned int block_size1, block_size2;
+    // the blocks of block column j are block_col_starts[j] ...
+    // block_col_starts[j+1]-1
+    std::vector< unsigned int > block_col_starts;
+    std::vector< sla_index_t > block_rows;
+    std::vector< sla_value_t > values;
+
+    bcmatrix(void) : size1_(0), size2_(0), block_size1(1), block_size2(1) {}
+
+    double operator()(unsigned int r, unsigned int c) const;
+
+    unsigned int size1(void) const { return size1_; }
+    unsigned int size2(void) const { return size2_; }
+    unsigned int num_blocks(void) const { return block_rows.size(); }
+    unsigned int block_area(void) const { return block_size1 * block_size2; }
+    // number of bytes used to store the matrix
+    size_t get_bytes(void) const;
+  };
   
   /**********************************************************************
    * NON-MEMBER FUNCTION PROTOTYPES
@@ -214,6 +296,22 @@ namespace sla {
   // result = A (side-effect: canonicalizes A)
   void copy(cmatrix& result, kmatrix& A);
 
+  // result = A, stored in blocks of the given size
+  void copy(bcmatrix& result, const cmatrix& A,
+	    unsigned int block_size1, unsigned int block_size2);
+
+  // result = A, stored in the blocks chosen by choose_block_size()
+  void copy(bcmatrix& result, const cmatrix& A);
+
+  // result = A (side-effect: canonicalizes A)
+  void copy(bcmatrix& result, kmatrix& A);
+
+  // sets block_size1 and block_size2 (each at most SLA_MAX_BLOCK_SIZE)
+  // to the block size that stores A in the fewest bytes.  1 x 1 blocks
+  // mean the cmatrix form is at least as compact.
+  void choose_block_size(unsigned int& block_size1, unsigned int& block_size2,
+			 const cmatrix& A);
+
   // result = A(.,c)
   void copy_from_column(cvector& result, const cmatrix& A, unsigned int c);
 
@@ -245,12 +343,32 @@ namespace sla {
   // result = A * x
   void mult(cvector& result, const cmatrix& A, const cvector& x);
 
+  // result = A * x, using work for temporary storage
+  void mult(cvector& result, const cmatrix& A, const cvector& x,
+	    sparse_accumulator& work);
+
+  // result = A * x, using work for temporary storage.  the result is
+  // identical to that of the cmatrix version.
+  void mult(cvector& result, const bcmatrix& A, const cvector& x,
+	    sparse_accumulator& work);
+
   // result = x * A
   void mult(dvector& result, const dvector& x, const cmatrix& A);
 
   // result = x * A
   void mult(dvector& result, const cvector& x, const cmatrix& A);
 
+  // result = A' * x.  A is stored by columns, so this visits each
+  // column of A once.  use it instead of storing a second, transposed
+  // copy of A just to compute A * x.
+  void mult_transpose(dvector& result, const cmatrix& A, const dvector& x);
+
+  // result = A' * x
+  void mult_transpose(dvector& result, const cmatrix& A, const cvector& x);
+
+  // result = A' * x
+  void mult_transpose(cvector& result, const cmatrix& A, const cvector& x);
+
   // result = x * A [note: if you have transpose(A) available, try
   //   mult(result, A', x) instead; it is often much faster]
   void mult(cvector& result, const cvector& x, const cmatrix& A);
@@ -430,8 +548,11 @@ namespace sla {
     in >> size_;
     in >> num_entries;
     data.resize( num_entries );
+    unsigned int index;
+    double value;
     FOR (i, num_entries) {
-      in >> data[i].index >> data[i].value;
+      in >> index >> value;
+      data[i] = cvector_entry(index, value);
     }
   }
 
@@ -622,6 +743,35 @@ namespace sla {
     }
   }
 
+  inline size_t cmatrix::get_bytes(void) const
+  {
+    return col_starts.size() * sizeof(col_starts[0])
+      + data.size() * sizeof(data[0]);
+  }
+
+  /**********************************************************************
+   * BCMATRIX FUNCTIONS
+   **********************************************************************/
+
+  inline double bcmatrix::operator()(unsigned int r, unsigned int c) const
+  {
+    unsigned int j = c / block_size2;
+    unsigned int br = r / block_size1;
+    typeof(block_rows.begin()) col_start = block_rows.begin() + block_col_starts[j];
+    typeof(block_rows.begin()) col_end   = block_rows.begin() + block_col_starts[j+1];
+    typeof(block_rows.begin()) bi = std::lower_bound(col_start, col_end, br);
+    if (bi == col_end || *bi != br) return 0.0;
+    return values[(bi - block_rows.begin()) * block_area()
+		  + (c - j*block_size2) * block_size1 + (r - br*block_size1)];
+  }
+
+  inline size_t bcmatrix::get_bytes(void) const
+  {
+    return block_col_starts.size() * sizeof(block_col_starts[0])
+      + block_rows.size() * sizeof(block_rows[0])
+      + values.size() * sizeof(values[0]);
+  }
+
   /**********************************************************************
    * NON-MEMBER FUNCTIONS
    **********************************************************************/
@@ -795,7 +945,7 @@ namespace sla {
       for (Ai = A.data.begin() + A.col_starts[xind];
 	   Ai != col_end;
 	   Ai++) {
-	result.data[Ai->index] += xval * Ai->value;
+	result.data[Ai->index] += xval * (double) Ai->value;
       }
     }
   }
@@ -828,7 +978,7 @@ namespace sla {
 	for (Ai = A.data.begin() + A.col_starts[xind];
 	     Ai != col_end;
 	     Ai++) {
-	  tmp.push_back(Ai->index, xval * Ai->value);
+	  tmp.push_back(Ai->index, xval * (double) Ai->value);
 	}
 	accum += tmp;
       }
@@ -847,6 +997,250 @@ namespace sla {
     }
   }
   
+  // result = A * x, using work for temporary storage.  the cost is
+  // proportional to the number of entries of A touched, rather than the
+  // size of the result, and no memory is allocated once work and
+  // result have grown large enough.
+  inline void mult(cvector& result,
+		   const cmatrix& A,
+		   const cvector& x,
+		   sparse_accumulator& work)
+  {
+    typeof(A.data.begin()) Ai, col_end;
+    int xind;
+    double xval;
+
+    if (work.values.size() < A.size1()) {
+      work.values.resize(A.size1(), 0.0);
+      work.used.resize(A.size1(), 0);
+    }
+    work.indices.clear();
+
+    FOR_EACH (xi, x.data) {
+      xind = xi->index;
+      xval = xi->value;
+      col_end = A.data.begin() + A.col_starts[xind+1];
+      for (Ai = A.data.begin() + A.col_starts[xind];
+	   Ai != col_end;
+	   Ai++) {
+	if (!work.used[Ai->index]) {
+	  work.used[Ai->index] = 1;
+	  work.indices.push_back(Ai->index);
+	}
+	work.values[Ai->index] += xval * (double) Ai->value;
+      }
+    }
+
+    std::sort(work.indices.begin(), work.indices.end());
+    result.resize(A.size1());
+    FOR_EACH (ii, work.indices) {
+      double val = work.values[*ii];
+      if (fabs(val) > SPARSE_EPS) {
+	result.push_back(*ii, val);
+      }
+      work.values[*ii] = 0.0;
+      work.used[*ii] = 0;
+    }
+  }
+
+  // returns the number of blocks needed to store A in blocks of the
+  // given size.  the entries of mark must all be zero, and are zero
+  // again on return.
+  inline unsigned int count_blocks(const cmatrix& A,
+				   unsigned int block_size1, unsigned int block_size2,
+				   std::vector<char>& mark,
+				   std::vector<unsigned int>& rows)
+  {
+    unsigned int num_blocks = 0;
+    for (unsigned int c0 = 0; c0 < A.size2(); c0 += block_size2) {
+      unsigned int c_end = std::min(c0 + block_size2, A.size2());
+      rows.clear();
+      for (unsigned int c = c0; c < c_end; c++) {
+	for (unsigned int i = A.col_starts[c]; i < A.col_starts[c+1]; i++) {
+	  unsigned int br = A.data[i].index / block_size1;
+	  if (!mark[br]) {
+	    mark[br] = 1;
+	    rows.push_back(br);
+	  }
+	}
+      }
+      num_blocks += rows.size();
+      FOR_EACH (ri, rows) {
+	mark[*ri] = 0;
+      }
+    }
+    return num_blocks;
+  }
+
+  inline void choose_block_size(unsigned int& block_size1, unsigned int& block_size2,
+				const cmatrix& A)
+  {
+    std::vector<char> mark(A.size1(), 0);
+    std::vector<unsigned int> rows;
+    size_t best_bytes = 0;
+    block_size1 = block_size2 = 1;
+    for (unsigned int bs1 = 1; bs1 <= SLA_MAX_BLOCK_SIZE; bs1++) {
+      for (unsigned int bs2 = 1; bs2 <= SLA_MAX_BLOCK_SIZE; bs2++) {
+	size_t bytes = count_blocks(A, bs1, bs2, mark, rows)
+	  * (sizeof(sla_index_t) + bs1 * bs2 * sizeof(sla_value_t))
+	  + ((A.size2() + bs2 - 1) / bs2 + 1) * sizeof(unsigned int);
+	if (1 == bs1 * bs2 || bytes < best_bytes) {
+	  best_bytes = bytes;
+	  block_size1 = bs1;
+	  block_size2 = bs2;
+	}
+      }
+    }
+  }
+
+  inline void copy(bcmatrix& result, const cmatrix& A,
+		   unsigned int block_size1, unsigned int block_size2)
+  {
+    assert(1 <= block_size1 && block_size1 <= SLA_MAX_BLOCK_SIZE);
+    assert(1 <= block_size2 && block_size2 <= SLA_MAX_BLOCK_SIZE);
+    unsigned int num_block_rows = (A.size1() + block_size1 - 1) / block_size1;
+    unsigned int num_block_cols = (A.size2() + block_size2 - 1) / block_size2;
+    unsigned int area = block_size1 * block_size2;
+
+    result.size1_ = A.size1();
+    result.size2_ = A.size2();
+    result.block_size1 = block_size1;
+    result.block_size2 = block_size2;
+    result.block_col_starts.resize(num_block_cols + 1);
+    result.block_rows.clear();
+    result.values.clear();
+
+    // slot[br] is the index of the block in block row br of the current
+    // block column, or -1
+    std::vector<int> slot(num_block_rows, -1);
+    std::vector<unsigned int> rows;
+    FOR (j, num_block_cols) {
+      unsigned int c0 = j * block_size2;
+      unsigned int c_end = std::min(c0 + block_size2, A.size2());
+
+      rows.clear();
+      for (unsigned int c = c0; c < c_end; c++) {
+	for (unsigned int i = A.col_starts[c]; i < A.col_starts[c+1]; i++) {
+	  unsigned int br = A.data[i].index / block_size1;
+	  if (-1 == slot[br]) {
+	    slot[br] = 0;
+	    rows.push_back(br);
+	  }
+	}
+      }
+      std::sort(rows.begin(), rows.end());
+
+      result.block_col_starts[j] = result.block_rows.size();
+      FOR_EACH (ri, rows) {
+	slot[*ri] = result.block_rows.size();
+	result.block_rows.push_back(*ri);
+      }
+      result.values.resize(result.block_rows.size() * area, 0.0);
+
+      for (unsigned int c = c0; c < c_end; c++) {
+	for (unsigned int i = A.col_starts[c]; i < A.col_starts[c+1]; i++) {
+	  unsigned int r = A.data[i].index;
+	  unsigned int br = r / block_size1;
+	  result.values[slot[br] * area + (c - c0) * block_size1 + (r - br * block_size1)]
+	    = A.data[i].value;
+	}
+      }
+
+      FOR_EACH (ri, rows) {
+	slot[*ri] = -1;
+      }
+    }
+    result.block_col_starts[num_block_cols] = result.block_rows.size();
+  }
+
+  inline void copy(bcmatrix& result, const cmatrix& A)
+  {
+    unsigned int block_size1, block_size2;
+    choose_block_size(block_size1, block_size2, A);
+    copy(result, A, block_size1, block_size2);
+  }
+
+  inline void copy(bcmatrix& result, kmatrix& A)
+  {
+    cmatrix tmp;
+    copy(tmp, A);
+    copy(result, tmp);
+  }
+
+  // adds xval times column k of each block in block column j of A to
+  // work, whose used and indices fields are kept per block row.  the
+  // block height is a template parameter so that the inner loop is
+  // unrolled and can be vectorized.
+  template <unsigned int BS1>
+  inline void mult_block_column(sparse_accumulator& work, const bcmatrix& A,
+				unsigned int j, unsigned int k, double xval)
+  {
+    const unsigned int area = BS1 * A.block_size2;
+    const unsigned int b_end = A.block_col_starts[j+1];
+    const sla_value_t* block = &A.values[0] + A.block_col_starts[j] * area + k * BS1;
+    double* values = &work.values[0];
+    for (unsigned int b = A.block_col_starts[j]; b < b_end; b++, block += area) {
+      unsigned int br = A.block_rows[b];
+      if (!work.used[br]) {
+	work.used[br] = 1;
+	work.indices.push_back(br);
+      }
+      double* y = values + br * BS1;
+      for (unsigned int i = 0; i < BS1; i++) {
+	y[i] += xval * (double) block[i];
+      }
+    }
+  }
+
+  // result = A * x, using work for temporary storage
+  inline void mult(cvector& result,
+		   const bcmatrix& A,
+		   const cvector& x,
+		   sparse_accumulator& work)
+  {
+    const unsigned int bs1 = A.block_size1;
+    const unsigned int bs2 = A.block_size2;
+    unsigned int padded_size = ((A.size1() + bs1 - 1) / bs1) * bs1;
+    if (work.values.size() < padded_size) {
+      work.values.resize(padded_size, 0.0);
+      work.used.resize(padded_size, 0);
+    }
+    work.indices.clear();
+    result.resize(A.size1());
+    if (A.values.empty()) return;
+
+    FOR_EACH (xi, x.data) {
+      unsigned int j = xi->index / bs2;
+      unsigned int k = xi->index - j * bs2;
+      double xval = xi->value;
+      switch (bs1) {
+      case 1: mult_block_column<1>(work, A, j, k, xval); break;
+      case 2: mult_block_column<2>(work, A, j, k, xval); break;
+      case 3: mult_block_column<3>(work, A, j, k, xval); break;
+      case 4: mult_block_column<4>(work, A, j, k, xval); break;
+      default: assert(0); // never reach this point
+      }
+    }
+
+    // the zero entries of the blocks only add zeros, so after small
+    // values are dropped the result is identical to the cmatrix version
+    std::sort(work.indices.begin(), work.indices.end());
+    FOR_EACH (ii, work.indices) {
+      unsigned int r0 = *ii * bs1;
+      unsigned int r_end = std::min(r0 + bs1, A.size1());
+      for (unsigned int r = r0; r < r_end; r++) {
+	double val = work.values[r];
+	if (fabs(val) > SPARSE_EPS) {
+	  result.push_back(r, val);
+	}
+      }
+      for (unsigned int r = r0; r < r0 + bs1; r++) {
+	work.values[r] = 0.0;
+      }
+      work.used[*ii] = 0;
+    }
+  }
+
   // result = x * A
   inline void mult(dvector& result, const dvector& x, const cmatrix& A)
   {
@@ -859,7 +1253,7 @@ namespace sla {
       col_end = A.data.begin() + A.col_starts[c+1];
       for (Ai = A.data.begin() + A.col_starts[c];
 	   Ai != col_end; Ai++) {
-	result(c) += x(Ai->index) * Ai->value;
+	result(c) += x(Ai->index) * (double) Ai->value;
       }
     }
   }
@@ -883,6 +1277,27 @@ namespace sla {
     copy(result,tmp);
   }
 
+  // result = A' * x
+  inline void mult_transpose(dvector& result, const cmatrix& A,
+			     const dvector& x)
+  {
+    mult(result, x, A);
+  }
+
+  // result = A' * x
+  inline void mult_transpose(dvector& result, const cmatrix& A,
+			     const cvector& x)
+  {
+    mult(result, x, A);
+  }
+
+  // result = A' * x
+  inline void mult_transpose(cvector& result, const cmatrix& A,
+			     const cvector& x)
+  {
+    mult(result, x, A);
+  }
+
   // result = x .* y [for all i, result(i) = x(i) * y(i)]
   inline void emult(dvector& result, const dvector& x, const dvector& y)
   {
@@ -905,7 +1320,7 @@ namespace sla {
 	if (yi == yend) return;
 	if (yi->index >= xi->index) {
 	  if (yi->index == xi->index) {
-	    result.push_back( xi->index, xi->value * yi->value);
+	    result.push_back( xi->index, ((double) xi->value) * yi->value);
 	  }
 	  break;
 	}
@@ -950,7 +1365,7 @@ namespace sla {
     int yind;
     for (T yi = ybegin; yi != yend; yi++) {
       yind = yi->index;
-      result(yind) = x(yind) * yi->value;
+      result(yind) = x(yind) * (double) yi->value;
     }
   }
 
@@ -1010,7 +1425,7 @@ namespace sla {
     assert( x.size() == y.size() );
     double sum = 0.0;
     FOR_EACH (yi, y.data) {
-      sum += x(yi->index) * yi->value;
+      sum += x(yi->index) * (double) yi->value;
     }
     return sum;
   }
@@ -1027,7 +1442,7 @@ namespace sla {
 	if (yi == yend) return sum;
 	if (yi->index >= xi->index) {
 	  if (yi->index == xi->index) {
-	    sum += xi->value * yi->value;
+	    sum += ((double) xi->value) * yi->value;
 	  }
 	  break;
 	}
@@ -1098,7 +1513,7 @@ namespace sla {
 	xi++;
 	CHECK_X();
       } else if (xind == yind) {
-	result.push_back( xind, xi->value + yi->value );
+	result.push_back( xind, ((double) xi->value) + yi->value );
 	xi++;
 	yi++;
 	CHECK_X();
@@ -1166,7 +1581,7 @@ namespace sla {
 	xi++;
 	CHECK_X();
       } else if (xind == yind) {
-	result.push_back( xind, xi->value - yi->value );
+	result.push_back( xind, ((double) xi->value) - yi->value );
 	xi++;
 	yi++;
 	CHECK_X();
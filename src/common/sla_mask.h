@@ -54,6 +54,14 @@ namespace sla {
 		 const cvector& x,
 		 const mvector& m);
 
+  // for all i: result(i) = m(i) ? (A' * x)(i) : 0.  each (A' * x)(i) is
+  // the dot product of column i of A with x, so only the columns of A
+  // selected by m are visited.
+  void mask_mult_transpose(cvector& result,
+			   const cmatrix& A,
+			   const cvector& x,
+			   const mvector& m);
+
   // return true if [ym is a subset of xm] and [for all i: x(i) >= y(i) - eps]
   bool mask_dominates(const cvector& x, const cvector& y, double eps,
 		      const mvector& xm, const mvector& ym);
@@ -154,6 +162,26 @@ namespace sla {
     result.canonicalize();
   }
 
+  // for all i: result(i) = m(i) ? (A' * x)(i) : 0
+  inline void mask_mult_transpose(cvector& result,
+				  const cmatrix& A,
+				  const cvector& x,
+				  const mvector& m)
+  {
+    assert( A.size1() == x.size() );
+    assert( A.size2() == m.size() );
+    double val;
+
+    result.resize( A.size2() );
+    FOR_EACH (mi, m.data) {
+      val = inner_prod_column( A, mi->index, x );
+      if (0 != val) {
+	result.push_back( mi->index, val );
+      }
+    }
+    result.canonicalize();
+  }
+
   // return true if [ym is a subset of xm] and [for all i: x(i) >= y(i) - eps]
   inline bool mask_dominates(const cvector& x, const cvector& y, double eps,
 			     const mvector& xm, const mvector& ym)
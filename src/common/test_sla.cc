@@ -451,6 +451,66 @@ void test_mask(void)
        << " " << zm(6) << endl;
 }
 
+void test_bcmatrix(void)
+{
+  // 8 x 8 matrix made of four dense 2 x 2 blocks
+  kmatrix Ak(8,8);
+  double val = 1;
+  int blockCorners[] = { 0,0, 4,2, 2,4, 6,6 };
+  FOR (b, 4) {
+    FOR (c, 2) {
+      FOR (r, 2) {
+	Ak.push_back(blockCorners[2*b] + r, blockCorners[2*b+1] + c, val++);
+      }
+    }
+  }
+  cmatrix Ac;
+  copy( Ac, Ak );
+
+  bcmatrix Ab;
+  copy( Ab, Ak );
+  cout << "--Ab: block_size=2 2 num_blocks=4 data=4 7 0 12" << endl;
+  cout << "  Ab: block_size=" << Ab.block_size1 << " " << Ab.block_size2
+       << " num_blocks=" << Ab.num_blocks()
+       << " data=" << Ab(1,1) << " " << Ab(4,3)
+       << " " << Ab(3,3) << " " << Ab(3,5) << endl;
+
+  istringstream iss("8 " "3 " "0 0.5 " "3 0.25 " "5 0.25 ");
+  cvector xc;
+  xc.read(iss);
+
+  sparse_accumulator work;
+  cvector yc, yb;
+  mult( yc, Ac, xc, work );
+  mult( yb, Ab, xc, work );
+  cout << "--yb: filled=6 data=0.5 1 2.75 3 1.75 2 0" << endl;
+  cout << "  yb: filled=" << yb.filled()
+       << " data=" << yb(0) << " " << yb(1)
+       << " " << yb(2) << " " << yb(3) << " " << yb(4)
+       << " " << yb(5) << " " << yb(6) << endl;
+
+  bool same = (yc.filled() == yb.filled());
+  FOR (i, yc.filled()) {
+    same = same && (yc.data[i].index == yb.data[i].index)
+      && (yc.data[i].value == yb.data[i].value);
+  }
+  cout << "--same as cmatrix: 1" << endl;
+  cout << "  same as cmatrix: " << same << endl;
+
+  // a permutation matrix has no dense blocks
+  cmatrix Pc;
+  Pc.resize(4,4);
+  Pc.push_back(2,0,1);
+  Pc.push_back(0,1,1);
+  Pc.push_back(3,2,1);
+  Pc.push_back(1,3,1);
+  Pc.canonicalize();
+  unsigned int bs1, bs2;
+  choose_block_size( bs1, bs2, Pc );
+  cout << "--P block_size: 1 1" << endl;
+  cout << "  P block_size: " << bs1 << " " << bs2 << endl;
+}
+
 void test_performance(void)
 {
   cmatrix T;
@@ -521,6 +581,7 @@ int main(int argc, char** argv) {
   test_unary();
   test_binary();
   test_mask();
+  test_bcmatrix();
 
   test_performance();
 
@@ -0,0 +1,122 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    zmdpLogToText.cc
+ @brief   Converts a binary log to the text form ZMDP writes when
+          useBinaryLogs=0.
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <errno.h>
+#include <string.h>
+
+#include <iostream>
+#include <fstream>
+
+#include "zmdpCommonDefs.h"
+#include "BinaryLog.h"
+
+using namespace std;
+using namespace zmdp;
+
+void doit(const char* inFileName, const char* outFileName)
+{
+  BinaryLogReader in(inFileName);
+
+  ofstream outFile;
+  if (0 != strcmp(outFileName, "-")) {
+    outFile.open(outFileName);
+    if (!outFile) {
+      fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
+	      outFileName, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+  ostream& out = outFile.is_open() ? outFile : cout;
+
+  writeTextLogHeader(out, in.kind);
+  BinaryLogRecord rec;
+  while (in.next(rec)) {
+    writeTextLogRecord(out, rec);
+  }
+}
+
+void usage(const char* binaryName)
+{
+  cerr <<
+    "usage: " << binaryName << " OPTIONS <in.log> [<out.log>]\n"
+    "  -h or --help    Display this help\n"
+    "\n"
+    "Converts a simulation trace, state index or backups log written with\n"
+    "useBinaryLogs=1 to the text form written with useBinaryLogs=0.  Writes\n"
+    "to standard output if <out.log> is not given.\n";
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  static char shortOptions[] = "h";
+  static struct option longOptions[]={
+    {"help",          0,NULL,'h'},
+    {NULL,0,0,0}
+  };
+
+  while (1) {
+    char optchar = getopt_long(argc,argv,shortOptions,longOptions,NULL);
+    if (optchar == -1) break;
+
+    switch (optchar) {
+    case 'h': // help
+      usage(argv[0]);
+      break;
+
+    case '?': // unknown option
+    case ':': // option with missing parameter
+      // getopt() prints an informative error message
+      cerr << endl;
+      usage(argv[0]);
+      break;
+    default:
+      abort(); // never reach this point
+    }
+  }
+  int numArgs = argc-optind;
+  if (1 != numArgs && 2 != numArgs) {
+    cerr << "ERROR: wrong number of arguments (should be 1 or 2)" << endl << endl;
+    usage(argv[0]);
+  }
+
+  const char* inFileName = argv[optind++];
+  const char* outFileName = (2 == numArgs) ? argv[optind++] : "-";
+
+  doit(inFileName, outFileName);
+}
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,172 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    zmdpRandom.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpRandom.h"
+
+namespace zmdp {
+
+/**********************************************************************
+ * LOCAL HELPER FUNCTIONS
+ **********************************************************************/
+
+// splitmix64, used to expand a 64-bit seed into generator state (as
+// recommended by the xoshiro authors)
+static uint64_t splitMix64(uint64_t& x)
+{
+  uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/**********************************************************************
+ * RANDOM STREAM
+ **********************************************************************/
+
+RandomStream::RandomStream(void)
+{
+  seed(0, ZMDP_RS_MAIN);
+}
+
+RandomStream::RandomStream(uint64_t seedValue, uint64_t streamId)
+{
+  seed(seedValue, streamId);
+}
+
+void RandomStream::seed(uint64_t seedValue, uint64_t streamId)
+{
+  uint64_t x = seedValue;
+  uint64_t y = streamId;
+  uint64_t z = splitMix64(x) ^ splitMix64(y);
+  FOR (i, 4) {
+    s[i] = splitMix64(z);
+  }
+}
+
+RandomStream RandomStream::split(void)
+{
+  RandomStream child = *this;
+  jump();
+  return child;
+}
+
+void RandomStream::jump(void)
+{
+  static const uint64_t JUMP[] = {
+    0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+  };
+
+  uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  FOR (i, 4) {
+    FOR (b, 64) {
+      if (JUMP[i] & (((uint64_t) 1) << b)) {
+	s0 ^= s[0];
+	s1 ^= s[1];
+	s2 ^= s[2];
+	s3 ^= s[3];
+      }
+      nextInt();
+    }
+  }
+  s[0] = s0;
+  s[1] = s1;
+  s[2] = s2;
+  s[3] = s3;
+}
+
+/**********************************************************************
+ * PER-THREAD STREAMS
+ **********************************************************************/
+
+static long randomSeedG = 0;
+static pthread_mutex_t randomMutexG = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t nextThreadStreamIdG = ZMDP_RS_FIRST_THREAD;
+static pthread_key_t threadStreamKeyG;
+static pthread_once_t threadStreamKeyOnceG = PTHREAD_ONCE_INIT;
+
+static void deleteThreadStream(void* rs)
+{
+  delete ((RandomStream*) rs);
+}
+
+static void createThreadStreamKey(void)
+{
+  pthread_key_create(&threadStreamKeyG, &deleteThreadStream);
+}
+
+long setRandomSeed(long seedValue)
+{
+  if (seedValue < 0) {
+    seedValue = (((long) time(NULL)) ^ (((long) getpid()) << 16)) & 0x7fffffffL;
+  }
+
+  pthread_mutex_lock(&randomMutexG);
+  randomSeedG = seedValue;
+  nextThreadStreamIdG = ZMDP_RS_FIRST_THREAD;
+  pthread_mutex_unlock(&randomMutexG);
+
+  getThreadRandomStream().seed(seedValue, ZMDP_RS_MAIN);
+
+  return seedValue;
+}
+
+long getRandomSeed(void)
+{
+  pthread_mutex_lock(&randomMutexG);
+  long result = randomSeedG;
+  pthread_mutex_unlock(&randomMutexG);
+  return result;
+}
+
+RandomStream& getThreadRandomStream(void)
+{
+  pthread_once(&threadStreamKeyOnceG, &createThreadStreamKey);
+  RandomStream* rs = (RandomStream*) pthread_getspecific(threadStreamKeyG);
+  if (NULL == rs) {
+    pthread_mutex_lock(&randomMutexG);
+    rs = new RandomStream(randomSeedG, nextThreadStreamIdG++);
+    pthread_mutex_unlock(&randomMutexG);
+    pthread_setspecific(threadStreamKeyG, rs);
+  }
+  return *rs;
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,114 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    zmdpRandom.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCzmdpRandom_h
+#define INCzmdpRandom_h
+
+#include <stdint.h>
+
+namespace zmdp {
+
+// stream ids for RandomStream::seed().  streams seeded with the same
+// seed but different ids are statistically independent, so giving each
+// consumer its own id keeps, for instance, the search trajectory from
+// depending on how many random numbers policy evaluation used.
+enum RandomStreamIdsEnum {
+  ZMDP_RS_MAIN        = 0,
+  ZMDP_RS_SEARCH      = 1,
+  // portfolio member i searches with stream ZMDP_RS_FIRST_PORTFOLIO_MEMBER + i
+  ZMDP_RS_FIRST_PORTFOLIO_MEMBER = 100,
+  // per-thread default streams are assigned ids starting here
+  ZMDP_RS_FIRST_THREAD = 1000,
+  // with common random numbers, policy evaluation trial i uses stream
+  // ZMDP_RS_FIRST_EVAL_TRIAL + i
+  ZMDP_RS_FIRST_EVAL_TRIAL = 0x40000000
+};
+
+// RandomStream is a xoshiro256** generator: 256 bits of state, period
+// 2^256-1, and fast enough to call once per simulated step.  Each
+// stream is independent of all others, so there is no locking.
+struct RandomStream {
+  uint64_t s[4];
+
+  RandomStream(void);
+  RandomStream(uint64_t seedValue, uint64_t streamId);
+
+  void seed(uint64_t seedValue, uint64_t streamId);
+
+  // returns 64 uniformly random bits
+  uint64_t nextInt(void) {
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  // returns a sample from the uniform distribution over the open
+  // interval (0,1), with 53 bits of resolution
+  double unitRand(void) {
+    return (((double) (nextInt() >> 11)) + 0.5) * (1.0 / 9007199254740992.0);
+  }
+
+  // returns a sample from the uniform distribution over {0, ..., n-1}
+  int uniformInt(int n) {
+    return (int) (unitRand() * n);
+  }
+
+  // returns a new stream that will not overlap with this one for 2^128
+  // draws, and advances this stream past it.  deterministic: the k'th
+  // split of a stream is always the same.
+  RandomStream split(void);
+
+  // advances the stream by 2^128 draws
+  void jump(void);
+
+protected:
+  static uint64_t rotl(const uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+};
+
+// sets the global seed.  if seedValue is negative, a seed is generated
+// from the time and process id.  also reseeds the calling thread's
+// default stream.  returns the seed actually used.
+long setRandomSeed(long seedValue);
+long getRandomSeed(void);
+
+// returns the default stream for the calling thread, creating it if
+// necessary.  the first call in a thread other than the one that called
+// setRandomSeed() assigns the thread the next free stream id.
+RandomStream& getThreadRandomStream(void);
+
+}; // namespace zmdp
+
+#endif // INCzmdpRandom_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -115,9 +115,8 @@ int BoundPairExec::chooseAction(void)
 
 void BoundPairExec::advanceToNextState(int a, int o)
 {
-  state_vector nextState;
-  mdp->getNextState(nextState, currentState, a, o);
-  currentState = nextState;
+  mdp->getNextState(nextState, currentState, a, o, workspace);
+  currentState.swap(nextState);
 }
 
 void BoundPairExec::setBelief(const belief_vector& b)
@@ -0,0 +1,68 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    FSCExec.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#include "zmdpCommonDefs.h"
+#include "FSCExec.h"
+
+namespace zmdp {
+
+FSCExec::FSCExec(void) :
+  currentNode(-1)
+{}
+
+void FSCExec::initReadFile(const std::string& policyFileName)
+{
+  fsc.readFromFile(policyFileName);
+  currentNode = -1;
+}
+
+void FSCExec::setToInitialState(void)
+{
+  currentNode = fsc.startNode;
+}
+
+int FSCExec::chooseAction(void)
+{
+  return fsc.actions[currentNode];
+}
+
+void FSCExec::advanceToNextState(int a, int o)
+{
+  currentNode = fsc.getSuccessor(currentNode, o);
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,66 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    FSCExec.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCFSCExec_h
+#define INCFSCExec_h
+
+/**********************************************************************
+ * INCLUDES
+ **********************************************************************/
+
+#include <string>
+
+#include "MDPExec.h"
+#include "FiniteStateController.h"
+
+/**********************************************************************
+ * CLASSES
+ **********************************************************************/
+
+namespace zmdp {
+
+// executes a policy compiled into a FiniteStateController.  each step
+// is a table lookup; no belief is tracked.
+struct FSCExec : public MDPExecCore {
+  FiniteStateController fsc;
+  int currentNode;
+
+  FSCExec(void);
+
+  void initReadFile(const std::string& policyFileName);
+
+  // implement MDPExecCore virtual methods
+  void setToInitialState(void);
+  int chooseAction(void);
+  void advanceToNextState(int a, int o);
+  bool getActionDependsOnlyOnState(void) const { return false; }
+};
+
+}; // namespace zmdp
+
+#endif // INCFSCExec_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
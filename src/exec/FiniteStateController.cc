@@ -0,0 +1,359 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    FiniteStateController.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include <iostream>
+#include <fstream>
+#include <map>
+
+#include "zmdpCommonDefs.h"
+#include "MatrixUtils.h"
+#include "FiniteStateController.h"
+
+using namespace std;
+using namespace MatrixUtils;
+using namespace sla;
+
+namespace zmdp {
+
+/**********************************************************************
+ * LOCAL HELPER FUNCTIONS
+ **********************************************************************/
+
+static std::string stripWhiteSpace(const std::string& s)
+{
+  string::size_type p1, p2;
+  p1 = s.find_first_not_of(" \t");
+  if (string::npos == p1) {
+    return "";
+  } else {
+    p2 = s.find_last_not_of(" \t")+1;
+    return s.substr(p1, p2-p1);
+  }
+}
+
+/**********************************************************************
+ * FINITE STATE CONTROLLER
+ **********************************************************************/
+
+FiniteStateController::FiniteStateController(void) :
+  numObservations(0),
+  startNode(0)
+{}
+
+void FiniteStateController::compileFromPlanes(const Pomdp* pomdp,
+					      const MaxPlanesLowerBound* lb)
+{
+  numObservations = pomdp->getNumObservations();
+  startNode = 0;
+  actions.clear();
+  successors.clear();
+
+  std::map<const LBPlane*, int> nodeOfPlane;
+  std::vector<belief_vector> witnesses;
+
+  // the start node
+  const LBPlane* plane = &lb->getBestLBPlaneConst(pomdp->getInitialBelief());
+  nodeOfPlane[plane] = 0;
+  actions.push_back(plane->action);
+  witnesses.push_back(pomdp->getInitialBelief());
+
+  // expand nodes in the order they were created, which adds any new
+  // successor nodes to the end of the list
+  obs_prob_vector opv;
+  belief_vector nextBelief;
+  for (int n=0; n < (int) actions.size(); n++) {
+    int a = actions[n];
+    pomdp->getObsProbVector(opv, witnesses[n], a);
+    FOR (o, numObservations) {
+      int next;
+      if (opv(o) > OBS_IS_ZERO_EPS) {
+	pomdp->getNextBelief(nextBelief, witnesses[n], a, o);
+	plane = &lb->getBestLBPlaneConst(nextBelief);
+	typeof(nodeOfPlane.begin()) pr = nodeOfPlane.find(plane);
+	if (nodeOfPlane.end() == pr) {
+	  next = actions.size();
+	  nodeOfPlane[plane] = next;
+	  actions.push_back(plane->action);
+	  witnesses.push_back(nextBelief);
+	} else {
+	  next = pr->second;
+	}
+      } else {
+	// impossible to see this observation from the witness belief;
+	// as in getNewLBPlaneQ(), stay with the current plane
+	next = n;
+      }
+      successors.push_back(next);
+    }
+  }
+}
+
+int FiniteStateController::evaluate(std::vector<dvector>& values,
+				    const Pomdp* pomdp,
+				    double maxResidual,
+				    int maxIterations) const
+{
+  int numStates = pomdp->numStates;
+  double discount = pomdp->getDiscount();
+
+  values.resize(getNumNodes());
+  FOR (n, getNumNodes()) {
+    values[n].resize(numStates);
+  }
+
+  // Gauss-Seidel sweeps of the backup
+  //   V_n(s) = R(s,a) + discount * sum_s' T(s,a,s') w_n(s'),
+  //   w_n(s') = sum_o O(s',a,o) V_succ(n,o)(s')
+  dvector w(numStates);
+  int iter;
+  for (iter=0; iter < maxIterations; iter++) {
+    double residual = 0;
+    FOR (n, getNumNodes()) {
+      int a = actions[n];
+      const cmatrix& Oa = pomdp->O[a];
+      const cmatrix& Ttra = pomdp->Ttr[a];
+
+      set_to_zero(w);
+      FOR (o, numObservations) {
+	const dvector& vnext = values[getSuccessor(n, o)];
+	FOR_CM_MINOR (o, Oa) {
+	  int sp = CM_ROW(o, Oa);
+	  w(sp) += CM_VAL(Oa) * vnext(sp);
+	}
+      }
+
+      dvector& vn = values[n];
+      FOR (s, numStates) {
+	double sum = 0;
+	FOR_CM_MINOR (s, Ttra) {
+	  sum += CM_VAL(Ttra) * w(CM_ROW(s, Ttra));
+	}
+	double val = pomdp->R(s,a) + discount * sum;
+	residual = std::max(residual, fabs(val - vn(s)));
+	vn(s) = val;
+      }
+    }
+    if (residual < maxResidual) {
+      iter++;
+      break;
+    }
+  }
+
+  return iter;
+}
+
+void FiniteStateController::expandObservations(const std::vector<int>& originalToReducedObs)
+{
+  int numOrigObs = originalToReducedObs.size();
+  std::vector<int> origSuccessors(getNumNodes() * numOrigObs);
+  FOR (n, getNumNodes()) {
+    FOR (o, numOrigObs) {
+      origSuccessors[n*numOrigObs + o] = getSuccessor(n, originalToReducedObs[o]);
+    }
+  }
+  successors.swap(origSuccessors);
+  numObservations = numOrigObs;
+}
+
+// as with MaxPlanesLowerBound, the controller is written to a temporary
+// file that is renamed into place when complete
+void FiniteStateController::writeToFile(const std::string& outFileName) const
+{
+  std::string tmpFileName = outFileName + ".tmp";
+  ofstream out(tmpFileName.c_str());
+  if (!out) {
+    cerr << "ERROR: FiniteStateController::writeToFile: couldn't open " << tmpFileName
+	 << " for writing: " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  out <<
+"# This file is a POMDP policy, represented as a finite-state controller.\n"
+"# The controller starts in startNode.  At each step, it executes the\n"
+"# action of its current node, then moves to the successor node\n"
+"# corresponding to the observation received.  Each line of the nodes\n"
+"# list has the form:\n"
+"#\n"
+"#   <node>, <action>, <successor for obs 0>, <successor for obs 1>, ...\n"
+"\n"
+    ;
+  out << "{" << endl;
+  out << "  policyType => \"FiniteStateController\"," << endl;
+  out << "  numNodes => " << getNumNodes() << "," << endl;
+  out << "  numObservations => " << numObservations << "," << endl;
+  out << "  startNode => " << startNode << "," << endl;
+  out << "  nodes => [" << endl;
+  FOR (n, getNumNodes()) {
+    out << "    " << n << ", " << actions[n];
+    FOR (o, numObservations) {
+      out << ", " << getSuccessor(n, o);
+    }
+    if (((int) n)+1 < getNumNodes()) {
+      out << ",";
+    }
+    out << endl;
+  }
+  out << "  ]" << endl;
+  out << "}" << endl;
+
+  out.close();
+  if (!out) {
+    cerr << "ERROR: FiniteStateController::writeToFile: couldn't write " << tmpFileName
+	 << ": " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (0 != rename(tmpFileName.c_str(), outFileName.c_str())) {
+    cerr << "ERROR: FiniteStateController::writeToFile: couldn't rename " << tmpFileName
+	 << " to " << outFileName << ": " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+void FiniteStateController::readFromFile(const std::string& inFileName)
+{
+  ifstream inFile(inFileName.c_str());
+  if (!inFile) {
+    cerr << "ERROR: couldn't open " << inFileName << " for reading: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::string line, s;
+  int numNodes = -1;
+  bool sawPolicyType = false;
+  int lnum = 0;
+  numObservations = -1;
+  startNode = 0;
+  actions.clear();
+  successors.clear();
+  while (1) {
+    // a node line holds one successor per observation, so lines can be
+    // arbitrarily long
+    if (!std::getline(inFile, line)) {
+      if (inFile.eof() && !inFile.bad()) break;
+      fprintf(stderr, "ERROR: %s: line %d: read failed\n",
+	      inFileName.c_str(), lnum+1);
+      exit(EXIT_FAILURE);
+    }
+    lnum++;
+
+    // strip whitespace, ignore empty lines and comments
+    s = stripWhiteSpace(line);
+    if (0 == s.size()) continue;
+    if ('#' == s[0]) continue;
+
+    if (s == "{") continue;
+    if (s == "}" or s == "},") continue;
+    if (s == "]" or s == "],") continue;
+    if (string::npos != s.find("nodes =>")
+	&& string::npos == s.find("numNodes")) continue;
+
+    if (string::npos != s.find("policyType")) {
+      if (string::npos == s.find("FiniteStateController")) {
+	fprintf(stderr, "ERROR: %s: line %d: expected 'policyType => \"FiniteStateController\"'\n",
+		inFileName.c_str(), lnum);
+	exit(EXIT_FAILURE);
+      }
+      sawPolicyType = true;
+    } else if (1 == sscanf(s.c_str(), "numNodes => %d", &numNodes)) {
+      // ok
+    } else if (1 == sscanf(s.c_str(), "numObservations => %d", &numObservations)) {
+      // ok
+    } else if (1 == sscanf(s.c_str(), "startNode => %d", &startNode)) {
+      // ok
+    } else {
+      // node line: <node>, <action>, <successors>...
+      if (!sawPolicyType || numObservations < 0) {
+	fprintf(stderr, "ERROR: %s: line %d: expected header fields before node list\n",
+		inFileName.c_str(), lnum);
+	exit(EXIT_FAILURE);
+      }
+      const char* p = s.c_str();
+      int vals[2];
+      int nchars;
+      FOR (i, 2) {
+	if (1 != sscanf(p, " %d ,%n", &vals[i], &nchars)) {
+	  fprintf(stderr, "ERROR: %s: line %d: expected '<node>, <action>, <successors>...'\n",
+		  inFileName.c_str(), lnum);
+	  exit(EXIT_FAILURE);
+	}
+	p += nchars;
+      }
+      if (vals[0] != getNumNodes()) {
+	fprintf(stderr, "ERROR: %s: line %d: expected node %d, found node %d\n",
+		inFileName.c_str(), lnum, getNumNodes(), vals[0]);
+	exit(EXIT_FAILURE);
+      }
+      actions.push_back(vals[1]);
+      FOR (o, numObservations) {
+	int next;
+	if (1 != sscanf(p, " %d%n", &next, &nchars)) {
+	  fprintf(stderr, "ERROR: %s: line %d: expected %d successor nodes\n",
+		  inFileName.c_str(), lnum, numObservations);
+	  exit(EXIT_FAILURE);
+	}
+	p += nchars;
+	if (',' == *p) p++;
+	successors.push_back(next);
+      }
+    }
+  }
+  inFile.close();
+
+  if (!sawPolicyType || numNodes != getNumNodes()) {
+    fprintf(stderr, "ERROR: %s: expected %d nodes, found %d\n",
+	    inFileName.c_str(), numNodes, getNumNodes());
+    exit(EXIT_FAILURE);
+  }
+  FOR_EACH (si, successors) {
+    if (*si < 0 || *si >= numNodes) {
+      fprintf(stderr, "ERROR: %s: successor node %d out of range\n",
+	      inFileName.c_str(), *si);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (startNode < 0 || startNode >= numNodes) {
+    fprintf(stderr, "ERROR: %s: startNode %d out of range\n",
+	    inFileName.c_str(), startNode);
+    exit(EXIT_FAILURE);
+  }
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,94 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    FiniteStateController.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCFiniteStateController_h
+#define INCFiniteStateController_h
+
+/**********************************************************************
+ * INCLUDES
+ **********************************************************************/
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Pomdp.h"
+#include "MaxPlanesLowerBound.h"
+
+/**********************************************************************
+ * CLASSES
+ **********************************************************************/
+
+namespace zmdp {
+
+// A finite-state controller (policy graph) for a POMDP.  Each node has
+// an action and, for each observation, a successor node.  Executing the
+// controller takes constant time per step and needs no belief
+// tracking.
+struct FiniteStateController {
+  int numObservations;
+  int startNode;
+  // actions[n] is the action of node n
+  std::vector<int> actions;
+  // successors[n*numObservations + o] is the node reached from node n
+  // after observation o
+  std::vector<int> successors;
+
+  FiniteStateController(void);
+
+  int getNumNodes(void) const { return actions.size(); }
+  int getSuccessor(int n, int o) const { return successors[n*numObservations + o]; }
+
+  // builds the controller from the planes of a maxPlanes policy.  each
+  // node corresponds to a plane; starting from the plane that is best
+  // at the initial belief, the successor for observation o is the plane
+  // that is best at the belief reached by following the node's action
+  // and seeing o from a witness belief where the node's plane was best.
+  // this mirrors the successor planes chosen by
+  // MaxPlanesLowerBound::getNewLBPlaneQ().  only planes reachable from
+  // the start node become nodes.
+  void compileFromPlanes(const Pomdp* pomdp, const MaxPlanesLowerBound* lb);
+
+  // calculates the value function of the controller: values[n](s) is
+  // the expected discounted reward of starting in node n at state s.
+  // iterates until the values change by less than maxResidual or
+  // maxIterations sweeps have been made.  returns the number of sweeps.
+  int evaluate(std::vector<dvector>& values, const Pomdp* pomdp,
+	       double maxResidual, int maxIterations) const;
+
+  // rewrites observation indices of the reduced model in terms of the
+  // original model (see ModelReducer)
+  void expandObservations(const std::vector<int>& originalToReducedObs);
+
+  void writeToFile(const std::string& outFileName) const;
+  void readFromFile(const std::string& inFileName);
+};
+
+}; // namespace zmdp
+
+#endif // INCFiniteStateController_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
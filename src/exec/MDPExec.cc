@@ -62,8 +62,7 @@ state_vector& MDPExec::getState(state_vector& s) const
 
 int MDPExec::getRandomOutcome(int a) const
 {
-  obs_prob_vector opv;
-  return chooseFromDistribution(mdp->getOutcomeProbVector(opv, currentState, a));
+  return mdp->sampleOutcome(currentState, a, getThreadRandomStream(), workspace);
 }
 
 }; // namespace zmdp
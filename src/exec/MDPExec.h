@@ -41,6 +41,11 @@ struct MDPExecCore {
   virtual void setToInitialState(void) = 0;
   virtual int chooseAction(void) = 0;
   virtual void advanceToNextState(int a, int o) = 0;
+
+  // returns true if chooseAction() is a function of the current
+  // simulator state (for a POMDP, the belief).  execs with internal
+  // memory, such as finite-state controllers, should return false.
+  virtual bool getActionDependsOnlyOnState(void) const { return true; }
 };
 
 // MDPExec adds some default class members to MDPExecCore,
@@ -49,6 +54,9 @@ struct MDPExec : public MDPExecCore {
   MDP* mdp;
   bool currentStateInitialized;
   belief_vector currentState;
+  // preallocated storage so that stepping the exec does not allocate
+  mutable MDPWorkspace workspace;
+  state_vector nextState;
 
   MDPExec(void);
 
@@ -34,6 +34,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTime.h"
@@ -41,11 +42,61 @@
 #include "PolicyEvaluator.h"
 #include "MDPSim.h"
 #include "CacheMDP.h"
+#include "AsyncLog.h"
 
 using namespace std;
 using namespace MatrixUtils;
 using namespace sla;
 
+// in adaptive evaluation, the confidence interval is not trusted until
+// at least this many batches have been run
+#define PE_MIN_ADAPTIVE_BATCHES (10)
+
+/**********************************************************************
+ * LOCAL HELPER FUNCTIONS
+ **********************************************************************/
+
+namespace zmdp {
+
+// running sums for estimating the optimal control variate coefficient
+// cov(g,m)/var(m), where g is a trial's reward and m its control
+struct ControlVariateStats {
+  int n;
+  double sumG, sumM, sumGG, sumGM, sumMM;
+
+  ControlVariateStats(void) :
+    n(0), sumG(0), sumM(0), sumGG(0), sumGM(0), sumMM(0)
+  {}
+
+  void add(double g, double m) {
+    n++;
+    sumG += g;
+    sumM += m;
+    sumGG += g*g;
+    sumGM += g*m;
+    sumMM += m*m;
+  }
+
+  double getCovGM(void) const { return (sumGM - sumG*sumM/n) / n; }
+  double getVarG(void) const { return (sumGG - sumG*sumG/n) / n; }
+  double getVarM(void) const { return (sumMM - sumM*sumM/n) / n; }
+
+  double getCoefficient(void) const {
+    if (n < 2 || getVarM() <= 0) return 0.0;
+    return getCovGM() / getVarM();
+  }
+
+  // var(g) / var(g - coefficient*m)
+  double getVarianceReductionFactor(void) const {
+    double varG = getVarG();
+    double residual = varG - getCoefficient() * getCovGM();
+    if (varG <= 0 || residual <= 0) return 1.0;
+    return varG / residual;
+  }
+};
+
+}; // namespace zmdp
+
 namespace zmdp {
 
 PolicyEvaluator::PolicyEvaluator(MDP* _simModel,
@@ -58,57 +109,152 @@ PolicyEvaluator::PolicyEvaluator(MDP* _simModel,
   assumeIdenticalModels(_assumeIdenticalModels),
   sim(NULL),
   simOutFile(NULL),
+  simLog(NULL),
   scoresOutFile(NULL),
-  modelCache(NULL)
+  modelCache(NULL),
+  rng(getThreadRandomStream().split()),
+  cvBounds(NULL)
 {}
 
+void PolicyEvaluator::setControlVariateBounds(const BoundPairCore* _cvBounds)
+{
+  cvBounds = _cvBounds;
+}
+
+PolicyEvaluator::~PolicyEvaluator(void)
+{
+  if (NULL != sim) delete sim;
+  if (NULL != modelCache) delete modelCache;
+}
+
 void PolicyEvaluator::getRewardSamples(dvector& rewards, double& successRate, bool _verbose)
 {
   timeval startTime = getTime();
 
   verbose = _verbose;
 
-  useEvaluationCache = config->getBool("useEvaluationCache");
+  if (NULL != modelCache) {
+    // the policy may have changed since the last call; forget the
+    // actions it chose
+    FOR_EACH (ni, modelCache->nodeTable) {
+      (*ni)->userInt = -1;
+    }
+  }
+  // likewise, the solver's bounds may have changed
+  nodeValues.clear();
+  nodeValueIsSet.clear();
+
+  // the cache remembers one action per simulator state, which is only
+  // valid if the exec's choice depends on nothing else
+  useEvaluationCache = config->getBool("useEvaluationCache")
+    && exec->getActionDependsOnlyOnState();
   evaluationTrialsPerEpoch = config->getInt("evaluationTrialsPerEpoch");
   evaluationMaxStepsPerTrial = config->getInt("evaluationMaxStepsPerTrial");
   scoresOutputFile = config->getString("scoresOutputFile");
   simulationTraceOutputFile = config->getString("simulationTraceOutputFile");
+  useBinaryLogs = config->getBool("useBinaryLogs");
   simulationTracesToLogPerEpoch = config->getInt("simulationTracesToLogPerEpoch");
   if (simulationTracesToLogPerEpoch < 0) {
     simulationTracesToLogPerEpoch = INT_MAX;
   }
-
-  simOutFile = new ofstream(simulationTraceOutputFile.c_str());
-  if (! (*simOutFile)) {
-    fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
-	    simulationTraceOutputFile.c_str(), strerror(errno));
+  useCommonRandomNumbers = config->getBool("evaluationCommonRandomNumbers");
+  std::string cvType = config->getString("evaluationControlVariate");
+  if (cvType == "none") {
+    controlVariateBound = PE_CV_NONE;
+  } else if (cvType == "lower") {
+    controlVariateBound = PE_CV_LOWER;
+  } else if (cvType == "upper") {
+    controlVariateBound = PE_CV_UPPER;
+  } else {
+    fprintf(stderr, "ERROR: unknown evaluationControlVariate value '%s' (-h for help)\n",
+	    cvType.c_str());
     exit(EXIT_FAILURE);
   }
+  if (PE_CV_NONE != controlVariateBound && NULL == cvBounds) {
+    printf("WARNING: evaluationControlVariate requires a solver (zmdp benchmark); ignoring it\n");
+    controlVariateBound = PE_CV_NONE;
+  }
+
+  if (useBinaryLogs) {
+    simLog = new BinaryLogWriter(simulationTraceOutputFile, BL_SIM_TRACE);
+  } else {
+    simOutFile = newLogStream(simulationTraceOutputFile);
+  }
   
   if (verbose) {
-    scoresOutFile = new ofstream(scoresOutputFile.c_str());
-    if (!scoresOutFile) {
-      fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
-	      scoresOutputFile.c_str(), strerror(errno));
-      exit(EXIT_FAILURE);
-    }
+    scoresOutFile = newLogStream(scoresOutputFile);
   }
     
-  // parameter 30 is arbitrary, trying to guarantee valid statistics
-  int numBatches = std::min(evaluationTrialsPerEpoch, 30);
-  int numTrialsPerBatch = evaluationTrialsPerEpoch / numBatches;
+  // in adaptive mode, run small batches until the confidence interval
+  // for the mean is tight enough, up to evaluationTrialsPerEpoch trials
+  double targetPrecision = config->getDouble("evaluationTargetPrecision");
+  double targetRelativePrecision =
+    config->getDouble("evaluationTargetRelativePrecision");
+  bool adaptive = (targetPrecision > 0 || targetRelativePrecision > 0);
+
+  int numBatches, numTrialsPerBatch;
+  if (adaptive) {
+    numTrialsPerBatch = std::max(1, config->getInt("evaluationTrialsPerBatch"));
+    numBatches = std::max(1, evaluationTrialsPerEpoch / numTrialsPerBatch);
+  } else {
+    // parameter 30 is arbitrary, trying to guarantee valid statistics
+    numBatches = std::min(evaluationTrialsPerEpoch, 30);
+    numTrialsPerBatch = evaluationTrialsPerEpoch / numBatches;
+  }
 
-  rewards.resize(numBatches);
+  std::vector<double> batchMeans, batchControlMeans;
+  ControlVariateStats cvStats;
+  double cvCoeff = 0.0;
+  RunningMeanInterval meanEstimate;
   double successRateSum = 0.0;
   int startTrialIndex = 0;
   for (int i=0; i < numBatches; i++) {
-    dvector batchRewards;
+    dvector batchRewards, batchControls;
     double batchSuccessRate;
-    doBatch(batchRewards, batchSuccessRate, numTrialsPerBatch,
+    doBatch(batchRewards, batchControls, batchSuccessRate, startTrialIndex,
+	    numTrialsPerBatch,
 	    std::max(0, simulationTracesToLogPerEpoch - startTrialIndex));
-    rewards(i) = sum(batchRewards) / numTrialsPerBatch;
+    batchMeans.push_back(sum(batchRewards) / numTrialsPerBatch);
     successRateSum += batchSuccessRate;
     startTrialIndex += numTrialsPerBatch;
+
+    if (PE_CV_NONE != controlVariateBound) {
+      batchControlMeans.push_back(sum(batchControls) / numTrialsPerBatch);
+      FOR (j, numTrialsPerBatch) {
+	cvStats.add(batchRewards(j), batchControls(j));
+      }
+      cvCoeff = cvStats.getCoefficient();
+    }
+
+    if (adaptive) {
+      if (PE_CV_NONE == controlVariateBound) {
+	meanEstimate.add(batchMeans.back());
+      } else {
+	// the coefficient changed, so all the adjusted means change
+	meanEstimate.clear();
+	FOR (j, batchMeans.size()) {
+	  meanEstimate.add(batchMeans[j] - cvCoeff * batchControlMeans[j]);
+	}
+      }
+      if (meanEstimate.n >= PE_MIN_ADAPTIVE_BATCHES) {
+	double halfWidth = meanEstimate.getConf95HalfWidth();
+	if ((targetPrecision > 0 && halfWidth <= targetPrecision)
+	    || (targetRelativePrecision > 0
+		&& halfWidth <= targetRelativePrecision * fabs(meanEstimate.mean))) {
+	  break;
+	}
+      }
+    }
+  }
+  numBatches = batchMeans.size();
+  rewards.resize(numBatches);
+  FOR (i, numBatches) {
+    rewards(i) = batchMeans[i];
+    if (PE_CV_NONE != controlVariateBound) {
+      // the control has expected value zero, so subtracting it leaves
+      // the mean unchanged but removes the variance it explains
+      rewards(i) -= cvCoeff * batchControlMeans[i];
+    }
   }
   printf("\n");
 
@@ -119,28 +265,77 @@ void PolicyEvaluator::getRewardSamples(dvector& rewards, double& successRate, bo
   printf("\n");
 
   successRate = successRateSum / numBatches;
+  if (PE_CV_NONE != controlVariateBound) {
+    printf("(control variate coefficient %g, trial variance reduced by a factor of %.2f)\n",
+	   cvCoeff, cvStats.getVarianceReductionFactor());
+  }
+  if (adaptive) {
+    printf("(adaptive evaluation used %d trials, 95%% confidence interval half-width %g)\n",
+	   startTrialIndex, meanEstimate.getConf95HalfWidth());
+  }
 
   // cleanup
 #define DELETE_AND_NULL(x) if (NULL != (x)) { delete (x); (x) = NULL; }
 
   DELETE_AND_NULL(simOutFile);
+  DELETE_AND_NULL(simLog);
   DELETE_AND_NULL(scoresOutFile);
-  DELETE_AND_NULL(sim);
-  DELETE_AND_NULL(modelCache);
 
   printf("(policy evaluation took %.3lf seconds)\n",
 	 timevalToSeconds(getTime() - startTime));
 }
 
 void PolicyEvaluator::doBatch(dvector& rewards,
+			      dvector& controls,
 			      double& successRate,
+			      int firstTrialIndex,
 			      int numTrials,
 			      int numTracesToLog)
 {
+  controls.resize(numTrials);
   if (useEvaluationCache) {
-    doBatchCache(rewards, successRate, numTrials, numTracesToLog);
+    doBatchCache(rewards, controls, successRate, firstTrialIndex, numTrials,
+		 numTracesToLog);
+  } else {
+    doBatchSimple(rewards, controls, successRate, firstTrialIndex, numTrials,
+		  numTracesToLog);
+  }
+}
+
+// returns the control variate bound's value at s
+double PolicyEvaluator::getControlValue(const state_vector& s) const
+{
+  ValueInterval v = cvBounds->getValueAt(s);
+  return (PE_CV_LOWER == controlVariateBound) ? v.l : v.u;
+}
+
+// same as getControlValue(), but caches the value for each node of
+// modelCache
+double PolicyEvaluator::getControlValue(const CMDPNode& cn)
+{
+  if (cn.si >= (int) nodeValues.size()) {
+    nodeValues.resize(modelCache->nodeTable.size());
+    nodeValueIsSet.resize(modelCache->nodeTable.size(), false);
+  }
+  if (!nodeValueIsSet[cn.si]) {
+    nodeValues[cn.si] = getControlValue(cn.s);
+    nodeValueIsSet[cn.si] = true;
+  }
+  return nodeValues[cn.si];
+}
+
+// with common random numbers, each trial gets its own stream, which
+// depends only on the random seed and the trial index.  thus trial i
+// sees the same random draws in every epoch and every run with the
+// same seed.
+RandomStream& PolicyEvaluator::getTrialRandomStream(RandomStream& trialRng,
+						    int trialIndex)
+{
+  if (useCommonRandomNumbers) {
+    trialRng.seed(getRandomSeed(), ZMDP_RS_FIRST_EVAL_TRIAL + trialIndex);
+    return trialRng;
   } else {
-    doBatchSimple(rewards, successRate, numTrials, numTracesToLog);
+    return rng;
   }
 }
 
@@ -158,7 +353,9 @@ struct PESimLogEntry {
 typedef std::vector<PESimLogEntry> PESimLog;
 
 void PolicyEvaluator::doBatchCache(dvector& rewards,
+				   dvector& controls,
 				   double& successRate,
+				   int firstTrialIndex,
 				   int numTrials,
 				   int numTracesToLog)
 {
@@ -166,35 +363,32 @@ void PolicyEvaluator::doBatchCache(dvector& rewards,
     modelCache = new CacheMDP(simModel);
   }
     
-  ofstream* simOutFileTmp = simOutFile;
-
-  // pass 0: clear old count data if any
-  for (int si=0; si < (int)modelCache->nodeTable.size(); si++) {
-    CMDPNode* cn = modelCache->nodeTable[si];
-    for (int a=0; a < modelCache->getNumActions(); a++) {
-      CMDPQEntry* Qa = cn->Q[a];
-      if (NULL != Qa) {
-	for (int o=0; o < (int)Qa->getNumOutcomes(); o++) {
-	  CMDPEdge* e = Qa->outcomes[o];
-	  if (NULL != e) {
-	    e->userInt = -1;
-	  }
-	}
-      }
-    }
-  }
+  ostream* simOutFileTmp = simOutFile;
+  BinaryLogWriter* simLogTmp = simLog;
+  state_vector logStorage, nextLogStorage;
+
+  // edge counts (userInt) start at -1 and are reset to -1 at the end of
+  // each batch.  only the Q entries visited by this batch are touched,
+  // so the cost of a batch does not grow with the size of the cache.
+  std::vector<CMDPQEntry*> visitedQ;
 
   // pass 1: record trials
   std::vector<PESimLog> trials(numTrials);
   int numTrialsReachedGoal = 0;
+  RandomStream trialRngStorage;
   for (int i=0; i < numTrials; i++) {
     if (i >= numTracesToLog) {
       simOutFileTmp = NULL; // stop logging
+      simLogTmp = NULL;
     }
+    RandomStream& trialRng = getTrialRandomStream(trialRngStorage, firstTrialIndex + i);
       
     if (simOutFileTmp) {
       (*simOutFileTmp) << ">>> begin" << endl;
     }
+    if (simLogTmp) {
+      simLogTmp->writeBegin();
+    }
     exec->setToInitialState();
     CMDPNode* simState = modelCache->root;
     CMDPQEntry* Qa = NULL;
@@ -210,19 +404,24 @@ void PolicyEvaluator::doBatchCache(dvector& rewards,
       }
 
       Qa = modelCache->getQ(*simState, a);
-      int o = chooseFromDistribution(Qa->opv);
+      int o = modelCache->sampleOutcome(*Qa, trialRng);
       CMDPEdge* e = Qa->outcomes[o];
       assert(NULL != e);
       if (-1 == e->userInt) {
 	e->userInt = 1;
+	visitedQ.push_back(Qa);
       } else {
 	e->userInt++;
       }
       trials[i].push_back(PESimLogEntry(simState, a, o));
 
       if (simOutFileTmp) {
-	(*simOutFileTmp) << "sim: [" << sparseRep(simState->s) << "] " << a << " ["
-			 << sparseRep(e->nextState->s) << "] " << o << endl;
+	(*simOutFileTmp) << "sim: [" << simModel->getStateString(simState->s) << "] " << a << " ["
+			 << simModel->getStateString(e->nextState->s) << "] " << o << endl;
+      }
+      if (simLogTmp) {
+	simLogTmp->writeStep(simModel->getLogState(logStorage, simState->s), a,
+			     simModel->getLogState(nextLogStorage, e->nextState->s), o);
       }
 
       simState = e->nextState;
@@ -237,6 +436,9 @@ void PolicyEvaluator::doBatchCache(dvector& rewards,
 	if (simOutFileTmp) {
 	  (*simOutFileTmp) << "terminated" << endl;
 	}
+	if (simLogTmp) {
+	  simLogTmp->writeTerminated();
+	}
 	break;
       }
     }
@@ -254,39 +456,29 @@ void PolicyEvaluator::doBatchCache(dvector& rewards,
   }
 
   // pass 2: collate counts and calculate reweighting coefficients
-  for (int si=0; si < (int)modelCache->nodeTable.size(); si++) {
-    CMDPNode* cn = modelCache->nodeTable[si];
-    for (int a=0; a < modelCache->getNumActions(); a++) {
-      CMDPQEntry* Qa = cn->Q[a];
-      if (NULL != Qa) {
-	double probSum = 0.0;
-	double cntSum = 0;
-	for (int o=0; o < (int)Qa->getNumOutcomes(); o++) {
-	  CMDPEdge* e = Qa->outcomes[o];
-	  if (NULL != e) {
-	    if (-1 != e->userInt) {
-	      probSum += Qa->opv(o);
-	      cntSum += e->userInt;
-	    }
-	  }
+  std::sort(visitedQ.begin(), visitedQ.end());
+  visitedQ.erase(std::unique(visitedQ.begin(), visitedQ.end()), visitedQ.end());
+  FOR_EACH (qi, visitedQ) {
+    CMDPQEntry* Qa = *qi;
+    double probSum = 0.0;
+    double cntSum = 0;
+    for (int o=0; o < (int)Qa->getNumOutcomes(); o++) {
+      CMDPEdge* e = Qa->outcomes[o];
+      if (NULL != e) {
+	if (-1 != e->userInt) {
+	  probSum += Qa->opv(o);
+	  cntSum += e->userInt;
 	}
-#if 0
-	printf("s=%d a=%d probSum=%lf cntSum=%lf\n", si, a, probSum, cntSum);
-#endif
-	for (int o=0; o < (int)Qa->getNumOutcomes(); o++) {
-	  CMDPEdge* e = Qa->outcomes[o];
-	  if (NULL != e) {
-	    if (-1 != e->userInt) {
-	      if (probSum == 1.0) {
-		e->userDouble = Qa->opv(o) / (e->userInt / cntSum);
-	      } else {
-		e->userDouble = 1.0;
-	      }
-#if 0
-	      printf("  o=%d n=%d opv(o)=%lf reweight=%lf\n",
-		     o, e->userInt, Qa->opv(o), e->userDouble);
-#endif
-	    }
+      }
+    }
+    for (int o=0; o < (int)Qa->getNumOutcomes(); o++) {
+      CMDPEdge* e = Qa->outcomes[o];
+      if (NULL != e) {
+	if (-1 != e->userInt) {
+	  if (probSum == 1.0) {
+	    e->userDouble = Qa->opv(o) / (e->userInt / cntSum);
+	  } else {
+	    e->userDouble = 1.0;
 	  }
 	}
       }
@@ -296,16 +488,33 @@ void PolicyEvaluator::doBatchCache(dvector& rewards,
   // pass 3: go back through logs and perform reweighting
   rewards.resize(numTrials);
   double batchSumReward = 0.0;
+  double discount = modelCache->getDiscount();
   for (int i=0; i < numTrials; i++) {
     double rewardSoFar = 0.0;
+    double controlSoFar = 0.0;
     for (int j=trials[i].size()-1; j >= 0; j--) {
       PESimLogEntry& entry = trials[i][j];
       CMDPQEntry& Qa = *entry.cn->Q[entry.a];
       double reweight = Qa.outcomes[entry.o]->userDouble;
 	
-      rewardSoFar = Qa.immediateReward + reweight * modelCache->getDiscount() * rewardSoFar;
+      rewardSoFar = Qa.immediateReward + reweight * discount * rewardSoFar;
+
+      if (PE_CV_NONE != controlVariateBound) {
+	// the control accumulates discount * (V(s') - E[V(s')]) at each
+	// step, weighted the same way as the rewards
+	double expectedNextVal = 0.0;
+	FOR (o, Qa.getNumOutcomes()) {
+	  if (NULL != Qa.outcomes[o]) {
+	    expectedNextVal += Qa.opv(o) * getControlValue(*Qa.outcomes[o]->nextState);
+	  }
+	}
+	double nextVal = getControlValue(*Qa.outcomes[entry.o]->nextState);
+	controlSoFar = discount * (reweight * nextVal - expectedNextVal)
+	  + reweight * discount * controlSoFar;
+      }
     }
     rewards(i) = rewardSoFar;
+    controls(i) = controlSoFar;
 
     batchSumReward += rewardSoFar;
   }
@@ -314,17 +523,39 @@ void PolicyEvaluator::doBatchCache(dvector& rewards,
     (*scoresOutFile) << batchSumReward/numTrials << endl;
   }
 
+  // pass 4: reset the counts for the next batch
+  FOR_EACH (qi, visitedQ) {
+    CMDPQEntry* Qa = *qi;
+    for (int o=0; o < (int)Qa->getNumOutcomes(); o++) {
+      CMDPEdge* e = Qa->outcomes[o];
+      if (NULL != e) {
+	e->userInt = -1;
+      }
+    }
+  }
+
   successRate = ((double) numTrialsReachedGoal) / numTrials;
 }
 
 void PolicyEvaluator::doBatchSimple(dvector& rewards,
+				    dvector& controls,
 				    double& successRate,
+				    int firstTrialIndex,
 				    int numTrials,
 				    int numTracesToLog)
 {
-  sim = new MDPSim(simModel);
+  if (NULL == sim) {
+    sim = new MDPSim(simModel);
+  }
+  if (!useCommonRandomNumbers) {
+    sim->rng = rng.split();
+  }
+  double discount = simModel->getDiscount();
+  outcome_prob_vector opv;
+  state_vector nextState;
     
   sim->simOutFile = simOutFile;
+  sim->simLog = simLog;
     
   int numTrialsReachedGoal = 0;
     
@@ -333,14 +564,37 @@ void PolicyEvaluator::doBatchSimple(dvector& rewards,
   for (int i=0; i < numTrials; i++) {
     if (i >= numTracesToLog) {
       sim->simOutFile = NULL; // stop logging
+      sim->simLog = NULL;
     }
       
+    if (useCommonRandomNumbers) {
+      getTrialRandomStream(sim->rng, firstTrialIndex + i);
+    }
     sim->restart();
     exec->setToInitialState();
+    double control = 0.0;
     for (int j=0; (j < evaluationMaxStepsPerTrial) || (0 == evaluationMaxStepsPerTrial);
 	 j++) {
       int a = exec->chooseAction();
+
+      double expectedNextVal = 0.0;
+      double stepDiscount = sim->discountFactor * discount;
+      if (PE_CV_NONE != controlVariateBound) {
+	simModel->getOutcomeProbVector(opv, sim->state, a);
+	FOR (o, opv.size()) {
+	  if (opv(o) > OBS_IS_ZERO_EPS) {
+	    simModel->getNextState(nextState, sim->state, a, o);
+	    expectedNextVal += opv(o) * getControlValue(nextState);
+	  }
+	}
+      }
+
       sim->performAction(a);
+
+      if (PE_CV_NONE != controlVariateBound) {
+	control += stepDiscount * (getControlValue(sim->state) - expectedNextVal);
+      }
+
       if (assumeIdenticalModels) {
 	((MDPExec* ) exec)->currentState = sim->state;
       } else {
@@ -352,6 +606,7 @@ void PolicyEvaluator::doBatchSimple(dvector& rewards,
       }
     }
     rewards(i) = sim->rewardSoFar;
+    controls(i) = control;
     if (verbose) {
       (*scoresOutFile) << sim->rewardSoFar << endl;
       if (i%10 == 9) {
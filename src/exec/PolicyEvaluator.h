@@ -26,16 +26,29 @@
 #include "MDPExec.h"
 #include "MDPSim.h"
 #include "CacheMDP.h"
+#include "BoundPairCore.h"
 
 namespace zmdp {
 
+enum PEControlVariateEnum {
+  PE_CV_NONE,
+  PE_CV_LOWER,
+  PE_CV_UPPER
+};
+
 struct PolicyEvaluator {
   PolicyEvaluator(MDP* _simModel,
 		  MDPExecCore* _exec,
 		  const ZMDPConfig* _config,
 		  bool _assumeIdenticalModels);
+  ~PolicyEvaluator(void);
   void getRewardSamples(dvector& rewards, double& successRate, bool _verbose);
 
+  // if the evaluationControlVariate config field is set, these bounds
+  // are used as a control variate to reduce the variance of the reward
+  // samples.  the bounds must be for the simulation model.
+  void setControlVariateBounds(const BoundPairCore* _cvBounds);
+
 protected:
   MDP* simModel;
   MDP* planningModel;
@@ -49,17 +62,33 @@ protected:
   std::string simulationTraceOutputFile;
   int simulationTracesToLogPerEpoch;
   MDPSim* sim;
-  std::ofstream* simOutFile;
-  std::ofstream* scoresOutFile;
+  bool useBinaryLogs;
+  std::ostream* simOutFile;
+  BinaryLogWriter* simLog;
+  std::ostream* scoresOutFile;
   bool verbose;
+  // modelCache is kept across calls to getRewardSamples(), since the
+  // model does not change; only the cached policy actions are reset
   CacheMDP* modelCache;
+  // all simulated outcomes are drawn from rng, which is split off the
+  // creating thread's stream
+  RandomStream rng;
+  bool useCommonRandomNumbers;
+  const BoundPairCore* cvBounds;
+  int controlVariateBound;
+  // cached control values for the nodes of modelCache, indexed by si
+  std::vector<double> nodeValues;
+  std::vector<bool> nodeValueIsSet;
 
-  void doBatch(dvector& rewards, double& successRate, int numTrials,
-	       int numTracesToLog);
-  void doBatchCache(dvector& rewards, double& successRate, int numTrials,
-		    int numTracesToLog);
-  void doBatchSimple(dvector& rewards, double& successRate, int numTrials,
-		     int numTracesToLog);
+  void doBatch(dvector& rewards, dvector& controls, double& successRate,
+	       int firstTrialIndex, int numTrials, int numTracesToLog);
+  void doBatchCache(dvector& rewards, dvector& controls, double& successRate,
+		    int firstTrialIndex, int numTrials, int numTracesToLog);
+  void doBatchSimple(dvector& rewards, dvector& controls, double& successRate,
+		     int firstTrialIndex, int numTrials, int numTracesToLog);
+  double getControlValue(const state_vector& s) const;
+  double getControlValue(const CMDPNode& cn);
+  RandomStream& getTrialRandomStream(RandomStream& trialRng, int trialIndex);
 };
 
 }; // namespace zmdp
@@ -67,15 +67,30 @@ PolicyEvaluator::PolicyEvaluator(MDP* _simModel,
   sim(NULL),
   simOutFile(NULL),
   scoresOutFile(NULL),
-  modelCache(NULL)
+  modelCache(NULL),
+  rng(getThreadRandomStream().split())
 {}
 
+PolicyEvaluator::~PolicyEvaluator(void)
+{
+  if (NULL != sim) delete sim;
+  if (NULL != modelCache) delete modelCache;
+}
+
 void PolicyEvaluator::getRewardSamples(dvector& rewards, double& successRate, bool _verbose)
 {
   timeval startTime = getTime();
 
   verbose = _verbose;
 
+  if (NULL != modelCache) {
+    // the policy may have changed since the last call; forget the
+    // actions it chose
+    FOR_EACH (ni, modelCache->nodeTable) {
+      (*ni)->userInt = -1;
+    }
+  }
+
   useEvaluationCache = config->getBool("useEvaluationCache");
   evaluationTrialsPerEpoch = config->getInt("evaluationTrialsPerEpoch");
   evaluationMaxStepsPerTrial = config->getInt("evaluationMaxStepsPerTrial");
@@ -133,8 +148,6 @@ void PolicyEvaluator::getRewardSamples(dvector& rewards, double& successRate, bo
 
   DELETE_AND_NULL(simOutFile);
   DELETE_AND_NULL(scoresOutFile);
-  DELETE_AND_NULL(sim);
-  DELETE_AND_NULL(modelCache);
 
   printf("(policy evaluation took %.3lf seconds)\n",
 	 timevalToSeconds(getTime() - startTime));
@@ -237,7 +250,7 @@ void PolicyEvaluator::doBatchCache(dvector& rewards,
       }
 
       Qa = modelCache->getQ(*simState, a);
-      int o = chooseFromDistribution(Qa->opv);
+      int o = modelCache->sampleOutcome(*Qa, rng);
       CMDPEdge* e = Qa->outcomes[o];
       assert(NULL != e);
       if (-1 == e->userInt) {
@@ -248,8 +261,8 @@ void PolicyEvaluator::doBatchCache(dvector& rewards,
       trials[i].push_back(PESimLogEntry(simState, a, o));
 
       if (simOutFileTmp) {
-	(*simOutFileTmp) << "sim: [" << sparseRep(simState->s) << "] " << a << " ["
-			 << sparseRep(e->nextState->s) << "] " << o << endl;
+	(*simOutFileTmp) << "sim: [" << simModel->getStateString(simState->s) << "] " << a << " ["
+			 << simModel->getStateString(e->nextState->s) << "] " << o << endl;
       }
 
       simState = e->nextState;
@@ -390,7 +403,10 @@ void PolicyEvaluator::doBatchSimple(dvector& rewards,
 				    int numTrials,
 				    int numTracesToLog)
 {
-  sim = new MDPSim(simModel);
+  if (NULL == sim) {
+    sim = new MDPSim(simModel);
+  }
+  sim->rng = rng.split();
     
   sim->simOutFile = simOutFile;
     
@@ -0,0 +1,72 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    ReducedModelExec.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCReducedModelExec_h
+#define INCReducedModelExec_h
+
+/**********************************************************************
+ * INCLUDES
+ **********************************************************************/
+
+#include <vector>
+
+#include "MDPExec.h"
+
+/**********************************************************************
+ * CLASSES
+ **********************************************************************/
+
+namespace zmdp {
+
+// runs an exec whose planner model was reduced (see reduceModel) against
+// a simulator running the model file as written.  the exec tracks its
+// own belief over the reduced states, so only the observations need to
+// be translated.
+struct ReducedModelExec : public MDPExecCore {
+  MDPExecCore* exec;
+  const std::vector<int>& originalToReducedObs;
+
+  ReducedModelExec(MDPExecCore* _exec, const std::vector<int>& _originalToReducedObs) :
+    exec(_exec),
+    originalToReducedObs(_originalToReducedObs)
+  {}
+
+  // implement MDPExecCore virtual methods
+  void setToInitialState(void) { exec->setToInitialState(); }
+  int chooseAction(void) { return exec->chooseAction(); }
+  void advanceToNextState(int a, int o) {
+    exec->advanceToNextState(a, originalToReducedObs[o]);
+  }
+  bool getActionDependsOnlyOnState(void) const {
+    return exec->getActionDependsOnlyOnState();
+  }
+};
+
+}; // namespace zmdp
+
+#endif // INCReducedModelExec_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,226 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    testExecLatency.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <iostream>
+#include <algorithm>
+#include <new>
+
+#include "MatrixUtils.h"
+#include "MDPSim.h"
+#include "BoundPairExec.h"
+#include "zmdpMainConfig.h"
+
+#include "zmdpMainConfig.cc" // embed default config file
+
+using namespace std;
+using namespace zmdp;
+
+#define NUM_WARMUP_STEPS (100)
+
+// count heap allocations so we can check that the measured step path
+// does not allocate
+static long numAllocationsG = 0;
+
+void* operator new(size_t size)
+{
+  numAllocationsG++;
+  void* p = malloc(size ? size : 1);
+  if (NULL == p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p)
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t size)
+{
+  free(p);
+}
+
+static double getSeconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static void printQuantiles(const char* label, std::vector<double>& times)
+{
+  std::sort(times.begin(), times.end());
+  int n = times.size();
+  printf("%-22s p50 %8.2f us  p99 %8.2f us  p999 %8.2f us  max %8.2f us\n",
+	 label,
+	 1e+6 * times[(int) (0.5 * (n-1))],
+	 1e+6 * times[(int) (0.99 * (n-1))],
+	 1e+6 * times[(int) (0.999 * (n-1))],
+	 1e+6 * times[n-1]);
+}
+
+void doit(const char* modelFileName,
+	  bool useFastModelParser,
+	  const char* policyFileName,
+	  int numSteps,
+	  int maxStepsPerTrial)
+{
+  MatrixUtils::init_matrix_utils(/* randomSeed = */ 0);
+
+  ZMDPConfig* config = new ZMDPConfig();
+  config->readFromString("<defaultConfig>", defaultConfig.data);
+  config->setBool("useFastModelParser", useFastModelParser);
+
+  BoundPairExec* em = new BoundPairExec();
+  printf("initializing\n");
+  em->initReadFiles(modelFileName, policyFileName, *config);
+
+  MDPSim* sim = new MDPSim(em->mdp);
+
+  std::vector<double> stepTimes, updateTimes;
+  stepTimes.reserve(numSteps);
+  updateTimes.reserve(numSteps);
+  long numUpdateAllocations = 0;
+
+  printf("running %d steps\n", numSteps + NUM_WARMUP_STEPS);
+  int stepInTrial = maxStepsPerTrial;
+  for (int i=0; i < numSteps + NUM_WARMUP_STEPS; i++) {
+    if (sim->terminated || stepInTrial >= maxStepsPerTrial) {
+      sim->restart();
+      em->setToInitialState();
+      stepInTrial = 0;
+    }
+
+    double t0 = getSeconds();
+    int a = em->chooseAction();
+    double t1 = getSeconds();
+    long allocs0 = numAllocationsG;
+    sim->performAction(a);
+    em->advanceToNextState(a, sim->lastOutcomeIndex);
+    long allocs1 = numAllocationsG;
+    double t2 = getSeconds();
+    stepInTrial++;
+
+    if (i >= NUM_WARMUP_STEPS) {
+      stepTimes.push_back(t2 - t0);
+      updateTimes.push_back(t2 - t1);
+      numUpdateAllocations += allocs1 - allocs0;
+    }
+  }
+
+  printQuantiles("full step:", stepTimes);
+  printQuantiles("simulate and update:", updateTimes);
+  printf("heap allocations during simulate and update: %ld (%.3f per step)\n",
+	 numUpdateAllocations, ((double) numUpdateAllocations) / numSteps);
+}
+
+void usage(const char* binaryName)
+{
+  cerr <<
+    "usage: " << binaryName << " OPTIONS <foo.pomdp> <out.policy>\n"
+    "  -h or --help        Display this help\n"
+    "  -f or --fast        Use fast (but very picky) alternate model parser\n"
+    "  -n or --steps <n>   Number of steps to time (default 100000)\n"
+    "  -m or --max <n>     Maximum steps per trial (default 100)\n"
+    "\n"
+    "Reports the distribution of per-step latency when executing a policy\n"
+    "in simulation, both for the full step and for the part that excludes\n"
+    "action selection (simulator step plus exec belief update).\n";
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  static char shortOptions[] = "hfn:m:";
+  static struct option longOptions[]={
+    {"help",          0,NULL,'h'},
+    {"fast",          0,NULL,'f'},
+    {"steps",         1,NULL,'n'},
+    {"max",           1,NULL,'m'},
+    {NULL,0,0,0}
+  };
+
+  bool useFastModelParser = false;
+  int numSteps = 100000;
+  int maxStepsPerTrial = 100;
+  while (1) {
+    char optchar = getopt_long(argc,argv,shortOptions,longOptions,NULL);
+    if (optchar == -1) break;
+
+    switch (optchar) {
+    case 'h': // help
+      usage(argv[0]);
+      break;
+
+    case 'f': // fast
+      useFastModelParser = true;
+      break;
+
+    case 'n': // steps
+      numSteps = atoi(optarg);
+      break;
+
+    case 'm': // max
+      maxStepsPerTrial = atoi(optarg);
+      break;
+
+    case '?': // unknown option
+    case ':': // option with missing parameter
+      // getopt() prints an informative error message
+      cerr << endl;
+      usage(argv[0]);
+      break;
+    default:
+      abort(); // never reach this point
+    }
+  }
+  if (2 != argc-optind) {
+    cerr << "ERROR: wrong number of arguments (should be 2)" << endl << endl;
+    usage(argv[0]);
+  }
+  if (numSteps <= 0 || maxStepsPerTrial <= 0) {
+    cerr << "ERROR: --steps and --max must be positive" << endl << endl;
+    usage(argv[0]);
+  }
+
+  const char* modelFileName = argv[optind++];
+  const char* policyFileName = argv[optind++];
+
+  doit(modelFileName, useFastModelParser, policyFileName,
+       numSteps, maxStepsPerTrial);
+}
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
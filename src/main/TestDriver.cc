@@ -29,6 +29,9 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
 
 #include <iostream>
 #include <fstream>
@@ -38,16 +41,208 @@
 #include "zmdpCommonDefs.h"
 #include "MatrixUtils.h"
 #include "BoundPairExec.h"
+#include "ReducedModelExec.h"
 #include "PolicyEvaluator.h"
+#include "AsyncLog.h"
 
 using namespace std;
 using namespace MatrixUtils;
 
 namespace zmdp {
 
+/**********************************************************************
+ * EVALUATION EPOCHS
+ **********************************************************************/
+
+// one policy evaluation epoch: the bounds whose policy is evaluated
+// and the results of the evaluation
+struct TDEvalEpoch {
+  BoundPair* bounds;
+  // solver time when the epoch started
+  double solverTime;
+  const char* outPolicyFileName;
+  dvector rewardSamples;
+  double successRate;
+  double evalTime;
+};
+
+static void runEvalEpoch(PolicyEvaluator& eval, TDEvalEpoch& ep)
+{
+  timeval startTime = getTime();
+
+  // write output policy at each evaluation epoch if that was requested.
+  // the write is atomic, so an interrupted run leaves the policy from
+  // the last completed epoch in place.
+  if (NULL != ep.outPolicyFileName) {
+    ep.bounds->writePolicy(ep.outPolicyFileName, /* canModifyBounds = */ false);
+  }
+
+  // simulate running the policy many times and collect the per-run total reward values
+  eval.getRewardSamples(ep.rewardSamples, ep.successRate, /* verbose = */ true);
+
+  ep.evalTime = timevalToSeconds(getTime() - startTime);
+}
+
+// runs evaluation epochs in a background thread, so the solver can keep
+// running while a snapshot of its policy is evaluated.  a single thread
+// is used for the whole run (rather than one per epoch) so per-thread
+// state like the hashable() buffers is only allocated once.  at most
+// one epoch is outstanding at a time.
+struct TDEvalWorker {
+  PolicyEvaluator* eval;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  // protected by mutex
+  TDEvalEpoch* epoch;
+  bool epochDone;
+  bool shuttingDown;
+
+  TDEvalWorker(PolicyEvaluator* _eval);
+  ~TDEvalWorker(void);
+
+  void start(TDEvalEpoch* _epoch);
+  // waits for the outstanding epoch to finish and returns it, or
+  // returns NULL if there is none
+  TDEvalEpoch* finish(void);
+
+  static void* workerMain(void* worker);
+};
+
+TDEvalWorker::TDEvalWorker(PolicyEvaluator* _eval) :
+  eval(_eval),
+  epoch(NULL),
+  epochDone(false),
+  shuttingDown(false)
+{
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+  int err = pthread_create(&thread, NULL, &TDEvalWorker::workerMain, this);
+  if (0 != err) {
+    fprintf(stderr, "ERROR: couldn't start policy evaluation thread: %s\n", strerror(err));
+    exit(EXIT_FAILURE);
+  }
+}
+
+TDEvalWorker::~TDEvalWorker(void)
+{
+  pthread_mutex_lock(&mutex);
+  shuttingDown = true;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+
+  pthread_join(thread, NULL);
+
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+void TDEvalWorker::start(TDEvalEpoch* _epoch)
+{
+  pthread_mutex_lock(&mutex);
+  assert(NULL == epoch);
+  epoch = _epoch;
+  epochDone = false;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+}
+
+TDEvalEpoch* TDEvalWorker::finish(void)
+{
+  pthread_mutex_lock(&mutex);
+  while (NULL != epoch && !epochDone) {
+    pthread_cond_wait(&cond, &mutex);
+  }
+  TDEvalEpoch* result = epoch;
+  epoch = NULL;
+  pthread_mutex_unlock(&mutex);
+
+  return result;
+}
+
+void* TDEvalWorker::workerMain(void* workerArg)
+{
+  TDEvalWorker& w = *((TDEvalWorker*) workerArg);
+
+  pthread_mutex_lock(&w.mutex);
+  while (1) {
+    while (!w.shuttingDown && (NULL == w.epoch || w.epochDone)) {
+      pthread_cond_wait(&w.cond, &w.mutex);
+    }
+    if (w.shuttingDown) break;
+    TDEvalEpoch* ep = w.epoch;
+
+    pthread_mutex_unlock(&w.mutex);
+    runEvalEpoch(*w.eval, *ep);
+    pthread_mutex_lock(&w.mutex);
+
+    w.epochDone = true;
+    pthread_cond_broadcast(&w.cond);
+  }
+  pthread_mutex_unlock(&w.mutex);
+
+  return NULL;
+}
+
+/**********************************************************************
+ * TEST DRIVER
+ **********************************************************************/
+
+// writes the incPlotFile line for a completed epoch
+static void recordEvalEpoch(ostream& incPlotFile, TDEvalEpoch& ep)
+{
+#if 0
+  // collect policy evaluation statistics and write a line to the log file
+  double avg, stdev;
+  calc_avg_stdev_collection(ep.rewardSamples.data.begin(), ep.rewardSamples.data.end(),
+			    avg, stdev);
+
+  incPlotFile << ep.solverTime
+	      << " " << avg
+	      << " " << (stdev/::sqrt(numIterations)*1.96)
+	      << " " << ep.successRate << endl;
+#endif
+
+  // calculate summary statistics, mean and 95% confidence interval for the mean
+  double mean, quantile1, quantile2;
+  calc_bootstrap_mean_quantile(ep.rewardSamples,
+			       0.05, // 95% confidence interval
+			       mean, quantile1, quantile2);
+
+  incPlotFile << ep.solverTime
+	      << " " << mean
+	      << " " << quantile1
+	      << " " << quantile2
+	      << " " << ep.successRate << endl;
+     
+  incPlotFile.flush();
+
+  printf("(evaluation epoch at solver time %.3lf took %.3lf seconds)\n",
+	 ep.solverTime, ep.evalTime);
+}
+
+// waits for the worker's outstanding epoch, if any, and records it
+static void finishBackgroundEpoch(TDEvalWorker& worker, ostream& incPlotFile,
+				  double& totalEvalTime, double& totalStallTime)
+{
+  timeval waitStart = getTime();
+  TDEvalEpoch* ep = worker.finish();
+  totalStallTime += timevalToSeconds(getTime() - waitStart);
+
+  if (NULL != ep) {
+    totalEvalTime += ep->evalTime;
+    recordEvalEpoch(incPlotFile, *ep);
+    // the bounds are a snapshot owned by the epoch
+    delete ep->bounds;
+    delete ep;
+  }
+}
+
 void TestDriver::batchTestIncremental(const ZMDPConfig& config,
 				      int numIterations,
 				      SolverObjects& so,
+				      Pomdp* simPomdp,
 				      int numSteps,
 				      double minPrecision,
 				      double firstEpochWallclockSeconds,
@@ -62,42 +257,21 @@ void TestDriver::batchTestIncremental(const ZMDPConfig& config,
 
   sim = so.sim;
 
-  ofstream incPlotFile( incPlotFileName.c_str() );
-  if (! incPlotFile) {
-    cerr << "ERROR: couldn't open " << incPlotFileName << " for writing: "
-	 << strerror(errno) << endl;
-    exit(EXIT_FAILURE);
-  }
-
-  ofstream boundsFile( boundsFileName.c_str() );
-  if (! boundsFile) {
-    cerr << "ERROR: couldn't open " << boundsFileName << " for writing: "
-	 << strerror(errno) << endl;
-    exit(EXIT_FAILURE);
-  }
-  so.solver->setBoundsFile(&boundsFile);
-  
-  ofstream simOutFile( simFileName.c_str() );
-  if (! simOutFile) {
-    cerr << "ERROR: couldn't open " << simFileName << " for writing: "
-	 << strerror(errno) << endl;
-    exit(EXIT_FAILURE);
-  }
+  // the periodic logs are written by a background thread (see AsyncLog.h)
+  ostream* incPlotFile = newLogStream(incPlotFileName);
+  ostream* boundsFile = newLogStream(boundsFileName);
+  so.solver->setBoundsFile(boundsFile);
+  ostream* simOutFile = newLogStream(simFileName);
 
   int simulationTracesToLogPerEpoch = config.getInt("simulationTracesToLogPerEpoch");
   if (simulationTracesToLogPerEpoch < 0) {
     simulationTracesToLogPerEpoch = INT_MAX;
   }
 
-  ofstream* storageOutputFile = NULL;
+  ostream* storageOutputFile = NULL;
   string storageOutputFileName = config.getString("storageOutputFile");
   if (storageOutputFileName != "none") {
-    storageOutputFile = new ofstream(storageOutputFileName.c_str());
-    if (! storageOutputFile) {
-      cerr << "ERROR: couldn't open " << storageOutputFile << " for writing: "
-	   << strerror(errno) << endl;
-      exit(EXIT_FAILURE);
-    }
+    storageOutputFile = newLogStream(storageOutputFileName);
   }
 
   double terminateLowerBoundValue = config.getDouble("terminateLowerBoundValue");
@@ -108,6 +282,44 @@ void TestDriver::batchTestIncremental(const ZMDPConfig& config,
 
   MDPNode* root = NULL;
 
+  // the evaluator is shared by all epochs so that its cache of the model
+  // (including outcome sampling tables) is only built once
+  BoundPairExec exec;
+  exec.init(so.problem, so.bounds);
+
+  // with reduceModel=1, the simulator runs the model file as written, as
+  // in 'zmdp evaluate', so simulation traces show the original states
+  MDP* simModel = so.problem;
+  MDPExecCore* evalExec = &exec;
+  ReducedModelExec* reducedExec = NULL;
+  ZMDPConfig evalConfig(config);
+  if (NULL != simPomdp) {
+    simModel = simPomdp;
+    reducedExec = new ReducedModelExec(&exec, ((Pomdp*) so.problem)->originalToReducedObs);
+    evalExec = reducedExec;
+    // the solver's bounds are defined over the reduced states
+    if (config.getString("evaluationControlVariate") != "none") {
+      printf("WARNING: evaluationControlVariate is not supported with reduceModel=1; ignoring it\n");
+      evalConfig.setString("evaluationControlVariate", "none");
+    }
+  }
+  PolicyEvaluator eval(simModel, evalExec, &evalConfig,
+		       /* assumeIdenticalModels = */ (NULL == simPomdp));
+  if (NULL == simPomdp) {
+    eval.setControlVariateBounds(so.bounds);
+  }
+
+  // in concurrent mode, epochs evaluate a snapshot of the policy in the
+  // background while the solver continues
+  bool evaluationConcurrent = config.getBool("evaluationConcurrent");
+  if (evaluationConcurrent && config.getString("evaluationControlVariate") == "upper") {
+    printf("WARNING: evaluationControlVariate 'upper' needs the solver's live upper bound; running evaluation epochs inline\n");
+    evaluationConcurrent = false;
+  }
+  TDEvalWorker* worker = NULL;
+  double totalEvalTime = 0.0;
+  double totalStallTime = 0.0;
+
   printf("entering solver main loop\n");
   double timeSoFar = 1e-20;
   double logLastSimTime = -99;
@@ -140,12 +352,7 @@ void TestDriver::batchTestIncremental(const ZMDPConfig& config,
       }
     }
 
-    sim->simOutFile = &simOutFile;
-
-    BoundPairExec exec;
-    exec.init(so.problem, so.bounds);
-    PolicyEvaluator eval(so.problem, &exec, &config,
-			 /* assumeIdenticalModels = */ true);
+    sim->simOutFile = simOutFile;
 
     if ((timeSoFar > firstEpochWallclockSeconds
 	 && log(timeSoFar) - logLastSimTime > ::log(10) / ticksPerOrder)
@@ -155,50 +362,41 @@ void TestDriver::batchTestIncremental(const ZMDPConfig& config,
 	|| solverFinished) {
       logLastSimTime = ::log(timeSoFar);
 
-      // write output policy at each evaluation epoch if that was requested
-      if (NULL != outPolicyFileName) {
-	// create a backup of the policy from the last epoch in case policy
-	// writing is interrupted
-	string cmd = string("mv ") + outPolicyFileName + " " + outPolicyFileName + ".bak >& /dev/null";
-	system(cmd.c_str());
-
-	so.bounds->writePolicy(outPolicyFileName, /* canModifyBounds = */ false);
-
-	// delete the backup
-	cmd = string("rm -f ") + outPolicyFileName + ".bak >& /dev/null";
-	system(cmd.c_str());
+      BoundPair* snapshot = NULL;
+      if (evaluationConcurrent) {
+	snapshot = so.bounds->newPolicySnapshot();
+	if (NULL == snapshot) {
+	  printf("WARNING: this policy type doesn't support snapshots; running evaluation epochs inline\n");
+	  evaluationConcurrent = false;
+	}
       }
 
-      // simulate running the policy many times and collect the per-run total reward values
-      dvector rewardSamples;
-      double successRate;
-      eval.getRewardSamples(rewardSamples, successRate, /* verbose = */ true);
+      if (NULL == snapshot) {
+	TDEvalEpoch ep;
+	ep.bounds = so.bounds;
+	ep.solverTime = timeSoFar;
+	ep.outPolicyFileName = outPolicyFileName;
+	runEvalEpoch(eval, ep);
+	totalEvalTime += ep.evalTime;
+	recordEvalEpoch(*incPlotFile, ep);
+      } else {
+	if (NULL == worker) {
+	  worker = new TDEvalWorker(&eval);
+	}
 
-#if 0
-      // collect policy evaluation statistics and write a line to the log file
-      double avg, stdev;
-      calc_avg_stdev_collection(rewardSamples.data.begin(), rewardSamples.data.end(),
-				avg, stdev);
-
-      incPlotFile << timeSoFar
-		  << " " << avg
-		  << " " << (stdev/::sqrt(numIterations)*1.96)
-		  << " " << successRate << endl;
-#endif
+	// the previous epoch must finish before the evaluator can be reused
+	finishBackgroundEpoch(*worker, *incPlotFile, totalEvalTime, totalStallTime);
 
-      // calculate summary statistics, mean and 95% confidence interval for the mean
-      double mean, quantile1, quantile2;
-      calc_bootstrap_mean_quantile(rewardSamples,
-				   0.05, // 95% confidence interval
-				   mean, quantile1, quantile2);
-
-      incPlotFile << timeSoFar
-		  << " " << mean
-		  << " " << quantile1
-		  << " " << quantile2
-		  << " " << successRate << endl;
-     
-      incPlotFile.flush();
+	TDEvalEpoch* ep = new TDEvalEpoch();
+	ep->bounds = snapshot;
+	ep->solverTime = timeSoFar;
+	ep->outPolicyFileName = outPolicyFileName;
+	exec.init(so.problem, snapshot);
+	if (NULL == simPomdp) {
+	  eval.setControlVariateBounds(snapshot);
+	}
+	worker->start(ep);
+      }
 
       // record storage space used by the bounds representation
       if (storageOutputFile) {
@@ -237,14 +435,31 @@ void TestDriver::batchTestIncremental(const ZMDPConfig& config,
       }
     }
   }
-  incPlotFile.close();
-  boundsFile.close();
-  simOutFile.close();
-  if (storageOutputFile) {
-    storageOutputFile->close();
+  if (NULL != worker) {
+    finishBackgroundEpoch(*worker, *incPlotFile, totalEvalTime, totalStallTime);
+    delete worker;
+  }
+  if (totalStallTime > 0) {
+    printf("(benchmark spent %.3lf seconds solving and %.3lf seconds evaluating; the solver waited %.3lf seconds for evaluation)\n",
+	   timeSoFar, totalEvalTime, totalStallTime);
+  } else {
+    printf("(benchmark spent %.3lf seconds solving and %.3lf seconds evaluating)\n",
+	   timeSoFar, totalEvalTime);
   }
 
   so.solver->finishLogging();
+
+  delete incPlotFile;
+  so.solver->setBoundsFile(NULL);
+  delete boundsFile;
+  sim->simOutFile = NULL;
+  delete simOutFile;
+  if (NULL != reducedExec) {
+    delete reducedExec;
+  }
+  if (storageOutputFile) {
+    delete storageOutputFile;
+  }
 }
   
 }; // namespace zmdp
@@ -43,9 +43,13 @@ public:
   }
 
   double getReward(void) { return sim->rewardSoFar; }
+  // if so.problem is a reduced POMDP (see reduceModel), simPomdp must be
+  // the model file read without reduction; policies are evaluated
+  // against it.  otherwise simPomdp is NULL.
   void batchTestIncremental(const ZMDPConfig& config,
 			    int numIterations,
 			    SolverObjects& so,
+			    Pomdp* simPomdp,
 			    int numSteps,
 			    double minPrecision,
 			    double minOrder, double maxOrder, double ticksPerOrder,
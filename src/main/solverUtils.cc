@@ -54,7 +54,9 @@ static EnumEntry searchStrategyTableG[] = {
   {"rtdp",   S_RTDP},
   {"lrtdp",  S_LRTDP},
   {"hdp",    S_HDP},
+  {"pbvi",   S_PBVI},
   {"script", S_SCRIPT},
+  {"portfolio", S_PORTFOLIO},
   {NULL, -1}
 };
 
@@ -78,6 +80,7 @@ static EnumEntry upperBoundRepresentationTableG[] = {
   {"-",        -1},
   {"point",    V_POINT},
   {"sawtooth", V_SAWTOOTH},
+  {"grid",     V_GRID},
   {NULL, -1}
 };
 
@@ -120,6 +123,45 @@ bool endsWith(const std::string& s,
   return (s.substr(s.size() - suffix.size()) == suffix);
 }
 
+// constructs a Portfolio running the comma-separated list of strategies
+// in strategyList
+static Portfolio* newPortfolio(const std::string& strategyList)
+{
+  std::vector<RTDPCore*> members;
+  std::vector<std::string> names;
+  std::string::size_type start = 0;
+  while (start <= strategyList.size()) {
+    std::string::size_type end = strategyList.find(',', start);
+    if (std::string::npos == end) end = strategyList.size();
+    std::string name = strategyList.substr(start, end - start);
+    start = end + 1;
+
+    switch (getEnum(name, searchStrategyTableG, "portfolioStrategies")) {
+    case S_FRTDP:
+      members.push_back(new FRTDP());
+      break;
+    case S_HSVI:
+      members.push_back(new HSVI());
+      break;
+    case S_RTDP:
+      members.push_back(new RTDP());
+      break;
+    case S_LRTDP:
+      members.push_back(new LRTDP());
+      break;
+    case S_HDP:
+      members.push_back(new HDP());
+      break;
+    default:
+      fprintf(stderr, "ERROR: portfolioStrategies may only list 'frtdp', 'hsvi', 'rtdp', 'lrtdp', and 'hdp', not '%s' (-h for help)\n",
+	      name.c_str());
+      exit(EXIT_FAILURE);
+    }
+    names.push_back(name);
+  }
+  return new Portfolio(members, names);
+}
+
 /**********************************************************************
  * EXPORTED API
  **********************************************************************/
@@ -157,6 +199,7 @@ void SolverParams::setValues(const ZMDPConfig& config)
   }
 
   SU_GET_ENUM(searchStrategy);
+  SU_GET_STRING(portfolioStrategies);
   SU_GET_ENUM(modelType);
   SU_GET_ENUM(lowerBoundRepresentation);
   SU_GET_ENUM(upperBoundRepresentation);
@@ -164,6 +207,9 @@ void SolverParams::setValues(const ZMDPConfig& config)
   SU_GET_BOOL(maintainUpperBound);
 
   SU_GET_STRING(policyOutputFile);
+  SU_GET_STRING(upperBoundOutputFile);
+  SU_GET_STRING(warmStartPolicyFile);
+  SU_GET_STRING(warmStartUpperBoundFile);
 
   SU_GET_BOOL(useFastModelParser);
   SU_GET_DOUBLE(terminateRegretBound);
@@ -262,10 +308,33 @@ void SolverParams::inferMissingValues(void)
     fprintf(stderr, "ERROR: upperBoundRepresentation='sawtooth' requires modelType='pomdp' (-h for help)\n");
     exit(EXIT_FAILURE);
   }
+  if (V_GRID == upperBoundRepresentation && T_POMDP != modelType) {
+    fprintf(stderr, "ERROR: upperBoundRepresentation='grid' requires modelType='pomdp' (-h for help)\n");
+    exit(EXIT_FAILURE);
+  }
+  if (S_PBVI == searchStrategy
+      && (V_MAXPLANES != lowerBoundRepresentation || V_SAWTOOTH != upperBoundRepresentation)) {
+    fprintf(stderr, "ERROR: searchStrategy='pbvi' requires lowerBoundRepresentation='maxPlanes' and upperBoundRepresentation='sawtooth' (-h for help)\n");
+    exit(EXIT_FAILURE);
+  }
 
   if (NULL != policyOutputFile && 0 == strcmp(policyOutputFile, "none")) {
     policyOutputFile = NULL;
   }
+  if (0 == strcmp(upperBoundOutputFile, "none")) {
+    upperBoundOutputFile = NULL;
+  }
+  if (0 == strcmp(warmStartPolicyFile, "none")) {
+    warmStartPolicyFile = NULL;
+  }
+  if (0 == strcmp(warmStartUpperBoundFile, "none")) {
+    warmStartUpperBoundFile = NULL;
+  }
+  if ((NULL != warmStartPolicyFile || NULL != warmStartUpperBoundFile)
+      && T_POMDP != modelType) {
+    fprintf(stderr, "ERROR: warmStartPolicyFile and warmStartUpperBoundFile require modelType='pomdp' (-h for help)\n");
+    exit(EXIT_FAILURE);
+  }
   if (NULL != policyOutputFile && 0 == strcmp(policyOutputFile, "-")) {
     if (usingBenchmarkFrontEnd) {
       policyOutputFile = NULL;
@@ -340,11 +409,22 @@ void constructSolverObjects(SolverObjects& obj,
     lowerBoundRequired = false;
     upperBoundRequired = true;
     break;
+  case S_PBVI:
+    obj.solver = new PBVI();
+    lowerBoundRequired = true;
+    upperBoundRequired = true;
+    break;
   case S_SCRIPT:
     obj.solver = new ScriptedUpdater();
     lowerBoundRequired = false;
     upperBoundRequired = false;
     break;
+  case S_PORTFOLIO:
+    obj.solver = newPortfolio(p.portfolioStrategies);
+    // the termination check uses the gap between the bounds
+    lowerBoundRequired = true;
+    upperBoundRequired = true;
+    break;
   default:
     assert(0); // never reach this point
   };
@@ -421,6 +501,21 @@ void constructSolverObjects(SolverObjects& obj,
       p.policyOutputFile = NULL;
     }
   }
+  if (NULL != p.upperBoundOutputFile
+      && !(p.maintainUpperBound && V_SAWTOOTH == p.upperBoundRepresentation)) {
+    fprintf(stderr, "ERROR: upperBoundOutputFile requires upperBoundRepresentation='sawtooth' and maintainUpperBound=1 (-h for help)\n");
+    exit(EXIT_FAILURE);
+  }
+  if (NULL != p.warmStartUpperBoundFile
+      && p.maintainUpperBound && V_SAWTOOTH != p.upperBoundRepresentation) {
+    fprintf(stderr, "ERROR: warmStartUpperBoundFile requires upperBoundRepresentation='sawtooth' (-h for help)\n");
+    exit(EXIT_FAILURE);
+  }
+  if (NULL != p.warmStartPolicyFile
+      && p.maintainLowerBound && V_MAXPLANES != p.lowerBoundRepresentation) {
+    fprintf(stderr, "ERROR: warmStartPolicyFile requires lowerBoundRepresentation='maxPlanes' (-h for help)\n");
+    exit(EXIT_FAILURE);
+  }
 
   bool dualPointBounds =
     p.maintainLowerBound && p.maintainUpperBound &&
@@ -453,6 +548,7 @@ void constructSolverObjects(SolverObjects& obj,
 
   PointUpperBound* pub;
   SawtoothUpperBound* sub;
+  GridUpperBound* gub;
   if (p.maintainUpperBound) {
     switch (p.upperBoundRepresentation) {
     case V_POINT:
@@ -471,6 +567,11 @@ void constructSolverObjects(SolverObjects& obj,
       sub->core = obj.bounds;
       obj.bounds->upperBound = sub;
       break;
+    case V_GRID:
+      gub = new GridUpperBound(obj.problem, &config);
+      gub->core = obj.bounds;
+      obj.bounds->upperBound = gub;
+      break;
     default:
       assert(0); // never reach this point
     }
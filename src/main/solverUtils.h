@@ -30,9 +30,11 @@
 // search strategies
 #include "FRTDP.h"
 #include "HSVI.h"
+#include "PBVI.h"
 #include "RTDP.h"
 #include "LRTDP.h"
 #include "HDP.h"
+#include "Portfolio.h"
 #include "ScriptedUpdater.h"
 
 // problem types
@@ -47,6 +49,7 @@
 #include "PointUpperBound.h"
 #include "MaxPlanesLowerBound.h"
 #include "SawtoothUpperBound.h"
+#include "GridUpperBound.h"
 #include "BoundPair.h"
 
 // initialization code
@@ -65,7 +68,9 @@ enum StrategiesEnum {
   S_RTDP,
   S_LRTDP,
   S_HDP,
-  S_SCRIPT
+  S_PBVI,
+  S_SCRIPT,
+  S_PORTFOLIO
 };
 
 enum ProbTypesEnum {
@@ -78,7 +83,8 @@ enum ProbTypesEnum {
 enum ValueReprsEnum {
   V_POINT,
   V_MAXPLANES,
-  V_SAWTOOTH
+  V_SAWTOOTH,
+  V_GRID
 };
 
 struct SolverParams {
@@ -87,12 +93,16 @@ struct SolverParams {
   bool usingBenchmarkFrontEnd;
 
   int searchStrategy;
+  const char* portfolioStrategies;
   int modelType;
   int lowerBoundRepresentation;
   int upperBoundRepresentation;
   int maintainLowerBound;
   bool maintainUpperBound;
   const char* policyOutputFile;
+  const char* upperBoundOutputFile;
+  const char* warmStartPolicyFile;
+  const char* warmStartUpperBoundFile;
   bool useFastModelParser;
   double terminateRegretBound;
   double terminateWallclockSeconds;
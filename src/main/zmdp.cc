@@ -31,12 +31,17 @@
 #include "MatrixUtils.h"
 #include "MDPSim.h"
 #include "BoundPairExec.h"
+#include "MaxPlanesLowerBound.h"
+#include "FSCExec.h"
+#include "ReducedModelExec.h"
 #include "LSPathAndReactExec.h"
 #include "solverUtils.h"
 #include "zmdpMainConfig.h"
 #include "PolicyEvaluator.h"
 #include "zmdpCommonTime.h"
 #include "TestDriver.h"
+#include "ThreadPool.h"
+#include "AsyncLog.h"
 
 #include "zmdpMainConfig.cc" // embed default config file
 
@@ -47,7 +52,8 @@ using namespace zmdp;
 enum CommandsEnum {
   CMD_SOLVE,
   CMD_BENCHMARK,
-  CMD_EVALUATE
+  CMD_EVALUATE,
+  CMD_COMPILE_FSC
 };
 
 bool userTerminatedG = false;
@@ -72,9 +78,19 @@ void setSignalHandler(int sig, void (*handler)(int)) {
   }
 }
 
+// seeds the random number generator from the randomSeed config field
+// and reports the seed used, so that a run with a generated seed can be
+// reproduced later
+void initRandomSeed(const ZMDPConfig& config)
+{
+  long seed = init_matrix_utils(config.getInt("randomSeed"));
+  printf("using random seed %ld (--randomSeed %ld reproduces this run)\n",
+	 seed, seed);
+}
+
 void doSolve(const ZMDPConfig& config)
 {
-  init_matrix_utils();
+  initRandomSeed(config);
   StopWatch run;
 
   SolverParams p;
@@ -141,6 +157,10 @@ void doSolve(const ZMDPConfig& config)
     assert(so.bounds->lowerBound != NULL);
     so.bounds->writePolicy(p.policyOutputFile, /* canModifyBounds = */ true);
   }
+  if (NULL != p.upperBoundOutputFile) {
+    printf("%05d writing upper bound to '%s'\n", (int) run.elapsedTime(), p.upperBoundOutputFile);
+    so.bounds->writeUpperBound(p.upperBoundOutputFile, /* canModifyBounds = */ true);
+  }
 
   // finish up logging (if any, according to params specified in the config file)
   printf("%05d finishing logging (e.g., writing qValuesOutputFile if it was requested)\n",
@@ -152,7 +172,7 @@ void doSolve(const ZMDPConfig& config)
 
 void doBenchmark(const ZMDPConfig& config)
 {
-  init_matrix_utils();
+  initRandomSeed(config);
 
   SolverParams p;
   p.setValues(config);
@@ -161,10 +181,20 @@ void doBenchmark(const ZMDPConfig& config)
   SolverObjects so;
   constructSolverObjects(so, p, config);
 
+  // reduceModel only applies to the planner model; policies are
+  // evaluated against the model file as written
+  Pomdp* simPomdp = NULL;
+  if (T_POMDP == p.modelType && ((Pomdp*) so.problem)->getIsReduced()) {
+    ZMDPConfig simConfig(config);
+    simConfig.setBool("reduceModel", false);
+    simPomdp = new Pomdp(p.probName, &simConfig);
+  }
+
   TestDriver x;
   x.batchTestIncremental(config,
 			 /* numIterations = */ p.evaluationTrialsPerEpoch,
 			 so,
+			 simPomdp,
 			 /* numSteps = */ p.evaluationMaxStepsPerTrial,
 			 /* targetPrecision = */ p.terminateRegretBound,
 			 /* minOrder = */ p.evaluationFirstEpochWallclockSeconds,
@@ -176,10 +206,69 @@ void doBenchmark(const ZMDPConfig& config)
 			 /* policyOutputFile = */ p.policyOutputFile);
 }
 
+// the inputs and outputs of the two independent halves of loading for
+// 'zmdp evaluate', which are run in parallel
+struct EvaluateLoadData {
+  const ZMDPConfig* config;
+  std::string policyType;
+  const char* simModelFileName;
+  const char* plannerModelFileName;
+  const char* policyFileName;
+  const char* customModelFileName;
+  bool readSimModel;
+
+  MDPExecCore* exec;
+  MDPExec* mdpExec;
+  Pomdp* simPomdp;
+};
+
+// reads the policy (and the planner model it refers to)
+static void initEvaluateExec(EvaluateLoadData& d)
+{
+  const ZMDPConfig& config = *d.config;
+  const std::string& policyType = d.policyType;
+
+  if (policyType == "maxPlanes" || policyType == "cassandraAlpha") {
+    BoundPairExec* bpExec = new BoundPairExec();
+    bpExec->initReadFiles(d.plannerModelFileName, d.policyFileName, config);
+    d.exec = d.mdpExec = bpExec;
+  } else if (policyType == "fsc") {
+    FSCExec* fscExec = new FSCExec();
+    fscExec->initReadFile(d.policyFileName);
+    d.exec = fscExec;
+  } else if (policyType == "lspath" || policyType == "lsblind") {
+    if (policyType == "lspath" && 0 == strcmp(d.customModelFileName, "none")) {
+      fprintf(stderr, "ERROR: lspath policy type requires --customModel argument (-h for help)\n");
+      exit(EXIT_FAILURE);
+    }
+    LSPathAndReactExec* lpExec = new LSPathAndReactExec();
+    lpExec->init(d.customModelFileName, &config);
+    d.exec = lpExec;
+  } else {
+    fprintf(stderr, "ERROR: unknown policy type '%s' (-h for help)\n",
+	    policyType.c_str());
+    exit(EXIT_FAILURE);
+  }
+}
+
+static void evaluateLoadTask(void* data, int taskIndex)
+{
+  EvaluateLoadData& d = *((EvaluateLoadData*) data);
+  if (0 == taskIndex) {
+    initEvaluateExec(d);
+  } else if (d.readSimModel) {
+    // reduceModel only applies to the planner model; the simulator
+    // always runs the model file as written
+    ZMDPConfig simConfig(*d.config);
+    simConfig.setBool("reduceModel", false);
+    d.simPomdp = new Pomdp(d.simModelFileName, &simConfig);
+  }
+}
+
 void doEvaluate(const ZMDPConfig& config)
 {
   // seeds random number generator
-  init_matrix_utils();
+  initRandomSeed(config);
 
   SolverParams p;
   p.setValues(config);
@@ -192,48 +281,67 @@ void doEvaluate(const ZMDPConfig& config)
   const char* policyFileName = config.getString("policyInputFile").c_str();
   const char* customModelFileName = config.getString("customModel").c_str();
 
-  // initialize exec
-  MDPExecCore* exec = NULL;
-  MDPExec* mdpExec = NULL;
-  std::string policyType = config.getString("policyType");
-  if (policyType == "maxPlanes" || policyType == "cassandraAlpha") {
-    BoundPairExec* bpExec = new BoundPairExec();
-    bpExec->initReadFiles(plannerModelFileName, policyFileName, config);
-    exec = mdpExec = bpExec;
-  } else if (policyType == "lspath" || policyType == "lsblind") {
-    if (policyType == "lspath" && 0 == strcmp(customModelFileName, "none")) {
-      fprintf(stderr, "ERROR: lspath policy type requires --customModel argument (-h for help)\n");
-      exit(EXIT_FAILURE);
-    }
-    LSPathAndReactExec* lpExec = new LSPathAndReactExec();
-    lpExec->init(customModelFileName, &config);
-    exec = lpExec;
+  // initialize exec and simulator.  unless the policy is evaluated
+  // against its own planner model, the simulator model is read in
+  // parallel with the policy.
+  EvaluateLoadData load;
+  load.config = &config;
+  load.policyType = config.getString("policyType");
+  load.simModelFileName = simModelFileName;
+  load.plannerModelFileName = plannerModelFileName;
+  load.policyFileName = policyFileName;
+  load.customModelFileName = customModelFileName;
+  load.readSimModel =
+    !((load.policyType == "maxPlanes" || load.policyType == "cassandraAlpha")
+      && plannerModelFileName == simModelFileName
+      && !config.getBool("reduceModel"));
+  load.exec = NULL;
+  load.mdpExec = NULL;
+  load.simPomdp = NULL;
+  if (load.readSimModel) {
+    ThreadPool loadPool(2);
+    loadPool.run(2, &evaluateLoadTask, &load);
   } else {
-    fprintf(stderr, "ERROR: unknown policy type '%s' (-h for help)\n",
-	    policyType.c_str());
-    exit(EXIT_FAILURE);
+    initEvaluateExec(load);
   }
 
-  // initialize simulator
+  MDPExecCore* exec = load.exec;
+  MDPExec* mdpExec = load.mdpExec;
+  const std::string& policyType = load.policyType;
   Pomdp* simPomdp;
   bool assumeIdenticalModels = false;
-  if (mdpExec != NULL && plannerModelFileName == simModelFileName) {
+  if (!load.readSimModel) {
     simPomdp = (Pomdp*) mdpExec->mdp;
     assumeIdenticalModels = true;
   } else {
-    simPomdp = new Pomdp(simModelFileName, &config);
+    simPomdp = load.simPomdp;
 
     if (mdpExec != NULL) {
       Pomdp* plannerPomdp = (Pomdp*) mdpExec->mdp;
+      // with reduceModel=1, the planner model's observations are merged
+      // but the simulator's are not
+      int plannerNumObs = plannerPomdp->getIsReduced()
+	? (int) plannerPomdp->originalToReducedObs.size()
+	: plannerPomdp->getNumObservations();
       
       if (! ((plannerPomdp->getNumActions() == simPomdp->getNumActions())
-	     && (plannerPomdp->getNumObservations() == simPomdp->getNumObservations()))) {
+	     && (plannerNumObs == simPomdp->getNumObservations()))) {
 	printf("ERROR: planner model %s and evaluation model %s must have the same number of actions and observations\n",
 	       plannerModelFileName, simModelFileName);
 	exit(EXIT_FAILURE);
       }
+      if (plannerPomdp->getIsReduced()) {
+	exec = new ReducedModelExec(exec, plannerPomdp->originalToReducedObs);
+      }
     }
   }
+  if (policyType == "fsc"
+      && ((FSCExec*) exec)->fsc.numObservations != simPomdp->getNumObservations()) {
+    fprintf(stderr, "ERROR: fsc policy %s has %d observations, but model %s has %d\n",
+	    policyFileName, ((FSCExec*) exec)->fsc.numObservations,
+	    simModelFileName, simPomdp->getNumObservations());
+    exit(EXIT_FAILURE);
+  }
   if (zmdpDebugLevelG >= 1) {
     printf("If planning and sim models are identical, evaluator can optimize:\n"
 	   "  assumeIdenticalModels=%d\n",
@@ -254,6 +362,69 @@ void doEvaluate(const ZMDPConfig& config)
   printf("REWARD_MEAN_CONF95MIN_CONF95MAX %.3lf %.3lf %.3lf\n", mean, quantile1, quantile2);
 }
 
+void doCompileFsc(const ZMDPConfig& config)
+{
+  initRandomSeed(config);
+
+  SolverParams p;
+  p.setValues(config);
+
+  const char* modelFileName = config.getString("simulatorModel").c_str();
+  const char* policyFileName = config.getString("policyInputFile").c_str();
+  std::string policyType = config.getString("policyType");
+  if (!(policyType == "maxPlanes" || policyType == "cassandraAlpha")) {
+    fprintf(stderr, "ERROR: compile-fsc requires policy type 'maxPlanes' or 'cassandraAlpha', not '%s'\n",
+	    policyType.c_str());
+    exit(EXIT_FAILURE);
+  }
+  if (NULL == p.policyOutputFile) {
+    fprintf(stderr, "ERROR: compile-fsc requires an output file (-o option)\n");
+    exit(EXIT_FAILURE);
+  }
+
+  BoundPairExec bpExec;
+  bpExec.initReadFiles(modelFileName, policyFileName, config);
+  Pomdp* pomdp = (Pomdp*) bpExec.mdp;
+  MaxPlanesLowerBound* lb = (MaxPlanesLowerBound*) bpExec.bounds->lowerBound;
+
+  StopWatch run;
+  FiniteStateController fsc;
+  fsc.compileFromPlanes(pomdp, lb);
+  printf("compiled %d planes into a controller with %d nodes (took %.3f seconds)\n",
+	 (int) lb->planes.size(), fsc.getNumNodes(), run.elapsedTime());
+
+  // compare the value of the controller to the lower bound that the
+  // planes represent.  with discount=1, evaluate over maxHorizon steps.
+  double discount = pomdp->getDiscount();
+  double precision = config.getDouble("fscEvaluationPrecision");
+  double maxResidual;
+  int maxIterations;
+  if (discount < 1.0) {
+    maxResidual = precision * (1.0 - discount) / discount;
+    maxIterations = 100000;
+  } else {
+    maxResidual = 0.0;
+    maxIterations = (pomdp->maxHorizon > 0) ? pomdp->maxHorizon : 1000;
+  }
+  std::vector<dvector> values;
+  int numSweeps = fsc.evaluate(values, pomdp, maxResidual, maxIterations);
+  const belief_vector& b0 = pomdp->getInitialBelief();
+  double fscVal = inner_prod(values[fsc.startNode], b0);
+  double lbVal = lb->getValue(b0, NULL);
+  printf("controller value at initial belief %.4f, policy lower bound %.4f, difference %.4f\n",
+	 fscVal, lbVal, fscVal - lbVal);
+  if (discount < 1.0 && numSweeps >= maxIterations) {
+    printf("WARNING: controller evaluation did not reach precision %g in %d sweeps\n",
+	   precision, maxIterations);
+  }
+
+  if (pomdp->getIsReduced()) {
+    fsc.expandObservations(pomdp->originalToReducedObs);
+  }
+  printf("writing controller to '%s'\n", p.policyOutputFile);
+  fsc.writeToFile(p.policyOutputFile);
+}
+
 void solveUsage(const char* cmd0)
 {
   cerr <<
@@ -346,6 +517,32 @@ void evaluateUsage(const char* cmd0)
   exit(-1);
 }
 
+void compileFscUsage(const char* cmd0)
+{
+  cerr <<
+    "usage: " << cmd0 << " compile-fsc [options] <model>\n"
+    "  Run 'zmdp -h' for an overview of commands and generic options.\n"
+    "\n"
+    "  'zmdp compile-fsc' converts a POMDP policy output by 'zmdp solve' into\n"
+    "  a finite-state controller, which can be executed without tracking the\n"
+    "  belief, in constant time per step.  The value of the controller is\n"
+    "  calculated and compared with the lower bound represented by the policy.\n"
+    "  Use '--policyType fsc' to evaluate the controller with 'zmdp evaluate'.\n"
+    "\n"
+    "Commonly used options:\n"
+    "  -f        Use fast model parser (for larger RockSample and LifeSurvey problems)\n"
+    "  -o <file> Specify where to write the controller [out.fsc]\n"
+    "  --policyInputFile <file>  Specify the policy to compile [out.policy]\n"
+    "  For many more options and more detailed descriptions, see the config file.\n"
+    "\n"
+    "Examples:\n"
+    "  " << cmd0 << " compile-fsc -f --policyInputFile my.policy -o my.fsc RockSample_5_7.pomdp\n"
+    "  " << cmd0 << " eval -f --policyType fsc --policyInputFile my.fsc RockSample_5_7.pomdp\n"
+    "\n"
+    ;
+  exit(-1);
+}
+
 void genericUsage(const char* cmd0)
 {
   cerr <<
@@ -355,6 +552,7 @@ void genericUsage(const char* cmd0)
     "  zmdp solve      Solves an MDP or POMDP, generating an output policy\n"
     "  zmdp benchmark  Like 'solve', but interleaves evaluation during the solution process\n"
     "  zmdp evaluate   Evaluates a policy output by 'solve' or 'benchmark'\n"
+    "  zmdp compile-fsc  Converts a POMDP policy into a finite-state controller\n"
     "\n"
     "  For more information on a command, run (for example), 'zmdp solve -h'.\n"
     "\n"
@@ -391,6 +589,8 @@ void usage(const char* cmd0, const std::string& cmd1)
     benchmarkUsage(cmd0);
   } else if (cmd1 == "evaluate") {
     evaluateUsage(cmd0);
+  } else if (cmd1 == "compile-fsc") {
+    compileFscUsage(cmd0);
   } else {
     genericUsage(cmd0);
   }
@@ -420,7 +620,8 @@ int main(int argc, char **argv) {
     if (args == "bench") {
       args = "benchmark";
     }
-    if (args == "solve" || args == "benchmark" || args == "evaluate") {
+    if (args == "solve" || args == "benchmark" || args == "evaluate"
+	|| args == "compile-fsc") {
       cmd1 = args;
     }
 
@@ -487,6 +688,8 @@ int main(int argc, char **argv) {
     cmd = CMD_BENCHMARK;
   } else if (cmdStr == "evaluate") {
     cmd = CMD_EVALUATE;
+  } else if (cmdStr == "compile-fsc") {
+    cmd = CMD_COMPILE_FSC;
   } else {
     fprintf(stderr, "ERROR: unknown command '%s' (use -h for help)\n", cmdStr.c_str());
     exit(EXIT_FAILURE);
@@ -508,6 +711,9 @@ int main(int argc, char **argv) {
     case CMD_SOLVE:
       config.setString("policyOutputFile", "out.policy");
       break;
+    case CMD_COMPILE_FSC:
+      config.setString("policyOutputFile", "out.fsc");
+      break;
     case CMD_BENCHMARK:
     case CMD_EVALUATE:
       config.setString("policyOutputFile", "none");
@@ -524,6 +730,8 @@ int main(int argc, char **argv) {
     fflush(stdout);
   }
 
+  setAsyncLogFlushInterval(config.getDouble("logFlushIntervalSeconds"));
+
   // the main show
   switch (cmd) {
   case CMD_SOLVE:
@@ -535,6 +743,9 @@ int main(int argc, char **argv) {
   case CMD_EVALUATE:
     doEvaluate(config);
     break;
+  case CMD_COMPILE_FSC:
+    doCompileFsc(config);
+    break;
   default:
     assert(0); // never reach this point
   }
@@ -117,6 +117,12 @@ double CacheMDP::getReward(const state_vector& s, int a)
   return reward;
 }
 
+int CacheMDP::sampleOutcome(const state_vector& s, int a, RandomStream& rng,
+			    MDPWorkspace& ws)
+{
+  return sampleOutcome(*getQ(*getNode(s), a), rng);
+}
+
 const state_vector& CacheMDP::translateState(state_vector& result, const state_vector& s)
 {
   result = getNode(s)->s;
@@ -179,6 +185,14 @@ CMDPQEntry* CacheMDP::getQ(CMDPNode& cn, int a)
   }
 }
 
+int CacheMDP::sampleOutcome(CMDPQEntry& Qa, RandomStream& rng)
+{
+  if (-1 == Qa.aliasOffset) {
+    Qa.aliasOffset = aliasTables.addTable(Qa.aliasNumBuckets, Qa.opv);
+  }
+  return aliasTables.sample(Qa.aliasOffset, Qa.aliasNumBuckets, rng);
+}
+
 }; // namespace zmdp
 
 /***************************************************************************
@@ -30,6 +30,7 @@
 #include "zmdpConfig.h"
 #include "MDPModel.h"
 #include "AbstractBound.h"
+#include "AliasTable.h"
 
 namespace zmdp {
 
@@ -46,7 +47,12 @@ struct CMDPQEntry {
   double immediateReward;
   outcome_prob_vector opv;
   std::vector<CMDPEdge*> outcomes;
+  // alias table for sampling from opv, built on first use (offset -1
+  // means not built yet)
+  int aliasOffset;
+  int aliasNumBuckets;
 
+  CMDPQEntry(void) : aliasOffset(-1), aliasNumBuckets(0) {}
   size_t getNumOutcomes(void) const { return outcomes.size(); }
 };
 
@@ -78,6 +84,7 @@ struct CacheMDP : public MDP {
   CMDPHash lookup;
   CMDPNodeTable nodeTable;
   state_vector initialSI;
+  AliasTableArena aliasTables;
   
   CacheMDP(MDP* _problem);
   ~CacheMDP(void);
@@ -89,6 +96,8 @@ struct CacheMDP : public MDP {
   state_vector& getNextState(state_vector& result, const state_vector& s, int a,
 			     int o);
   double getReward(const state_vector& s, int a);
+  int sampleOutcome(const state_vector& s, int a, RandomStream& rng,
+		    MDPWorkspace& ws);
   const state_vector& translateState(state_vector& result, const state_vector& s);
 
   AbstractBound* newLowerBound(const ZMDPConfig* _config) { assert(0); }
@@ -97,6 +106,7 @@ struct CacheMDP : public MDP {
   CMDPNode* getNode(const state_vector& s);
   CMDPQEntry* getQ(CMDPNode& cn, int a);
   CMDPNode* getNodeX(const state_vector& s);
+  int sampleOutcome(CMDPQEntry& Qa, RandomStream& rng);
 
 };
 
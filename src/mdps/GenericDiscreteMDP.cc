@@ -57,14 +57,20 @@ GenericDiscreteMDP::GenericDiscreteMDP(const std::string& fileName,
     parser.readGenericDiscreteMDPFromFile(*this, fileName);
   } else {
     CassandraParser parser;
+    parser.numRewardThreads = config->getInt("modelParserThreads");
     parser.readGenericDiscreteMDPFromFile(*this, fileName);
   }
+  shareMatrices();
   
   // in the generic discrete MDP, states are just integers, which
   // we represent using length 1 vectors
   numStateDimensions = 1;
 
   maxHorizon = config->getInt("maxHorizon");
+
+  if (config->getBool("validateCompactStorage")) {
+    validateStorage();
+  }
 }
 
 const state_vector& GenericDiscreteMDP::getInitialState(void)
@@ -121,6 +127,22 @@ state_vector& GenericDiscreteMDP::getNextState(state_vector& result,
   assert(0); // never reach this point
 }
 
+int GenericDiscreteMDP::sampleOutcome(const state_vector& sv, int a,
+				       RandomStream& rng, MDPWorkspace& ws)
+{
+  int s = (int) sv(0);
+
+  if (aliasOffset.empty()) {
+    aliasOffset.resize(numActions, std::vector<int>(numStates, -1));
+    aliasNumBuckets.resize(numActions, std::vector<int>(numStates, 0));
+  }
+  if (-1 == aliasOffset[a][s]) {
+    getOutcomeProbVector(ws.opv, sv, a);
+    aliasOffset[a][s] = aliasTables.addTable(aliasNumBuckets[a][s], ws.opv);
+  }
+  return aliasTables.sample(aliasOffset[a][s], aliasNumBuckets[a][s], rng);
+}
+
 double GenericDiscreteMDP::getReward(const state_vector& sv, int a)
 {
   int s = (int) sv(0);
@@ -30,6 +30,7 @@
 #include "zmdpConfig.h"
 #include "MDPModel.h"
 #include "AbstractBound.h"
+#include "AliasTable.h"
 
 using namespace sla;
 
@@ -40,6 +41,12 @@ struct GenericDiscreteMDP : public CassandraModel {
   double globalLowerBound;
   double globalUpperBound;
 
+  // alias tables for sampleOutcome(), built on first use for each
+  // (state, action) pair.  aliasOffset[a][s] is -1 if not built yet.
+  AliasTableArena aliasTables;
+  std::vector< std::vector<int> > aliasOffset;
+  std::vector< std::vector<int> > aliasNumBuckets;
+
   GenericDiscreteMDP(const std::string& fileName,
 		     const ZMDPConfig* _config);
 
@@ -55,6 +62,8 @@ struct GenericDiscreteMDP : public CassandraModel {
   state_vector& getNextState(state_vector& result,
 			     const state_vector& s,
 			     int a, int o);
+  int sampleOutcome(const state_vector& s, int a, RandomStream& rng,
+		    MDPWorkspace& ws);
 
   double getLongTermFactor(void);
 
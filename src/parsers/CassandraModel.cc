@@ -33,12 +33,106 @@
 #include <iostream>
 #include <fstream>
 
+#include "slaMatrixUtils.h"
 #include "CassandraModel.h"
 
 using namespace std;
 
 namespace zmdp {
 
+/**********************************************************************
+ * SHARED MATRIX VECTOR
+ **********************************************************************/
+
+// FNV-1a hash of n bytes starting at p, continuing from hash h
+static uint64_t hashBytes(uint64_t h, const void* p, size_t n)
+{
+  const unsigned char* bytes = (const unsigned char*) p;
+  FOR (i, n) {
+    h = (h ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static uint64_t getMatrixHash(const cmatrix& A)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  h = hashBytes(h, &A.size1_, sizeof(A.size1_));
+  h = hashBytes(h, &A.size2_, sizeof(A.size2_));
+  if (!A.col_starts.empty()) {
+    h = hashBytes(h, &A.col_starts[0], A.col_starts.size() * sizeof(A.col_starts[0]));
+  }
+  FOR (i, A.data.size()) {
+    h = hashBytes(h, &A.data[i].index, sizeof(A.data[i].index));
+    h = hashBytes(h, &A.data[i].value, sizeof(A.data[i].value));
+  }
+  return h;
+}
+
+static bool getMatricesEqual(const cmatrix& A, const cmatrix& B)
+{
+  if (A.size1() != B.size1() || A.size2() != B.size2()
+      || A.col_starts != B.col_starts || A.data.size() != B.data.size()) {
+    return false;
+  }
+  FOR (i, A.data.size()) {
+    if (A.data[i].index != B.data[i].index
+	|| A.data[i].value != B.data[i].value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SharedMatrixVector::resize(unsigned int numActions)
+{
+  matrices.resize(numActions);
+  matrixOf.resize(numActions);
+  FOR (a, numActions) {
+    matrixOf[a] = a;
+  }
+}
+
+void SharedMatrixVector::share(void)
+{
+  // candidates[h] lists the indices in distinct of the matrices with hash h
+  EXT_NAMESPACE::hash_map<uint64_t, std::vector<int> > candidates;
+  std::vector<cmatrix> distinct;
+  distinct.reserve(matrices.size());
+  std::vector<int> distinctOf(matrices.size());
+
+  FOR (i, matrices.size()) {
+    std::vector<int>& cands = candidates[getMatrixHash(matrices[i])];
+    int match = -1;
+    FOR (j, cands.size()) {
+      if (getMatricesEqual(distinct[cands[j]], matrices[i])) {
+	match = cands[j];
+	break;
+      }
+    }
+    if (-1 == match) {
+      match = distinct.size();
+      distinct.push_back(cmatrix());
+      // swap rather than copy, so peak memory stays near the unshared size
+      distinct.back().size1_ = matrices[i].size1_;
+      distinct.back().size2_ = matrices[i].size2_;
+      distinct.back().col_starts.swap(matrices[i].col_starts);
+      distinct.back().data.swap(matrices[i].data);
+      cands.push_back(match);
+    }
+    distinctOf[i] = match;
+  }
+
+  FOR (a, matrixOf.size()) {
+    matrixOf[a] = distinctOf[matrixOf[a]];
+  }
+  matrices.swap(distinct);
+}
+
+/**********************************************************************
+ * CASSANDRA MODEL
+ **********************************************************************/
+
 CassandraModel::CassandraModel(void) :
   numStates(-1),
   numObservations(-1)
@@ -52,7 +146,7 @@ void CassandraModel::checkForTerminalStates(void)
   isTerminalState.resize(numStates, /* initialValue = */ true);
   FOR (s, numStates) {
     FOR (a, numActions) {
-      if ((fabs(1.0 - T[a](s,s)) > OBS_IS_ZERO_EPS) || R(s,a) != 0.0) {
+      if ((fabs(1.0 - Ttr[a](s,s)) > OBS_IS_ZERO_EPS) || R(s,a) != 0.0) {
 	isTerminalState[s] = false;
 	break;
       }
@@ -60,20 +154,129 @@ void CassandraModel::checkForTerminalStates(void)
   }
 }
 
+void CassandraModel::checkStorageLimits(void)
+{
+  if (((unsigned int) numStates) > SLA_MAX_INDEX
+      || (-1 != numObservations && ((unsigned int) numObservations) > SLA_MAX_INDEX)) {
+    fprintf(stderr,
+	    "ERROR: %s: model has %d states and %d observations, but this binary was\n"
+	    "       built with ZMDP_COMPACT_INDEX, which limits both to %u\n",
+	    fileName.c_str(), numStates, numObservations, (unsigned int) SLA_MAX_INDEX);
+    exit(EXIT_FAILURE);
+  }
+#if ZMDP_COMPACT_STORAGE
+  // generic discrete MDP states are stored as the value of a length-1
+  // vector, so they must be exactly representable in the value type
+  if (-1 == numObservations && numStates > (1 << FLT_MANT_DIG)) {
+    fprintf(stderr,
+	    "ERROR: %s: model has %d states, but this binary was built with\n"
+	    "       ZMDP_COMPACT_STORAGE, which limits MDPs to %d states\n",
+	    fileName.c_str(), numStates, (1 << FLT_MANT_DIG));
+    exit(EXIT_FAILURE);
+  }
+#endif
+}
+
+void CassandraModel::shareMatrices(void)
+{
+  Ttr.share();
+  O.share();
+  if (zmdpDebugLevelG >= 1) {
+    printf("model initialization -- %d actions share %d distinct transition matrices and %d distinct observation matrices\n",
+	   numActions, Ttr.getNumDistinct(), O.getNumDistinct());
+  }
+}
+
+// returns the worst-case L1 error of a distribution relative to the
+// distribution it was parsed from: the rounding error of the stored
+// entries plus any deviation of the stored sum from 1
+static double getDistributionError(double storedSum)
+{
+  if (0.0 == storedSum) return 0.0;
+  return storedSum * SLA_VALUE_ROUNDOFF + fabs(1.0 - storedSum);
+}
+
+void CassandraModel::validateStorage(void)
+{
+  // maximum rounding error in stored rewards
+  double maxAbsReward = 0.0;
+  FOR (a, numActions) {
+    FOR_CM_MINOR (a, R) {
+      maxAbsReward = std::max(maxAbsReward, fabs((double) CM_VAL(R)));
+    }
+  }
+  double rewardError = maxAbsReward * SLA_VALUE_ROUNDOFF;
+
+  // maximum L1 error in stored transition and observation distributions
+  double transError = 0.0, obsError = 0.0;
+  dvector rowSums;
+  FOR (a, numActions) {
+    // Ttr[a] is stored (s',s), so the distributions are its columns
+    FOR (s, numStates) {
+      double colSum = 0.0;
+      FOR_CM_MINOR (s, Ttr[a]) {
+	colSum += CM_VAL(Ttr[a]);
+      }
+      transError = std::max(transError, getDistributionError(colSum));
+    }
+    if (-1 != numObservations) {
+      // O[a] is stored (s',o), so the distributions are its rows
+      rowSums.resize(numStates);
+      FOR (o, numObservations) {
+	FOR_CM_MINOR (o, O[a]) {
+	  rowSums(CM_ROW(o, O[a])) += CM_VAL(O[a]);
+	}
+      }
+      FOR (sp, numStates) {
+	obsError = std::max(obsError, getDistributionError(rowSums(sp)));
+      }
+    }
+  }
+
+  printf("storage: %d-byte values, %d-byte indices, %d bytes per sparse entry\n",
+	 (int) sizeof(sla_value_t), (int) sizeof(sla_index_t),
+	 (int) sizeof(cvector_entry));
+  printf("storage validation: max reward error %g, max transition L1 error %g",
+	 rewardError, transError);
+  if (-1 != numObservations) {
+    printf(", max observation L1 error %g", obsError);
+  }
+  printf("\n");
+
+  if (getDiscount() >= 1.0) {
+    printf("storage validation: model is undiscounted, can't bound value function error\n");
+    return;
+  }
+
+  // simulation lemma: perturbing rewards by at most eR and outcome
+  // distributions by at most eP (L1) changes the optimal value function
+  // by at most (eR + gamma * eP * Vmax) / (1 - gamma).  bound values
+  // stored as sparse vectors (alpha vectors, upper bound points) add
+  // rounding error of at most one roundoff unit per entry of the
+  // belief and of the stored vector.
+  double gamma = getDiscount();
+  double vmax = maxAbsReward / (1.0 - gamma);
+  double modelError = (rewardError + gamma * (transError + obsError) * vmax)
+    / (1.0 - gamma);
+  double representationError = 2 * SLA_VALUE_ROUNDOFF * vmax;
+  printf("storage validation: value function error <= %g (model %g + bound representation %g)\n",
+	 modelError + representationError, modelError, representationError);
+}
+
 void CassandraModel::debugDensity(void)
 {
   double T_size = -1, T_filled = -1;
   double O_size = -1, O_filled = -1;
 
   // use doubles to avoid int overflow (e.g. T_size is sometimes larger than MAX_INT)
-  T_size = ((double) T[0].size1()) * T[0].size2() * numActions;
+  T_size = ((double) Ttr[0].size1()) * Ttr[0].size2() * numActions;
   T_filled = 0;
   if (-1 != numObservations) {
     O_size = ((double) O[0].size1()) * O[0].size2() * numActions;
     O_filled = 0;
   }
   FOR (a, numActions) {
-    T_filled += T[a].filled();
+    T_filled += Ttr[a].filled();
     if (-1 != numObservations) {
       O_filled += O[a].filled();
     }
@@ -89,6 +292,18 @@ void CassandraModel::debugDensity(void)
   }
 }
 
+size_t CassandraModel::getModelBytes(void) const
+{
+  size_t bytes = R.get_bytes();
+  FOR (i, Ttr.matrices.size()) {
+    bytes += Ttr.matrices[i].get_bytes();
+  }
+  FOR (i, O.matrices.size()) {
+    bytes += O.matrices[i].get_bytes();
+  }
+  return bytes;
+}
+
 }; // namespace zmdp
 
 /***************************************************************************
@@ -34,6 +34,32 @@ using namespace sla;
 
 namespace zmdp {
 
+// the per-action matrices of a model.  many models have actions whose
+// matrices are identical (e.g. all movement actions share an
+// observation matrix), so after share() is called each distinct matrix
+// is stored once and (*this)[a] refers to the copy for action a.
+// getId(a) == getId(b) exactly when actions a and b share a matrix.
+// matrices may be modified through operator[] only before share() is
+// called.
+struct SharedMatrixVector {
+  // distinct matrices, and the index in matrices of each action's matrix
+  std::vector<cmatrix> matrices;
+  std::vector<int> matrixOf;
+
+  unsigned int size(void) const { return matrixOf.size(); }
+  void resize(unsigned int numActions);
+
+  cmatrix& operator[](unsigned int a) { return matrices[matrixOf[a]]; }
+  const cmatrix& operator[](unsigned int a) const { return matrices[matrixOf[a]]; }
+
+  int getId(unsigned int a) const { return matrixOf[a]; }
+  int getNumDistinct(void) const { return matrices.size(); }
+
+  // detects identical matrices by content hashing and keeps one copy of
+  // each
+  void share(void);
+};
+
 struct CassandraModel : public MDP {
   int numStates, numObservations;
 
@@ -45,16 +71,42 @@ struct CassandraModel : public MDP {
   cvector initialBelief;
   // R(s,a)
   cmatrix R;
-  // T[a](s,s'), Ttr[a](s',s), O[a](s',o)
-  std::vector<cmatrix> T, Ttr, O;
+  // Ttr[a](s',s), O[a](s',o).  only the transpose of the transition
+  // matrix T[a](s,s') is stored: its columns are the rows of T[a], and
+  // mult_transpose(result, Ttr[a], x) computes T[a] * x.  identical
+  // matrices are shared between actions once shareMatrices() is called.
+  SharedMatrixVector Ttr, O;
   // isTerminalState[s] -- true if s is an absorbing state with 0 reward for all actions
   std::vector<bool> isTerminalState;
 
   // maxHorizon: see main/zmdp.config for an explanation
   int maxHorizon;
 
+  // set by ModelReducer and StateReorderer: originalToReducedState[s]
+  // is the index in the reduced (or reordered) model of state s of the
+  // model file (-1 if s is unreachable), and similarly for observations.
+  // both are empty if the model was neither reduced nor reordered.
+  std::vector<int> originalToReducedState, originalToReducedObs;
+  bool getIsReduced(void) const { return !originalToReducedState.empty(); }
+
+  // set by StateReorderer: stateOrder[s] is the index state s had before
+  // the states were reordered.  empty if the states were not reordered.
+  std::vector<int> stateOrder;
+
   void checkForTerminalStates(void);
+  void checkStorageLimits(void);
+  // shares identical Ttr and O matrices between actions.  call after
+  // the model is fully read (and reduced, if applicable).
+  void shareMatrices(void);
   void debugDensity(void);
+  // returns the number of bytes used to store R, Ttr, and O (counting
+  // shared matrices once)
+  size_t getModelBytes(void) const;
+
+  // reports the rounding error introduced by the storage types selected
+  // in sla.h and an upper bound on the resulting error in the value
+  // function (useful for checking a ZMDP_COMPACT_STORAGE build)
+  void validateStorage(void);
 };
 
 }; // namespace zmdp
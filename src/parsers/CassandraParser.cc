@@ -38,6 +38,7 @@
 #include "MatrixUtils.h"
 #include "slaMatrixUtils.h"
 #include "sla_cassandra.h"
+#include "ThreadPool.h"
 #include "CassandraParser.h"
 
 using namespace std;
@@ -72,6 +73,9 @@ void CassandraParser::readModelFromFile(CassandraModel& p,
     gettimeofday(&startTime,0);
   }
 
+  CASSANDRA_GLOBAL(gNumRewardThreads) = (numRewardThreads <= 0)
+    ? ThreadPool::getNumProcessors() : numRewardThreads;
+
   // this is the main call to Tony Cassandra's parsing code
   if (! readMDP(const_cast<char *>(p.fileName.c_str())) ) {
     // error messages should already have been printed
@@ -95,16 +99,14 @@ void CassandraParser::readModelFromFile(CassandraModel& p,
   kmatrix_transpose_in_place(Rk);
   copy(p.R, Rk);
 
-  // convert T, Tr, and O to sla format
+  // convert Ttr and O to sla format
   kmatrix Tk;
-  p.T.resize(p.numActions);
   p.Ttr.resize(p.numActions);
   if (expectPomdp) {
     p.O.resize(p.numActions);
   }
   FOR (a, p.numActions) {
     copy(Tk, CASSANDRA_GLOBAL(P[a]), p.numStates);
-    copy(p.T[a], Tk);
     kmatrix_transpose_in_place(Tk);
     copy(p.Ttr[a], Tk);
     if (expectPomdp) {
@@ -127,6 +129,7 @@ void CassandraParser::readModelFromFile(CassandraModel& p,
   }
 
   p.checkForTerminalStates();
+  p.checkStorageLimits();
 
   if (zmdpDebugLevelG >= 1) {
     gettimeofday(&endTime,0);
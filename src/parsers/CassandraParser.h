@@ -34,6 +34,12 @@ using namespace sla;
 namespace zmdp {
 
 struct CassandraParser {
+  // number of threads used to compute expected rewards after parsing;
+  // 0 means use one thread per processor
+  int numRewardThreads;
+
+  CassandraParser(void) : numRewardThreads(1) {}
+
   void readGenericDiscreteMDPFromFile(CassandraModel& mdp, const std::string& fileName);
   void readPomdpFromFile(CassandraModel& pomdp, const std::string& fileName);
 
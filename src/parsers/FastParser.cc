@@ -39,7 +39,12 @@
 #include "sla_cassandra.h"
 #include "FastParser.h"
 
-#define POMDP_READ_ERROR_EPS (1e-10)
+#if ZMDP_COMPACT_STORAGE
+// entries are rounded to float precision before the sums are checked
+#  define POMDP_READ_ERROR_EPS (1e-5)
+#else
+#  define POMDP_READ_ERROR_EPS (1e-10)
+#endif
 
 using namespace std;
 using namespace MatrixUtils;
@@ -302,13 +307,11 @@ void FastParser::readModelFromStream(CassandraModel& p,
   copy(p.R, Rx);
   Rx.clear();
 
-  p.T.resize(p.numActions);
   p.Ttr.resize(p.numActions);
   if (expectPomdp) {
     p.O.resize(p.numActions);
   }
   FOR (a, p.numActions) {
-    copy(p.T[a], Tx[a]);
     kmatrix_transpose_in_place(Tx[a]);
     copy(p.Ttr[a], Tx[a]);
 
@@ -356,6 +359,7 @@ void FastParser::readModelFromStream(CassandraModel& p,
   }
 
   p.checkForTerminalStates();
+  p.checkStorageLimits();
 
 #if 1
   // extra error checking
@@ -384,16 +388,18 @@ void FastParser::readStartVector(CassandraModel& p,
 
     int i;
     char *tok;
+    char *tokState;
     double val;
 
     p.initialBelief.resize(p.numStates);
 
-    // consume 'start:' token at the beginning of the statement
-    tok = strtok(data, " ");
+    // consume 'start:' token at the beginning of the statement.  use
+    // strtok_r() so that several models can be read at once.
+    tok = strtok_r(data, " ", &tokState);
 
     for (i=0; i < p.numStates; i++) {
       if (NULL != tok) {
-	tok = strtok(NULL, " ");
+	tok = strtok_r(NULL, " ", &tokState);
       }
       if (NULL == tok) {
 	if (0 == i) {
@@ -0,0 +1,322 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    ModelReducer.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <iostream>
+#include <map>
+#include <queue>
+
+#include "zmdpCommonDefs.h"
+#include "slaMatrixUtils.h"
+#include "ModelReducer.h"
+
+using namespace std;
+
+// probabilities that differ by less than this are considered equal
+// when comparing states and observations (absorbs round-off error in
+// block sums)
+#define MR_PROB_RESOLUTION (1e-9)
+
+namespace zmdp {
+
+typedef std::vector<long long> MRSignature;
+typedef std::map<MRSignature, int> MRSignatureTable;
+
+static long long quantizeProb(double p)
+{
+  return (long long) floor(p / MR_PROB_RESOLUTION + 0.5);
+}
+
+// rewards are compared exactly, by bit pattern
+static long long rewardBits(double r)
+{
+  long long bits;
+  assert(sizeof(bits) == sizeof(r));
+  memcpy(&bits, &r, sizeof(bits));
+  return bits;
+}
+
+// returns the id associated with sig in table, adding a new id if
+// necessary
+static int getSignatureId(MRSignatureTable& table, const MRSignature& sig)
+{
+  MRSignatureTable::iterator pr = table.find(sig);
+  if (table.end() == pr) {
+    int id = table.size();
+    table[sig] = id;
+    return id;
+  } else {
+    return pr->second;
+  }
+}
+
+void ModelReducer::reducePomdp(CassandraModel& p)
+{
+  numStates = p.numStates;
+
+  // reachability
+  std::vector<bool> reachable;
+  markReachable(reachable, p);
+  int numReachable = 0;
+  FOR (s, numStates) {
+    if (reachable[s]) numReachable++;
+  }
+
+  // bisimulation; afterward blockOf[s] is the block index of s, or -1
+  // if s is unreachable
+  int numBlocks = refinePartition(p, reachable);
+
+  // renumber the blocks in order of their first member, so that the
+  // reduced model preserves the original state order, and pick the
+  // first member of each block as its representative
+  std::vector<int> renumber(numBlocks, -1);
+  std::vector<int> reps;
+  FOR (s, numStates) {
+    int b = blockOf[s];
+    if (-1 != b && -1 == renumber[b]) {
+      renumber[b] = reps.size();
+      reps.push_back(s);
+    }
+  }
+  FOR (s, numStates) {
+    if (-1 != blockOf[s]) {
+      blockOf[s] = renumber[blockOf[s]];
+    }
+  }
+
+  std::vector<int> obsMap;
+  int numReducedObs = mergeObservations(obsMap, p, reps);
+
+  // build the reduced model
+  kmatrix Rx(numBlocks, p.numActions);
+  FOR (a, p.numActions) {
+    FOR_CM_MINOR (a, p.R) {
+      int s = CM_ROW(a, p.R);
+      if (-1 != blockOf[s] && reps[blockOf[s]] == s) {
+	Rx.push_back(blockOf[s], a, CM_VAL(p.R));
+      }
+    }
+  }
+  copy(p.R, Rx);
+
+  FOR (a, p.numActions) {
+    kmatrix Tx(numBlocks, numBlocks);
+    FOR (b, numBlocks) {
+      std::map<int, double> blockProbs;
+      FOR_CM_MINOR (reps[b], p.Ttr[a]) {
+	int sp = CM_ROW(reps[b], p.Ttr[a]);
+	// markReachable() only follows positive entries, so an explicit
+	// zero entry can lead to a dropped state
+	if (CM_VAL(p.Ttr[a]) <= 0 || -1 == blockOf[sp]) continue;
+	blockProbs[blockOf[sp]] += CM_VAL(p.Ttr[a]);
+      }
+      FOR_EACH (bp, blockProbs) {
+	Tx.push_back(b, bp->first, bp->second);
+      }
+    }
+    kmatrix_transpose_in_place(Tx);
+    copy(p.Ttr[a], Tx);
+
+    std::map<std::pair<int,int>, double> obsProbs;
+    FOR (o, p.numObservations) {
+      FOR_CM_MINOR (o, p.O[a]) {
+	int sp = CM_ROW(o, p.O[a]);
+	if (-1 != blockOf[sp] && reps[blockOf[sp]] == sp) {
+	  obsProbs[std::make_pair(obsMap[o], (int) blockOf[sp])] += CM_VAL(p.O[a]);
+	}
+      }
+    }
+    kmatrix Ox(numBlocks, numReducedObs);
+    FOR_EACH (op, obsProbs) {
+      Ox.push_back(op->first.second, op->first.first, op->second);
+    }
+    copy(p.O[a], Ox);
+  }
+
+  dvector b0(numBlocks);
+  FOR_CV (p.initialBelief) {
+    if (CV_VAL(p.initialBelief) <= 0) continue;
+    b0(blockOf[CV_INDEX(p.initialBelief)]) += CV_VAL(p.initialBelief);
+  }
+  copy(p.initialBelief, b0);
+
+  int originalNumObs = p.numObservations;
+  p.numStates = numBlocks;
+  p.numObservations = numReducedObs;
+  p.isTerminalState.clear();
+  p.checkForTerminalStates();
+
+  p.originalToReducedState = blockOf;
+  p.originalToReducedObs = obsMap;
+
+  printf("model reduction: %d states (%d reachable) -> %d, %d observations -> %d\n",
+	 numStates, numReachable, numBlocks, originalNumObs, numReducedObs);
+}
+
+// marks the states reachable from the initial belief under any sequence
+// of actions
+void ModelReducer::markReachable(std::vector<bool>& reachable, const CassandraModel& p)
+{
+  reachable.clear();
+  reachable.resize(numStates, false);
+
+  std::queue<int> q;
+  FOR_CV (p.initialBelief) {
+    if (CV_VAL(p.initialBelief) > 0) {
+      reachable[CV_INDEX(p.initialBelief)] = true;
+      q.push(CV_INDEX(p.initialBelief));
+    }
+  }
+  while (!q.empty()) {
+    int s = q.front();
+    q.pop();
+    FOR (a, p.numActions) {
+      FOR_CM_MINOR (s, p.Ttr[a]) {
+	int sp = CM_ROW(s, p.Ttr[a]);
+	if (!reachable[sp] && CM_VAL(p.Ttr[a]) > 0) {
+	  reachable[sp] = true;
+	  q.push(sp);
+	}
+      }
+    }
+  }
+}
+
+// partitions the reachable states into bisimulation blocks, setting
+// blockOf.  returns the number of blocks.
+int ModelReducer::refinePartition(const CassandraModel& p,
+				  const std::vector<bool>& reachable)
+{
+  std::vector<MRSignature> sigs(numStates);
+
+  // initial partition: states must agree on rewards and on the
+  // observation probabilities when they are entered
+  FOR (a, p.numActions) {
+    FOR_CM_MINOR (a, p.R) {
+      int s = CM_ROW(a, p.R);
+      sigs[s].push_back(a);
+      sigs[s].push_back(rewardBits(CM_VAL(p.R)));
+    }
+  }
+  FOR (a, p.numActions) {
+    FOR (o, p.numObservations) {
+      FOR_CM_MINOR (o, p.O[a]) {
+	int sp = CM_ROW(o, p.O[a]);
+	sigs[sp].push_back(-1 - a);
+	sigs[sp].push_back(o);
+	sigs[sp].push_back(quantizeProb(CM_VAL(p.O[a])));
+      }
+    }
+  }
+
+  blockOf.clear();
+  blockOf.resize(numStates, -1);
+  MRSignatureTable table;
+  FOR (s, numStates) {
+    if (reachable[s]) {
+      blockOf[s] = getSignatureId(table, sigs[s]);
+    }
+  }
+  int numBlocks = table.size();
+
+  // refine: split blocks whose members have different probabilities of
+  // transitioning into some block, until no more splits occur
+  while (1) {
+    table.clear();
+    std::vector<int> newBlockOf(numStates, -1);
+    FOR (s, numStates) {
+      if (!reachable[s]) continue;
+      MRSignature& sig = sigs[s];
+      sig.clear();
+      sig.push_back(blockOf[s]);
+      FOR (a, p.numActions) {
+	std::map<int, double> blockProbs;
+	FOR_CM_MINOR (s, p.Ttr[a]) {
+	  // skip explicit zero entries, as in reducePomdp()
+	  if (CM_VAL(p.Ttr[a]) <= 0) continue;
+	  blockProbs[blockOf[CM_ROW(s, p.Ttr[a])]] += CM_VAL(p.Ttr[a]);
+	}
+	sig.push_back(-1 - a);
+	FOR_EACH (bp, blockProbs) {
+	  sig.push_back(bp->first);
+	  sig.push_back(quantizeProb(bp->second));
+	}
+      }
+      newBlockOf[s] = getSignatureId(table, sig);
+    }
+    blockOf.swap(newBlockOf);
+
+    int oldNumBlocks = numBlocks;
+    numBlocks = table.size();
+    if (numBlocks == oldNumBlocks) break;
+  }
+
+  return numBlocks;
+}
+
+// finds observations that have identical probabilities in the reduced
+// model for every action and arrival state.  sets obsMap[o] to the
+// reduced index of observation o and returns the number of reduced
+// observations.
+int ModelReducer::mergeObservations(std::vector<int>& obsMap,
+				    const CassandraModel& p,
+				    const std::vector<int>& reps)
+{
+  std::vector<MRSignature> sigs(p.numObservations);
+  FOR (a, p.numActions) {
+    FOR (o, p.numObservations) {
+      sigs[o].push_back(-1 - a);
+      FOR_CM_MINOR (o, p.O[a]) {
+	int sp = CM_ROW(o, p.O[a]);
+	if (-1 != blockOf[sp] && reps[blockOf[sp]] == sp) {
+	  sigs[o].push_back(blockOf[sp]);
+	  sigs[o].push_back(quantizeProb(CM_VAL(p.O[a])));
+	}
+      }
+    }
+  }
+
+  MRSignatureTable table;
+  obsMap.resize(p.numObservations);
+  FOR (o, p.numObservations) {
+    obsMap[o] = getSignatureId(table, sigs[o]);
+  }
+  return table.size();
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,66 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    ModelReducer.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCModelReducer_h
+#define INCModelReducer_h
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "CassandraModel.h"
+
+using namespace sla;
+
+namespace zmdp {
+
+// Shrinks a POMDP in place before it is solved: drops states that are
+// unreachable from the initial belief, merges bisimilar states (states
+// with the same rewards and observation probabilities whose transition
+// probabilities into each block of merged states agree), and merges
+// observations whose probabilities are identical.  The reduced model
+// has the same optimal value function, lifted to the original states.
+// The maps from original to reduced state and observation indices are
+// stored in the model so that policies can be written and read in terms
+// of the original model.
+struct ModelReducer {
+  void reducePomdp(CassandraModel& pomdp);
+
+protected:
+  int numStates;
+  std::vector<int> blockOf;
+
+  void markReachable(std::vector<bool>& reachable, const CassandraModel& p);
+  int refinePartition(const CassandraModel& p, const std::vector<bool>& reachable);
+  int mergeObservations(std::vector<int>& obsMap, const CassandraModel& p,
+			const std::vector<int>& reps);
+};
+
+}; // namespace zmdp
+
+#endif // INCModelReducer_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
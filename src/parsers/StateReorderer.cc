@@ -0,0 +1,310 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    StateReorderer.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <iostream>
+#include <queue>
+
+#include "zmdpCommonDefs.h"
+#include "slaMatrixUtils.h"
+#include "StateReorderer.h"
+
+using namespace std;
+
+namespace zmdp {
+
+struct SRDegreeLess {
+  const std::vector< std::vector<int> >& neighbors;
+
+  SRDegreeLess(const std::vector< std::vector<int> >& _neighbors) :
+    neighbors(_neighbors)
+  {}
+
+  // orders states by degree, breaking ties by index
+  bool operator()(int s, int t) const {
+    if (neighbors[s].size() != neighbors[t].size()) {
+      return neighbors[s].size() < neighbors[t].size();
+    }
+    return s < t;
+  }
+};
+
+// returns the largest distance |s - s'| between the indices of a state
+// and a successor
+static int getBandwidth(const CassandraModel& p)
+{
+  int bandwidth = 0;
+  FOR (a, p.numActions) {
+    FOR (s, p.numStates) {
+      FOR_CM_MINOR (s, p.Ttr[a]) {
+	bandwidth = std::max(bandwidth, abs((int) CM_ROW(s, p.Ttr[a]) - (int) s));
+      }
+    }
+  }
+  return bandwidth;
+}
+
+int StateReorderer::parseOrdering(const std::string& name)
+{
+  if (name == "none") return SO_NONE;
+  if (name == "rcm") return SO_RCM;
+  if (name == "bfs") return SO_BFS;
+
+  fprintf(stderr, "ERROR: invalid value %s for config field reorderStates, expected one of 'none' 'rcm' 'bfs' (-h for help)\n",
+	  name.c_str());
+  exit(EXIT_FAILURE);
+}
+
+void StateReorderer::reorderPomdp(CassandraModel& p, int ordering)
+{
+  if (SO_NONE == ordering) return;
+
+  numStates = p.numStates;
+  int oldBandwidth = getBandwidth(p);
+
+  std::vector<int> order;
+  if (SO_RCM == ordering) {
+    getNeighbors(p, /* symmetric = */ true);
+    getRCMOrder(order);
+  } else {
+    getNeighbors(p, /* symmetric = */ false);
+    getBFSOrder(order, p);
+  }
+  neighbors.clear();
+
+  applyOrder(p, order);
+
+  printf("state reordering (%s): transition bandwidth %d -> %d\n",
+	 (SO_RCM == ordering) ? "rcm" : "bfs", oldBandwidth, getBandwidth(p));
+}
+
+// sets neighbors[s] to the successors of s under any action, in index
+// order.  if symmetric is true, predecessors are included as well.
+void StateReorderer::getNeighbors(const CassandraModel& p, bool symmetric)
+{
+  neighbors.clear();
+  neighbors.resize(numStates);
+  FOR (a, p.numActions) {
+    FOR (s, numStates) {
+      FOR_CM_MINOR (s, p.Ttr[a]) {
+	int sp = CM_ROW(s, p.Ttr[a]);
+	if (sp != (int) s) {
+	  neighbors[s].push_back(sp);
+	  if (symmetric) {
+	    neighbors[sp].push_back(s);
+	  }
+	}
+      }
+    }
+  }
+  FOR (s, numStates) {
+    std::vector<int>& n = neighbors[s];
+    std::sort(n.begin(), n.end());
+    n.erase(std::unique(n.begin(), n.end()), n.end());
+  }
+}
+
+// reverse Cuthill-McKee: each connected component is numbered in
+// breadth-first order from a pseudo-peripheral state, visiting the
+// neighbors of each state in order of increasing degree, and the
+// resulting order is reversed
+void StateReorderer::getRCMOrder(std::vector<int>& order)
+{
+  SRDegreeLess degreeLess(neighbors);
+
+  // candidate starting states, lowest degree first
+  std::vector<int> byDegree(numStates);
+  FOR (s, numStates) {
+    byDegree[s] = s;
+  }
+  std::sort(byDegree.begin(), byDegree.end(), degreeLess);
+
+  order.clear();
+  order.reserve(numStates);
+  std::vector<bool> visited(numStates, false);
+  std::vector<int> level(numStates, -1);
+  std::vector<int> component, sortedNbrs;
+
+  FOR (i, numStates) {
+    int start = byDegree[i];
+    if (visited[start]) continue;
+
+    // find a pseudo-peripheral start state (George and Liu): move to a
+    // lowest-degree state in the last level of the breadth-first
+    // traversal until the number of levels stops growing
+    int numLevels = -1;
+    while (1) {
+      component.clear();
+      component.push_back(start);
+      level[start] = 0;
+      for (unsigned int j = 0; j < component.size(); j++) {
+	int s = component[j];
+	FOR_EACH (np, neighbors[s]) {
+	  if (-1 == level[*np]) {
+	    level[*np] = level[s] + 1;
+	    component.push_back(*np);
+	  }
+	}
+      }
+      int lastLevel = level[component.back()];
+      int candidate = -1;
+      FOR_EACH (sp, component) {
+	if (level[*sp] == lastLevel
+	    && (-1 == candidate || degreeLess(*sp, candidate))) {
+	  candidate = *sp;
+	}
+	level[*sp] = -1;
+      }
+      if (lastLevel <= numLevels) break;
+      numLevels = lastLevel;
+      start = candidate;
+    }
+
+    // Cuthill-McKee traversal of the component
+    int first = order.size();
+    order.push_back(start);
+    visited[start] = true;
+    for (unsigned int j = first; j < order.size(); j++) {
+      int s = order[j];
+      sortedNbrs.clear();
+      FOR_EACH (np, neighbors[s]) {
+	if (!visited[*np]) {
+	  visited[*np] = true;
+	  sortedNbrs.push_back(*np);
+	}
+      }
+      std::sort(sortedNbrs.begin(), sortedNbrs.end(), degreeLess);
+      order.insert(order.end(), sortedNbrs.begin(), sortedNbrs.end());
+    }
+  }
+
+  std::reverse(order.begin(), order.end());
+}
+
+// breadth-first order from the support of the initial belief, followed
+// by the states that are not reachable in their original order
+void StateReorderer::getBFSOrder(std::vector<int>& order, const CassandraModel& p)
+{
+  order.clear();
+  order.reserve(numStates);
+  std::vector<bool> visited(numStates, false);
+  FOR_CV (p.initialBelief) {
+    if (CV_VAL(p.initialBelief) > 0) {
+      visited[CV_INDEX(p.initialBelief)] = true;
+      order.push_back(CV_INDEX(p.initialBelief));
+    }
+  }
+  FOR (j, order.size()) {
+    FOR_EACH (np, neighbors[order[j]]) {
+      if (!visited[*np]) {
+	visited[*np] = true;
+	order.push_back(*np);
+      }
+    }
+  }
+  FOR (s, numStates) {
+    if (!visited[s]) {
+      order.push_back(s);
+    }
+  }
+}
+
+// renumbers the states of p so that state order[i] becomes state i
+void StateReorderer::applyOrder(CassandraModel& p, const std::vector<int>& order)
+{
+  std::vector<int> newIndex(numStates);
+  FOR (i, numStates) {
+    newIndex[order[i]] = i;
+  }
+
+  kmatrix Rx(numStates, p.numActions);
+  FOR (a, p.numActions) {
+    FOR_CM_MINOR (a, p.R) {
+      Rx.push_back(newIndex[CM_ROW(a, p.R)], a, CM_VAL(p.R));
+    }
+  }
+  copy(p.R, Rx);
+
+  FOR (a, p.numActions) {
+    kmatrix Tx(numStates, numStates);
+    FOR (s, numStates) {
+      FOR_CM_MINOR (s, p.Ttr[a]) {
+	Tx.push_back(newIndex[CM_ROW(s, p.Ttr[a])], newIndex[s], CM_VAL(p.Ttr[a]));
+      }
+    }
+    copy(p.Ttr[a], Tx);
+
+    kmatrix Ox(numStates, p.numObservations);
+    FOR (o, p.numObservations) {
+      FOR_CM_MINOR (o, p.O[a]) {
+	Ox.push_back(newIndex[CM_ROW(o, p.O[a])], o, CM_VAL(p.O[a]));
+      }
+    }
+    copy(p.O[a], Ox);
+  }
+
+  dvector b0(numStates);
+  FOR_CV (p.initialBelief) {
+    b0(newIndex[CV_INDEX(p.initialBelief)]) = CV_VAL(p.initialBelief);
+  }
+  copy(p.initialBelief, b0);
+
+  std::vector<bool> isTerminal(numStates);
+  FOR (s, numStates) {
+    isTerminal[newIndex[s]] = p.isTerminalState[s];
+  }
+  p.isTerminalState.swap(isTerminal);
+
+  // policies are written in terms of the states of the model file, so
+  // compose the renumbering with the reduction maps
+  if (p.getIsReduced()) {
+    FOR_EACH (rp, p.originalToReducedState) {
+      if (-1 != *rp) {
+	*rp = newIndex[*rp];
+      }
+    }
+  } else {
+    p.originalToReducedState = newIndex;
+    p.originalToReducedObs.resize(p.numObservations);
+    FOR (o, p.numObservations) {
+      p.originalToReducedObs[o] = o;
+    }
+  }
+  p.stateOrder = order;
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
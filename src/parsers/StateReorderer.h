@@ -0,0 +1,83 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    StateReorderer.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCStateReorderer_h
+#define INCStateReorderer_h
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "CassandraModel.h"
+
+using namespace sla;
+
+namespace zmdp {
+
+enum StateOrderingEnum {
+  SO_NONE,
+  SO_RCM,
+  SO_BFS
+};
+
+// Renumbers the states of a POMDP in place so that states that are
+// connected by transitions get nearby indices.  This improves the
+// memory locality of the sparse transition matrices and of the beliefs
+// and alpha vectors computed from them.  The orderings are:
+//
+//   SO_RCM: reverse Cuthill-McKee ordering of the graph whose edges are
+//     the nonzero entries of T[a] over all actions, which reduces the
+//     bandwidth of the transition matrices.
+//   SO_BFS: breadth-first order of the states reachable from the
+//     initial belief, followed by the other states in their original
+//     order.
+//
+// The renumbering is composed with the maps set by ModelReducer, so
+// policies are still written and read in terms of the original model.
+// stateOrder records the inverse permutation so that other output (e.g.
+// simulation traces) can be translated back.
+struct StateReorderer {
+  void reorderPomdp(CassandraModel& pomdp, int ordering);
+
+  // returns the StateOrderingEnum value for the given config string,
+  // or exits with an error message
+  static int parseOrdering(const std::string& name);
+
+protected:
+  int numStates;
+  std::vector< std::vector<int> > neighbors;
+
+  void getNeighbors(const CassandraModel& p, bool symmetric);
+  void getRCMOrder(std::vector<int>& order);
+  void getBFSOrder(std::vector<int>& order, const CassandraModel& p);
+  void applyOrder(CassandraModel& p, const std::vector<int>& order);
+};
+
+}; // namespace zmdp
+
+#endif // INCStateReorderer_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -26,6 +26,7 @@
 #include <stdio.h>
 
 #include "decision-tree.h"
+#include "parse_thread.h"
 
 /**********************************************************************
  * MACROS
@@ -63,6 +64,29 @@ struct DTNodeStruct {
 typedef struct DTNodeStruct DTNode;
 typedef struct DTTableStruct DTTable;
 
+/* A node of the flattened tree built by dtCompile().  All nodes live in
+   one array and all table entries in another, so a query is a short
+   loop over two contiguous arrays rather than a recursive descent
+   through separately allocated nodes.  Table entries that were NULL in
+   the original tree point directly at the default entry. */
+struct DTFlatNodeStruct {
+  int entriesStart; /* index into the entries array, or -1 for a value node */
+  double val;
+};
+
+typedef struct DTFlatNodeStruct DTFlatNode;
+
+struct DTFlatTreeStruct {
+  DTFlatNode* nodes;
+  int numNodes;
+  int nodesCapacity;
+  int* entries;
+  int numEntries;
+  int entriesCapacity;
+};
+
+typedef struct DTFlatTreeStruct DTFlatTree;
+
 /**********************************************************************
  * FUNCTION PROTOTYPES
  **********************************************************************/
@@ -78,13 +102,24 @@ static DTNode* dtConvertToTable(DTNode* in, int numEntries);
 static void dtSpaces(int indent);
 static void dtDebugPrintNode(DTNode* n, int indent);
 static void dtDebugPrintTable(DTTable* t, int indent);
+static int dtFlatNewNode(void);
+static int dtFlatReserveEntries(int numEntries);
+static int dtFlattenNode(const DTNode* n);
+static void dtFreeFlat(void);
+static double dtFlatGet(int* vec);
 
 /**********************************************************************
  * GLOBAL VARIABLES
  **********************************************************************/
 
-static int* gTableSizes = NULL;
-static DTNode* gTree = NULL;
+static PARSE_THREAD_LOCAL int* gTableSizes = NULL;
+static PARSE_THREAD_LOCAL DTNode* gTree = NULL;
+
+/* gFlatTree is the calling thread's own compiled tree.  gFlat points
+   to the compiled tree that queries use: either gFlatTree or, after
+   dtUseCompiled(), another thread's. */
+static PARSE_THREAD_LOCAL DTFlatTree gFlatTree;
+static PARSE_THREAD_LOCAL const DTFlatTree* gFlat = NULL;
 
 /**********************************************************************
  * INTERNAL HELPER FUNCTIONS
@@ -279,6 +314,92 @@ static double dtGetInternal(DTNode* node, int* vec, int index)
   }
 }
 
+static int dtFlatNewNode(void)
+{
+  DTFlatTree* t = &gFlatTree;
+
+  if (t->numNodes == t->nodesCapacity) {
+    t->nodesCapacity = (0 == t->nodesCapacity) ? 64 : 2*t->nodesCapacity;
+    t->nodes = (DTFlatNode*) realloc(t->nodes,
+				     t->nodesCapacity * sizeof(DTFlatNode));
+  }
+  return t->numNodes++;
+}
+
+static int dtFlatReserveEntries(int numEntries)
+{
+  DTFlatTree* t = &gFlatTree;
+  int start;
+
+  while (t->numEntries + numEntries > t->entriesCapacity) {
+    t->entriesCapacity =
+      (0 == t->entriesCapacity) ? 256 : 2*t->entriesCapacity;
+    t->entries = (int*) realloc(t->entries,
+				t->entriesCapacity * sizeof(int));
+  }
+  start = t->numEntries;
+  t->numEntries += numEntries;
+  return start;
+}
+
+/* appends n and its subtree to the flat arrays, returning the index of n.
+   the arrays may be reallocated during recursion, so only indices are
+   held across recursive calls. */
+static int dtFlattenNode(const DTNode* n)
+{
+  int i, out, start, defaultIndex, entryIndex;
+
+  assert(NULL != n);
+
+  out = dtFlatNewNode();
+  switch (n->type) {
+  case DT_VAL:
+    gFlatTree.nodes[out].entriesStart = -1;
+    gFlatTree.nodes[out].val = n->data.val;
+    break;
+  case DT_TABLE:
+    start = dtFlatReserveEntries(n->data.subTree.numEntries);
+    gFlatTree.nodes[out].entriesStart = start;
+    gFlatTree.nodes[out].val = 0;
+    defaultIndex = dtFlattenNode(n->data.subTree.defaultEntry);
+    for (i = 0; i < n->data.subTree.numEntries; i++) {
+      if (NULL == n->data.subTree.entries[i]) {
+	entryIndex = defaultIndex;
+      } else {
+	entryIndex = dtFlattenNode(n->data.subTree.entries[i]);
+      }
+      gFlatTree.entries[start + i] = entryIndex;
+    }
+    break;
+  default:
+    assert(0 /* never reach this point */);
+  }
+
+  return out;
+}
+
+static void dtFreeFlat(void)
+{
+  free(gFlatTree.nodes);
+  free(gFlatTree.entries);
+  memset(&gFlatTree, 0, sizeof(gFlatTree));
+  gFlat = NULL;
+}
+
+static double dtFlatGet(int* vec)
+{
+  const DTFlatNode* nodes = gFlat->nodes;
+  const int* entries = gFlat->entries;
+  int n = 0;
+  int index = 0;
+
+  while (nodes[n].entriesStart >= 0) {
+    n = entries[nodes[n].entriesStart + vec[index]];
+    index++;
+  }
+  return nodes[n].val;
+}
+
 static void dtSpaces(int indent)
 {
   int i;
@@ -355,6 +476,8 @@ void dtAdd(int action, int cur_state, int next_state, int obs, double val)
   vec[2] = next_state;
   vec[3] = obs;
 
+  /* any compiled copy is now stale */
+  dtFreeFlat();
   gTree = dtAddInternal(gTree, vec, 0, val);
 }
 
@@ -366,11 +489,63 @@ double dtGet(int action, int cur_state, int next_state, int obs)
   vec[2] = next_state;
   vec[3] = obs;
 
-  return dtGetInternal(gTree, vec, 0);
+  if (NULL != gFlat) {
+    return dtFlatGet(vec);
+  } else {
+    return dtGetInternal(gTree, vec, 0);
+  }
+}
+
+void dtCompile(void)
+{
+  dtFreeFlat();
+  dtFlattenNode(gTree);
+  gFlat = &gFlatTree;
+}
+
+const void* dtGetCompiled(void)
+{
+  return gFlat;
+}
+
+void dtUseCompiled(const void* compiled)
+{
+  gFlat = (const DTFlatTree*) compiled;
+}
+
+int dtGetIfConstant(int action, int cur_state, double* valP)
+{
+  int vec[2];
+  int index;
+  int n;
+  const DTNode* node;
+
+  vec[0] = action;
+  vec[1] = cur_state;
+
+  if (NULL != gFlat) {
+    n = 0;
+    for (index = 0; index < 2 && gFlat->nodes[n].entriesStart >= 0; index++) {
+      n = gFlat->entries[gFlat->nodes[n].entriesStart + vec[index]];
+    }
+    if (gFlat->nodes[n].entriesStart >= 0) return 0;
+    *valP = gFlat->nodes[n].val;
+  } else {
+    node = gTree;
+    for (index = 0; index < 2 && DT_TABLE == node->type; index++) {
+      const DTNode* entry = node->data.subTree.entries[vec[index]];
+      node = (NULL == entry) ? node->data.subTree.defaultEntry : entry;
+    }
+    if (DT_VAL != node->type) return 0;
+    *valP = node->data.val;
+  }
+
+  return 1;
 }
 
 void dtDeallocate(void)
 {
+  dtFreeFlat();
   dtDestroyNode(gTree);
   gTree = NULL;
   free(gTableSizes);
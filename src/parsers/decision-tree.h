@@ -34,6 +34,8 @@
    * Construct the immediate reward mapping by calling dtInit() and
      repeatedly calling dtAdd(), one time for each "entry" in the mapping.
 
+   * Optionally call dtCompile() to speed up later queries.
+
    * Query immediate rewards by calling dtGet().
 
    * When finished, call dtDeallocate().
@@ -56,6 +58,27 @@ extern void dtAdd(int action, int cur_state, int next_state, int obs, double val
 /* Returns the immediate reward for a particular [a,s,s',o] tuple. */
 extern double dtGet(int action, int cur_state, int next_state, int obs);
 
+/* Builds a flattened, read-only copy of the decision tree that later
+   dtGet() calls use instead of the pointer-based tree.  Call it once
+   after the last dtAdd(); a later dtAdd() discards the copy.  dtGet()
+   and dtGetIfConstant() only read shared data, so after dtCompile()
+   they may be called from several threads at once. */
+extern void dtCompile(void);
+
+/* Returns an opaque handle to the tree the calling thread's queries
+   use, or NULL if dtCompile() has not been called.  The decision tree
+   state is per-thread (see parse_thread.h), so a thread that wants to
+   query a tree another thread built passes this handle to
+   dtUseCompiled().  The handle is valid until the owning thread calls
+   dtAdd(), dtCompile(), or dtDeallocate(). */
+extern const void* dtGetCompiled(void);
+extern void dtUseCompiled(const void* compiled);
+
+/* If the immediate reward for [action,cur_state,s',o] is the same for
+   every s' and o, sets *valP to it and returns 1.  Otherwise returns 0.
+   Neither argument may be a wildcard. */
+extern int dtGetIfConstant(int action, int cur_state, double* valP);
+
 /* Cleans up all decision tree data structures on the heap. */
 extern void dtDeallocate(void);
 
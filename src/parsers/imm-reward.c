@@ -103,16 +103,16 @@ that was specified in the file.  */
    variable.  When we start to enter a line we will initial it and
    when we are finished we will convert it and store the sparse matrix
    into the node of the linked list.  */ 
-I_Matrix gCurIMatrix = NULL;
+PARSE_THREAD_LOCAL I_Matrix gCurIMatrix = NULL;
 
 /* We will have most of the information we need when we first start to
   parse the line, so we will create the node and put that information
   there.  After we have read all of the values, we will put it into
   the linked list.  */
-Imm_Reward_List gCurImmRewardNode = NULL;
+PARSE_THREAD_LOCAL Imm_Reward_List gCurImmRewardNode = NULL;
 
 /* This is the actual list of immediate reward lines */
-Imm_Reward_List gImmRewardList = NULL;
+PARSE_THREAD_LOCAL Imm_Reward_List gImmRewardList = NULL;
 
 /**********************************************************************/
 void destroyImmRewards() {
@@ -367,6 +367,54 @@ void doneImmReward() {
 
 }  /* doneImmReward */
 /**********************************************************************/
+void prepareImmRewards() {
+/*
+   Called once after parsing, before the rewards are queried.  Builds
+   the read-only structures that let getImmediateReward() be called
+   from several threads at once.
+*/
+#if USE_DECISION_TREE
+  dtCompile();
+#endif
+}  /* prepareImmRewards */
+/**********************************************************************/
+const void *shareImmRewards() {
+/*
+   Returns a handle that another thread can pass to useSharedImmRewards()
+   to query this thread's immediate rewards.  Call prepareImmRewards()
+   first.  The parser state is per-thread (see parse_thread.h), so
+   this is the only way for a helper thread to see the rewards.
+*/
+#if USE_DECISION_TREE
+  return dtGetCompiled();
+#else
+  return( gImmRewardList );
+#endif
+}  /* shareImmRewards */
+/**********************************************************************/
+void useSharedImmRewards( const void *shared ) {
+#if USE_DECISION_TREE
+  dtUseCompiled(shared);
+#else
+  gImmRewardList = (Imm_Reward_List) shared;
+#endif
+}  /* useSharedImmRewards */
+/**********************************************************************/
+int getImmediateRewardIfConstant( int action, int cur_state, 
+				  double *value ) {
+/*
+   Returns 1 and sets *value if the immediate reward for action and
+   cur_state is the same for every next state and observation, so that
+   the expected reward need not be summed over them.  Returns 0 if
+   that is not the case or cannot cheaply be determined.
+*/
+#if USE_DECISION_TREE
+  return dtGetIfConstant(action, cur_state, value);
+#else
+  return( 0 );
+#endif
+}  /* getImmediateRewardIfConstant */
+/**********************************************************************/
 double getImmediateReward( int action, int cur_state, int next_state,
 			   int obs ) {
 #if USE_DECISION_TREE
@@ -90,6 +90,11 @@ extern void newImmReward( int action, int cur_state, int next_state, int obs );
 extern void enterImmReward( int cur_state, int next_state, int obs, 
 			   double value );
 extern void doneImmReward();
+extern void prepareImmRewards();
+extern const void *shareImmRewards();
+extern void useSharedImmRewards( const void *shared );
+extern int getImmediateRewardIfConstant( int action, int cur_state,
+					double *value );
 extern double getImmediateReward( int action, int cur_state, int
 				 next_state, int obs );
 				 
@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <pthread.h>
 
 #include "mdp.h"
 #include "imm-reward.h"
@@ -38,23 +39,32 @@
 
 #define EPSILON  0.00001  /* tolerance for sum of probs == 1 */
 
+/* computeRewards() deals out action-state rows to threads in blocks of
+   this many rows */
+#define REWARD_ROW_BLOCK_SIZE                     64
+
 /* To indicate whether we are using an MDP or POMDP. 
    */
-Problem_Type gProblemType = UNKNOWN_problem_type;
+PARSE_THREAD_LOCAL Problem_Type gProblemType = UNKNOWN_problem_type;
 
 /* The discount factor to be used with the problem.  
    */
-double gDiscount = DEFAULT_DISCOUNT_FACTOR;
+PARSE_THREAD_LOCAL double gDiscount = DEFAULT_DISCOUNT_FACTOR;
 
 char *value_type_str[] = VALUE_TYPE_STRINGS;
 
-Value_Type gValueType = DEFAULT_VALUE_TYPE;
+PARSE_THREAD_LOCAL Value_Type gValueType = DEFAULT_VALUE_TYPE;
 
 /* These specify the size of the problem.  The first two are always required.
    */
-int gNumStates = 0;
-int gNumActions = 0;
-int gNumObservations = 0;   /* remains zero for MDPs */
+PARSE_THREAD_LOCAL int gNumStates = 0;
+PARSE_THREAD_LOCAL int gNumActions = 0;
+PARSE_THREAD_LOCAL int gNumObservations = 0;   /* remains zero for MDPs */
+
+/* The number of threads computeRewards() uses.  Set by the caller before
+   readMDP(); values less than 2 mean compute the rewards serially.
+   */
+PARSE_THREAD_LOCAL int gNumRewardThreads = 1;
 
 /*  We need two sets of variable for the probabilities and values.  The first
     is an intermediate representation which is filled in as the MDP file
@@ -67,19 +77,19 @@ int gNumObservations = 0;   /* remains zero for MDPs */
 
 /* Intermediate variables */
 
-I_Matrix *IP;  /* Transition Probabilities */
+PARSE_THREAD_LOCAL I_Matrix *IP;  /* Transition Probabilities */
 
-I_Matrix *IR;  /* Observation Probabilities (POMDP only) */
+PARSE_THREAD_LOCAL I_Matrix *IR;  /* Observation Probabilities (POMDP only) */
 
-I_Matrix IQ;  /* Immediate action-state pair values (both MDP and POMDP) */
+PARSE_THREAD_LOCAL I_Matrix IQ;  /* Immediate action-state pair values (both MDP and POMDP) */
 
 /* Sparse variables */
 
-Matrix *P;  /* Transition Probabilities */
+PARSE_THREAD_LOCAL Matrix *P;  /* Transition Probabilities */
 
-Matrix *R;  /* Observation Probabilities */
+PARSE_THREAD_LOCAL Matrix *R;  /* Observation Probabilities */
 
-Matrix Q;  /* Immediate values for state action pairs.  These are
+PARSE_THREAD_LOCAL Matrix Q;  /* Immediate values for state action pairs.  These are
 	    expectations computed from immediate values. */
 
 /* Normal variables */
@@ -88,8 +98,8 @@ Matrix Q;  /* Immediate values for state action pairs.  These are
    especially when doing simulation type experiments.  The belief
    state is for POMDPs and the initial state for an MDP */
 
-double *gInitialBelief; 
-int gInitialState = INVALID_STATE;
+PARSE_THREAD_LOCAL double *gInitialBelief; 
+PARSE_THREAD_LOCAL int gInitialState = INVALID_STATE;
 
 /***************************************************************************/
 double *newBeliefState(  ) {
@@ -313,51 +323,210 @@ void deallocateIntermediateMDP() {
 
 }  /* deallocateIntermediateMDP */
 /**********************************************************************/
-void computeRewards() {
-  int a, i, j, z, next_state, obs;
-  double sum, inner_sum;
-
-  /* Now do the expectation thing for action-state reward values */
+typedef struct {
+  int threadIndex;
+  int numThreads;
+  /* the calling thread's parse results, which worker threads can't
+     see through the (per-thread) globals */
+  Matrix *P;
+  Matrix *R;
+  int numStates;
+  int numActions;
+  Problem_Type problemType;
+  const void *immRewards;
+  double *obsRowSums;   /* POMDP only: sum over obs of R[a][s'][obs],
+			   indexed by a * gNumStates + s' */
+  double *rowRewards;   /* output: one entry per action-state row */
+  int numConstantRows;  /* output */
+} Reward_Task;
+
+static double computeExpectedReward( int a, int i, double *obsRowSums,
+				     int *isConstant ) {
+  int j, z, next_state, obs;
+  double sum, inner_sum, value;
+
+  sum = 0.0;
+
+  if( getImmediateRewardIfConstant( a, i, &value )) {
+    /* The reward does not depend on the next state or observation, so
+       the expectation is just the value times the total probability.
+       This skips the per-outcome reward lookups entirely. */
+    *isConstant = 1;
+    
+    for( j = P[a]->row_start[i]; 
+	j < P[a]->row_start[i] +  P[a]->row_length[i];
+	j++ ) {
+
+      if( gProblemType == POMDP_problem_type )
+	sum += P[a]->mat_val[j] 
+	  * obsRowSums[ a * gNumStates + P[a]->col[j] ];
+      else
+	sum += P[a]->mat_val[j];
+    }
 
-  for( a = 0; a < gNumActions; a++ )
-    for( i = 0; i < gNumStates; i++ ) {
+    return( value * sum );
+  }
 
-      sum = 0.0;
+  *isConstant = 0;
 
-      /* Note: 'j' is not a state. It is an index into an array */
-      for( j = P[a]->row_start[i]; 
-	  j < P[a]->row_start[i] +  P[a]->row_length[i];
-	  j++ ) {
+  /* Note: 'j' is not a state. It is an index into an array */
+  for( j = P[a]->row_start[i]; 
+      j < P[a]->row_start[i] +  P[a]->row_length[i];
+      j++ ) {
 
-	next_state = P[a]->col[j];
+    next_state = P[a]->col[j];
 
-	if( gProblemType == POMDP_problem_type ) {
+    if( gProblemType == POMDP_problem_type ) {
 
-	  inner_sum = 0.0;
+      inner_sum = 0.0;
 	    
-	  /* Note: 'z' is not a state. It is an index into an array */
-	  for( z = R[a]->row_start[next_state]; 
-	      z < (R[a]->row_start[next_state] +  R[a]->row_length[next_state]);
-	      z++ ) {
+      /* Note: 'z' is not a state. It is an index into an array */
+      for( z = R[a]->row_start[next_state]; 
+	  z < (R[a]->row_start[next_state] +  R[a]->row_length[next_state]);
+	  z++ ) {
 
-	    obs = R[a]->col[z];
+	obs = R[a]->col[z];
 
-	    inner_sum += R[a]->mat_val[z] 
-	      * getImmediateReward( a, i, next_state, obs );
-	  }  /* for z */
-	}  /* if POMDP */
+	inner_sum += R[a]->mat_val[z] 
+	  * getImmediateReward( a, i, next_state, obs );
+      }  /* for z */
+    }  /* if POMDP */
 
-	else /* it is an MDP */
-	  inner_sum = getImmediateReward( a, i, next_state, 0 );
+    else /* it is an MDP */
+      inner_sum = getImmediateReward( a, i, next_state, 0 );
 
-	sum += P[a]->mat_val[j] * inner_sum;
+    sum += P[a]->mat_val[j] * inner_sum;
 	
-      }  /* for j */
+  }  /* for j */
 
-      addEntryToIMatrix( IQ, a, i, sum );
+  return( sum );
+}  /* computeExpectedReward */
+/**********************************************************************/
+static void *computeRewardsWorker( void *arg ) {
+/*
+   Computes the rows in every numThreads'th block, starting with block
+   threadIndex.  Interleaving the blocks keeps the threads balanced
+   when some actions are much more expensive than others.
+*/
+  Reward_Task *task = (Reward_Task *) arg;
+  int numRows, blockStart, row, isConstant;
+
+  P = task->P;
+  R = task->R;
+  gNumStates = task->numStates;
+  gNumActions = task->numActions;
+  gProblemType = task->problemType;
+  useSharedImmRewards( task->immRewards );
+
+  numRows = gNumActions * gNumStates;
+
+  task->numConstantRows = 0;
+  for( blockStart = task->threadIndex * REWARD_ROW_BLOCK_SIZE;
+      blockStart < numRows;
+      blockStart += task->numThreads * REWARD_ROW_BLOCK_SIZE ) {
+
+    for( row = blockStart; 
+	row < blockStart + REWARD_ROW_BLOCK_SIZE && row < numRows;
+	row++ ) {
+
+      task->rowRewards[row] = 
+	computeExpectedReward( row / gNumStates, row % gNumStates,
+			       task->obsRowSums, &isConstant );
+      task->numConstantRows += isConstant;
+    }
+  }
+
+  return( NULL );
+}  /* computeRewardsWorker */
+/**********************************************************************/
+void computeRewards() {
+/*
+   Computes the expected immediate reward for each action-state pair.
+   The rows are independent, so they are split across gNumRewardThreads
+   threads; each thread writes only its own entries of rowRewards, and
+   the results are added to IQ afterward in row order, so the result
+   does not depend on the number of threads.
+*/
+  int a, i, j, t, numRows, numThreads, numConstantRows;
+  double *rowRewards, *obsRowSums = NULL;
+  Reward_Task *tasks;
+  pthread_t *threads;
+  int *threadStarted;
+
+  numRows = gNumActions * gNumStates;
+  rowRewards = (double *) malloc( numRows * sizeof( double ));
+
+  prepareImmRewards();
+
+  if( gProblemType == POMDP_problem_type ) {
+    obsRowSums = (double *) malloc( numRows * sizeof( double ));
+    for( a = 0; a < gNumActions; a++ )
+      for( i = 0; i < gNumStates; i++ ) {
+	obsRowSums[ a * gNumStates + i ] = 0.0;
+	for( j = R[a]->row_start[i]; 
+	    j < R[a]->row_start[i] +  R[a]->row_length[i];
+	    j++ )
+	  obsRowSums[ a * gNumStates + i ] += R[a]->mat_val[j];
+      }
+  }
+
+  numThreads = gNumRewardThreads;
+  if( numThreads > (numRows + REWARD_ROW_BLOCK_SIZE - 1) / REWARD_ROW_BLOCK_SIZE )
+    numThreads = (numRows + REWARD_ROW_BLOCK_SIZE - 1) / REWARD_ROW_BLOCK_SIZE;
+  if( numThreads < 1 )
+    numThreads = 1;
+
+  tasks = (Reward_Task *) malloc( numThreads * sizeof( *tasks ));
+  threads = (pthread_t *) malloc( numThreads * sizeof( *threads ));
+  threadStarted = (int *) malloc( numThreads * sizeof( int ));
+
+  for( t = 0; t < numThreads; t++ ) {
+    tasks[t].threadIndex = t;
+    tasks[t].numThreads = numThreads;
+    tasks[t].P = P;
+    tasks[t].R = R;
+    tasks[t].numStates = gNumStates;
+    tasks[t].numActions = gNumActions;
+    tasks[t].problemType = gProblemType;
+    tasks[t].immRewards = shareImmRewards();
+    tasks[t].obsRowSums = obsRowSums;
+    tasks[t].rowRewards = rowRewards;
+    tasks[t].numConstantRows = 0;
+  }
+
+  /* The calling thread takes task 0.  If a thread can't be started its
+     task is run here instead. */
+  for( t = 1; t < numThreads; t++ )
+    threadStarted[t] = (0 == pthread_create( &threads[t], NULL,
+					      computeRewardsWorker,
+					      &tasks[t] ));
+  computeRewardsWorker( &tasks[0] );
+  for( t = 1; t < numThreads; t++ ) {
+    if( threadStarted[t] )
+      pthread_join( threads[t], NULL );
+    else
+      computeRewardsWorker( &tasks[t] );
+  }
+
+  numConstantRows = 0;
+  for( t = 0; t < numThreads; t++ )
+    numConstantRows += tasks[t].numConstantRows;
+
+  for( a = 0; a < gNumActions; a++ )
+    for( i = 0; i < gNumStates; i++ )
+      addEntryToIMatrix( IQ, a, i, rowRewards[ a * gNumStates + i ] );
+
+  if (zmdpDebugLevelG >= 1) {
+    printf("  (%d threads; reward independent of outcome for %d of %d rows)\n",
+	   numThreads, numConstantRows, numRows);
+  }
+
+  free( threadStarted );
+  free( threads );
+  free( tasks );
+  free( obsRowSums );
+  free( rowRewards );
 
-    }  /* for i */
-  
 }  /* computeRewards */
 /************************************************************************/
 void convertMatrices() {
@@ -31,6 +31,7 @@
 #include <stdio.h>
 
 #include "sparse-matrix.h"
+#include "parse_thread.h"
 
 /* This parameter is declared in ZMDP src/common/zmdpConfig.h, but
    let's not include any ZMDP headers if we can help it.  I've added
@@ -62,31 +63,32 @@ typedef enum {REWARD_value_type, COST_value_type } Value_Type;
 
 /* Exported variables */
 extern char *value_type_str[];
-extern double gDiscount;
-extern Problem_Type gProblemType;
-extern Value_Type gValueType;
-extern int gNumStates;
-extern int gNumActions;
-extern int gNumObservations;
+extern PARSE_THREAD_LOCAL double gDiscount;
+extern PARSE_THREAD_LOCAL Problem_Type gProblemType;
+extern PARSE_THREAD_LOCAL Value_Type gValueType;
+extern PARSE_THREAD_LOCAL int gNumStates;
+extern PARSE_THREAD_LOCAL int gNumActions;
+extern PARSE_THREAD_LOCAL int gNumObservations;
+extern PARSE_THREAD_LOCAL int gNumRewardThreads;
 
 /* Intermediate variables */
 
-extern I_Matrix *IP;  /* Transition Probabilities */
-extern I_Matrix *IR;  /* Observation Probabilities */
-extern I_Matrix IQ;  /* Immediate values for MDP only */
+extern PARSE_THREAD_LOCAL I_Matrix *IP;  /* Transition Probabilities */
+extern PARSE_THREAD_LOCAL I_Matrix *IR;  /* Observation Probabilities */
+extern PARSE_THREAD_LOCAL I_Matrix IQ;  /* Immediate values for MDP only */
 
 /* Sparse variables */
 
-extern Matrix *P;  /* Transition Probabilities */
-extern Matrix *R;  /* Observation Probabilities */
-extern Matrix *QI;  /* The immediate values, for MDPs only */
-extern Matrix Q;  /* Immediate values for state action pairs.  These
+extern PARSE_THREAD_LOCAL Matrix *P;  /* Transition Probabilities */
+extern PARSE_THREAD_LOCAL Matrix *R;  /* Observation Probabilities */
+extern PARSE_THREAD_LOCAL Matrix *QI;  /* The immediate values, for MDPs only */
+extern PARSE_THREAD_LOCAL Matrix Q;  /* Immediate values for state action pairs.  These
 		     are expectations computed from immediate values:
 		     either the QI for MDPs or the special
 		     representation for the POMDPs */
 
-extern double *gInitialBelief;   /* For POMDPs */
-extern int gInitialState;        /* For MDPs   */
+extern PARSE_THREAD_LOCAL double *gInitialBelief;   /* For POMDPs */
+extern PARSE_THREAD_LOCAL int gInitialState;        /* For MDPs   */
 
 #ifdef __cplusplus
 extern "C" {
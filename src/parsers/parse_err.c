@@ -32,6 +32,7 @@ information generated by the scanner/parser.
 #include	<stdlib.h>
 #include        <string.h>
 #include	"parse_err.h"	/* constant and type defs. */
+#include	"parse_thread.h"
 
 /***********************  GLOBAL VARIABLES ***************************/
 /* GLOBAL Array of error messages */
@@ -68,7 +69,7 @@ static char *Err_Strings[NBR_ERRORS] = {
 	};
 
 /* pointer to the linked list of errors */
-Err_node	*Err_list;		/* GLOBAL error list */
+PARSE_THREAD_LOCAL Err_node	*Err_list;		/* GLOBAL error list */
 
 
 /**********************  ERR_initialize  ******************************/
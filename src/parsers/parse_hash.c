@@ -29,7 +29,7 @@
 #include "mdp.h"
 #include "parse_hash.h"
 
-Node *Hash_Table;
+PARSE_THREAD_LOCAL Node *Hash_Table;
 
 /**********************************************************************/
 void H_create() {
@@ -0,0 +1,49 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-24 17:52:09 $
+   
+ @file    parse_thread.h
+ @brief   Per-thread storage for the state of Cassandra's POMDP parser.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCparse_thread_h
+#define INCparse_thread_h
+
+/**********************************************************************
+   Tony Cassandra's parser keeps all of its state (the scanner's
+   position, the symbol table, the error list, the intermediate and
+   final model matrices, and the immediate reward decision tree) in
+   file-scope variables.  Each of them is declared PARSE_THREAD_LOCAL,
+   so every thread gets its own copy and several threads can each call
+   readMDP() at the same time without interfering.  The usual rule
+   still applies within a thread: read the results out of the globals
+   before parsing the next model.
+
+   A thread that needs to read another thread's parse results (for
+   instance a worker thread helping with computeRewards()) must be
+   handed the values explicitly.
+ **********************************************************************/
+
+#define PARSE_THREAD_LOCAL __thread
+
+#endif /* INCparse_thread_h */
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
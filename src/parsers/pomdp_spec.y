@@ -45,10 +45,9 @@ typedef enum { mc_none, mc_trans_single, mc_trans_row, mc_trans_all,
                mc_start_belief, mc_mdp_start, 
                mc_start_include, mc_start_exclude } Matrix_Context;
 
-extern int yylex();
 
 /* Forward declaration for action routines which appear at end of file */
-void yyerror(char *string);
+void yyerror(void *scanner, const char *string);
 void checkMatrix();
 void enterString( Constant_Block *block );
 void enterUniformMatrix( );
@@ -64,23 +63,23 @@ void verifyPreamble();
 void checkProbs();
 
 /*  Helps to give more meaningful error messages */
-long currentLineNumber = 1;
+PARSE_THREAD_LOCAL long currentLineNumber = 1;
 
 /* This sets the context needed when names are given the the states, 
    actions and/or observations */
-Mnemonic_Type curMnemonic = nt_unknown;
+PARSE_THREAD_LOCAL Mnemonic_Type curMnemonic = nt_unknown;
 
-Matrix_Context curMatrixContext = mc_none;
+PARSE_THREAD_LOCAL Matrix_Context curMatrixContext = mc_none;
 
 /* These variable are used to keep track what type of matrix is being entered and
    which element is currently being processed.  They are initialized by the
    setMatrixContext() routine and updated by the enterMatrix() routine. */
-int curRow;
-int curCol;
-int minA, maxA;
-int minI, maxI;
-int minJ, maxJ;
-int minObs, maxObs;
+PARSE_THREAD_LOCAL int curRow;
+PARSE_THREAD_LOCAL int curCol;
+PARSE_THREAD_LOCAL int minA, maxA;
+PARSE_THREAD_LOCAL int minI, maxI;
+PARSE_THREAD_LOCAL int minJ, maxJ;
+PARSE_THREAD_LOCAL int minObs, maxObs;
 
 /*  These variables will keep the intermediate representation for the
     matrices.  We cannot know how to set up the sparse matrices until
@@ -88,10 +87,9 @@ int minObs, maxObs;
     representation, which will will convert when it has all been read in.
     We allocate this memory once we know how big they must be and we
     will free all of this when we convert it to its final sparse format.
+    IP and IR are defined in mdp.c.
     */
-I_Matrix *IP;   /* For transition matrices. */
-I_Matrix *IR;   /* For observation matrices. */
-I_Matrix **IW;  /* For reward matrices */
+PARSE_THREAD_LOCAL I_Matrix **IW;  /* For reward matrices */
 
 /* These variables are used by the parser only, to keep some state
    information. 
@@ -101,21 +99,21 @@ I_Matrix **IW;  /* For reward matrices */
    defined then we will assume it is a regular MDP, and otherwise assume it 
    is a POMDP
    */
-int discountDefined = 0;
-int valuesDefined = 0;
-int statesDefined = 0;
-int actionsDefined = 0;
-int observationsDefined = 0;
+PARSE_THREAD_LOCAL int discountDefined = 0;
+PARSE_THREAD_LOCAL int valuesDefined = 0;
+PARSE_THREAD_LOCAL int statesDefined = 0;
+PARSE_THREAD_LOCAL int actionsDefined = 0;
+PARSE_THREAD_LOCAL int observationsDefined = 0;
 
 /* We only want to check when observation probs. are specified, but
    there was no observations in preamble. */
-int observationSpecDefined = 0;
+PARSE_THREAD_LOCAL int observationSpecDefined = 0;
 
 /* When we encounter a matrix with too many entries.  We would like
    to only generate one error message, instead of one for each entry.
    This variable is cleared at the start of reading  a matrix and
    set when there are too many entries. */
-int gTooManyEntries = 0;
+PARSE_THREAD_LOCAL int gTooManyEntries = 0;
 
 %}
 
@@ -134,6 +132,16 @@ int gTooManyEntries = 0;
   double f_num;
 }
 
+/* The parser and scanner are reentrant: their state lives in the
+   scanner object created by readMDPFile() rather than in globals. */
+%define api.pure
+%lex-param {void *scanner}
+%parse-param {void *scanner}
+
+%{
+extern int yylex( YYSTYPE *lvalp, void *scanner );
+%}
+
 %type <constBlk>     INTTOK FLOATTOK STRINGTOK 
 %type <i_num>        action state obs optional_sign
 %type <f_num>        number prob
@@ -760,10 +768,15 @@ optional_sign	: PLUSTOK
 
 #define EPSILON  0.00001  /* tolerance for sum of probs == 1 */
 
-Constant_Block *aConst;
+/* Reentrant scanner interface generated from pomdp_spec.l */
+extern int yylex_init( void **scanner );
+extern void yyset_in( FILE *in, void *scanner );
+extern int yylex_destroy( void *scanner );
+
+PARSE_THREAD_LOCAL Constant_Block *aConst;
 
 /******************************************************************************/
-void yyerror(char *string)
+void yyerror(void *scanner, const char *string)
 {
    ERR_enter("Parser<yyparse>", currentLineNumber, PARSE_ERR,"");
 }  /* yyerror */
@@ -1540,15 +1553,17 @@ void initParser() {
 /************************************************************************/
 int readMDPFile( FILE *file ) {
    int returnValue;
-   extern FILE *yyin;
+   void *scanner;
 
    initParser();
 
    ERR_initialize();
    H_create();
-   yyin = file;
+   yylex_init( &scanner );
+   yyset_in( file, scanner );
 
-   returnValue = yyparse();
+   returnValue = yyparse( scanner );
+   yylex_destroy( scanner );
    if (zmdpDebugLevelG >= 1) {
      printf("pomdp_spec: done parsing, beginning conversion to sparse-matrix\n");
    }
@@ -28,6 +28,7 @@
 void testOnce(void)
 {
   double result;
+  int isConstant;
 
   /* set up table */
   dtInit(5, 5, 5);
@@ -60,6 +61,26 @@ void testOnce(void)
   printf("expecting: result=%lf\n", 2.7);
   printf("got:       result=%lf\n", result);
 
+  /* the same queries against the compiled tree */
+  dtCompile();
+
+  result = dtGet(0, 1, 2, 3);
+  printf("expecting: result=%lf\n", 0.7);
+  printf("got:       result=%lf\n", result);
+
+  result = dtGet(3, 2, 0, 0);
+  printf("expecting: result=%lf\n", 2.7);
+  printf("got:       result=%lf\n", result);
+
+  /* rows whose reward does not depend on s' and o */
+  isConstant = dtGetIfConstant(3, 2, &result);
+  printf("expecting: isConstant=1 result=%lf\n", 2.7);
+  printf("got:       isConstant=%d result=%lf\n", isConstant, result);
+
+  isConstant = dtGetIfConstant(0, 1, &result);
+  printf("expecting: isConstant=0\n");
+  printf("got:       isConstant=%d\n", isConstant);
+
   /* clean up */
   dtDeallocate();
 }
@@ -130,7 +130,7 @@ void BlindLBInitializer::initBlind(double targetPrecision)
 
     do {
       // calculate nextAl
-      mult(nextAl, pomdp->T[a], al);
+      mult_transpose(nextAl, pomdp->Ttr[a], al);
       nextAl *= pomdp->discount;
       copy_from_column(tmp, pomdp->R, a);
       nextAl += tmp;
@@ -0,0 +1,369 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    GridUpperBound.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <iostream>
+#include <algorithm>
+
+#include "zmdpCommonDefs.h"
+#include "GridUpperBound.h"
+#include "SawtoothUpperBound.h"
+
+// fractional parts this close to 1 are treated as round-off error in a
+// grid point coordinate
+#define GRID_SNAP_EPS (1e-10)
+
+using namespace std;
+using namespace MatrixUtils;
+
+namespace zmdp {
+
+/**********************************************************************
+ * LOCAL HELPER FUNCTIONS
+ **********************************************************************/
+
+// the key of a vertex is the sum of a hash of each (index, count) pair
+// with a non-zero count, so it can be updated in constant time as the
+// walk moves mass between entries.  distinct vertices collide with
+// probability about 2^-64.
+static uint64_t getKeyTerm(int index, int count)
+{
+  if (0 == count) return 0;
+  uint64_t z = (((uint64_t) index) << 32) + ((uint64_t) count);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// orders fractional parts from largest to smallest.  ties go to the
+// lower index first, so that a stretch never gives up mass it has not
+// yet received from the stretch before it.
+static bool fracGreater(const std::pair<double,int>& a,
+			const std::pair<double,int>& b)
+{
+  if (a.first != b.first) return a.first > b.first;
+  return a.second < b.second;
+}
+
+/**********************************************************************
+ * GRID UPPER BOUND
+ **********************************************************************/
+
+GridUpperBound::GridUpperBound(const MDP* _pomdp,
+			       const ZMDPConfig* _config) :
+  pomdp((const Pomdp*) _pomdp),
+  config(_config),
+  core(NULL),
+  numVertexBackups(0)
+{
+  numStates = pomdp->getBeliefSize();
+  resolution = config->getInt("gridUpperBoundResolution");
+  if (resolution < 1) {
+    fprintf(stderr, "ERROR: gridUpperBoundResolution must be at least 1 (got %d)\n",
+	    resolution);
+    exit(EXIT_FAILURE);
+  }
+}
+
+void GridUpperBound::initialize(double targetPrecision)
+{
+  // the fast informed bound initializer fills in the corner points of
+  // a sawtooth bound, which serve as the initial vertex values
+  SawtoothUpperBound sawtooth(pomdp, config);
+  sawtooth.initialize(targetPrecision);
+  cornerPts = sawtooth.cornerPts;
+}
+
+// computes the simplex containing b using Lovejoy's method: in the
+// coordinates x_k = resolution * (sum of b entries from k onward), the
+// simplex is found by sorting the fractional parts of x.  entries
+// between two support indices of b share a coordinate, so each stretch
+// moves as a unit and only the support needs to be considered.
+void GridUpperBound::getSimplex(GridSimplex& g, const belief_vector& b) const
+{
+  int m = b.data.size();
+  assert(m >= 1);
+
+  double total = 0;
+  FOR (k, m) {
+    total += b.data[k].value;
+  }
+
+  std::vector<int> floorX(m+1);
+  std::vector< std::pair<double,int> > fracs;
+  floorX[m] = 0;
+  double suffix = 0;
+  for (int k=m-1; k >= 1; k--) {
+    suffix += b.data[k].value;
+    double x = resolution * suffix / total;
+    double v = floor(x);
+    double d = x - v;
+    if (d > 1 - GRID_SNAP_EPS) {
+      v += 1;
+      d = 0;
+    }
+    floorX[k] = (int) v;
+    if (d > 0) {
+      fracs.push_back(std::make_pair(d, k));
+    }
+  }
+  floorX[0] = resolution;
+
+  g.indices.resize(m);
+  g.baseCounts.resize(m);
+  FOR (k, m) {
+    g.indices[k] = b.data[k].index;
+    g.baseCounts[k] = floorX[k] - floorX[k+1];
+  }
+
+  std::sort(fracs.begin(), fracs.end(), fracGreater);
+  int n = fracs.size();
+  g.order.resize(n);
+  g.weights.resize(n+1);
+  double prev = 1.0;
+  FOR (j, n) {
+    g.order[j] = fracs[j].second;
+    g.weights[j] = prev - fracs[j].first;
+    prev = fracs[j].first;
+  }
+  g.weights[n] = prev;
+}
+
+void GridUpperBound::startVertex(GridVertexCursor& c, const GridSimplex& g) const
+{
+  c.counts = g.baseCounts;
+  c.key = 0;
+  c.cornerValue = 0;
+  FOR (k, c.counts.size()) {
+    c.key += getKeyTerm(g.indices[k], c.counts[k]);
+    c.cornerValue += c.counts[k] * cornerPts(g.indices[k]);
+  }
+  c.cornerValue /= resolution;
+}
+
+// moves the cursor from vertex j to vertex j+1
+void GridUpperBound::nextVertex(GridVertexCursor& c, const GridSimplex& g, int j) const
+{
+  int to = g.order[j];
+  int from = to - 1;
+  assert(c.counts[from] > 0);
+
+  c.key -= getKeyTerm(g.indices[from], c.counts[from]);
+  c.key -= getKeyTerm(g.indices[to], c.counts[to]);
+  c.counts[from]--;
+  c.counts[to]++;
+  c.key += getKeyTerm(g.indices[from], c.counts[from]);
+  c.key += getKeyTerm(g.indices[to], c.counts[to]);
+
+  c.cornerValue += (cornerPts(g.indices[to]) - cornerPts(g.indices[from])) / resolution;
+}
+
+double GridUpperBound::getVertexValue(const GridVertexCursor& c) const
+{
+  typeof(vertexValues.begin()) vi = vertexValues.find(c.key);
+  if (vi == vertexValues.end()) {
+    return c.cornerValue;
+  } else {
+    return vi->second;
+  }
+}
+
+void GridUpperBound::getVertexBelief(belief_vector& result, const GridVertexCursor& c,
+				     const GridSimplex& g) const
+{
+  result.resize(numStates);
+  FOR (k, c.counts.size()) {
+    if (c.counts[k] > 0) {
+      result.push_back(g.indices[k], ((double) c.counts[k]) / resolution);
+    }
+  }
+}
+
+double GridUpperBound::getValue(const belief_vector& b, const MDPNode* cn) const
+{
+  GridSimplex g;
+  GridVertexCursor c;
+  getSimplex(g, b);
+  startVertex(c, g);
+
+  double val = 0;
+  FOR (j, g.weights.size()) {
+    if (j > 0) nextVertex(c, g, j-1);
+    if (g.weights[j] > 0) {
+      val += g.weights[j] * getVertexValue(c);
+    }
+  }
+  return val;
+}
+
+void GridUpperBound::initNodeBound(MDPNode& cn)
+{
+  if (cn.isTerminal) {
+    cn.ubVal = 0;
+  } else {
+    cn.ubVal = getValue(cn.s, NULL);
+  }
+}
+
+// performs a Bellman backup at the vertex under the cursor, lowering its
+// stored value if the backup is tighter
+void GridUpperBound::backupVertex(const GridVertexCursor& c, const GridSimplex& g)
+{
+  belief_vector vb, nb;
+  obs_prob_vector opv;
+  getVertexBelief(vb, c, g);
+
+  double maxVal = -99e+20;
+  bool isTerminal = true;
+  FOR_CV (vb) {
+    if (!pomdp->isTerminalState[CV_INDEX(vb)]) {
+      isTerminal = false;
+      break;
+    }
+  }
+  if (isTerminal) {
+    maxVal = 0;
+  } else {
+    FOR (a, pomdp->getNumActions()) {
+      pomdp->getObsProbVector(opv, vb, a);
+      double val = 0;
+      FOR (o, opv.size()) {
+	if (opv(o) > OBS_IS_ZERO_EPS) {
+	  pomdp->getNextBelief(nb, vb, a, o);
+	  val += opv(o) * getValue(nb, NULL);
+	}
+      }
+      val = inner_prod_column(pomdp->R, a, vb) + pomdp->getDiscount() * val;
+      maxVal = std::max(maxVal, val);
+    }
+  }
+
+  if (maxVal < getVertexValue(c)) {
+    vertexValues[c.key] = maxVal;
+  }
+  numVertexBackups++;
+}
+
+// upper bound on long-term reward for taking action a
+double GridUpperBound::getNewUBValueQ(MDPNode& cn, int a)
+{
+  double val = 0;
+
+  MDPQEntry& Qa = cn.Q[a];
+  FOR (o, Qa.getNumOutcomes()) {
+    MDPEdge* e = Qa.outcomes[o];
+    if (NULL != e) {
+      val += e->obsProb * (getValue(e->nextState->s, NULL) + e->approximationError);
+    }
+  }
+  val = Qa.immediateReward + pomdp->getDiscount() * val;
+  Qa.ubVal = val;
+
+  return val;
+}
+
+struct GUNewValueData {
+  GridUpperBound* x;
+  MDPNode* cn;
+};
+
+// getNewUBValueQ() only reads the vertex values and writes the Q entry
+// for its own action, so different actions can safely run in parallel
+static void guNewValueTask(void* taskData, int a)
+{
+  GUNewValueData& d = *((GUNewValueData*) taskData);
+  d.x->getNewUBValueQ(*d.cn, a);
+}
+
+void GridUpperBound::update(MDPNode& cn, int* maxUBActionP)
+{
+  // back up the vertices of the simplex containing cn.s; this is where
+  // the grid is refined as the search visits new parts of the simplex
+  GridSimplex g;
+  GridVertexCursor c;
+  getSimplex(g, cn.s);
+  startVertex(c, g);
+  FOR (j, g.weights.size()) {
+    if (j > 0) nextVertex(c, g, j-1);
+    if (g.weights[j] > 0) {
+      backupVertex(c, g);
+    }
+  }
+
+  // then back up cn itself
+  double val, maxVal = -99e+20;
+  int maxUBAction = -1;
+  if (NULL != core->threadPool) {
+    GUNewValueData d;
+    d.x = this;
+    d.cn = &cn;
+    core->threadPool->run(pomdp->getNumActions(), &guNewValueTask, &d);
+  }
+  FOR (a, pomdp->getNumActions()) {
+    if (NULL != core->threadPool) {
+      val = cn.Q[a].ubVal;
+    } else {
+      val = getNewUBValueQ(cn, a);
+    }
+    if (val > maxVal) {
+      maxVal = val;
+      maxUBAction = a;
+    }
+  }
+  if (NULL != maxUBActionP) *maxUBActionP = maxUBAction;
+
+  // the interpolated value is also a valid bound, and after the vertex
+  // backups it may be the tighter of the two
+  cn.ubVal = std::min(maxVal, getValue(cn.s, NULL));
+}
+
+int GridUpperBound::getStorage(int whichMetric) const
+{
+  switch (whichMetric) {
+  case ZMDP_S_NUM_ELTS:
+  case ZMDP_S_NUM_ENTRIES:
+    // each stored vertex value and each corner point counts as 1
+    return vertexValues.size() + cornerPts.size();
+
+  default:
+    /* N/A */
+    return 0;
+  }
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
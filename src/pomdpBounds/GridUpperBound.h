@@ -0,0 +1,107 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    GridUpperBound.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+
+#ifndef INCGridUpperBound_h
+#define INCGridUpperBound_h
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "zmdpConfig.h"
+#include "zmdpCommonTypes.h"
+#include "MatrixUtils.h"
+#include "Pomdp.h"
+#include "IncrementalUpperBound.h"
+#include "BoundPairCore.h"
+
+namespace zmdp {
+
+// the simplex of the Freudenthal triangulation that contains a belief b.
+// the grid points are beliefs whose entries are multiples of
+// 1/resolution.  only the support of b matters: every vertex of the
+// simplex is supported on a subset of the support of b.
+struct GridSimplex {
+  // support indices of b
+  std::vector<int> indices;
+  // entries of the first vertex, in units of 1/resolution
+  std::vector<int> baseCounts;
+  // vertex j+1 is formed from vertex j by moving one unit of mass from
+  // entry order[j]-1 to entry order[j]
+  std::vector<int> order;
+  // interpolation weight of each vertex (one more entry than order)
+  std::vector<double> weights;
+};
+
+// a position while walking the vertices of a GridSimplex
+struct GridVertexCursor {
+  std::vector<int> counts;
+  uint64_t key;
+  double cornerValue;
+};
+
+// upper bound represented by values at the vertices of a fixed
+// resolution grid over the belief simplex, interpolated within each
+// simplex of the Freudenthal triangulation (Lovejoy 1991).  a query
+// costs O(k log k) in the number k of non-zero belief entries.  vertex
+// values are stored sparsely, keyed by a hash of the vertex; vertices
+// that have never been backed up take the value of the initial
+// upper bound plane, so storage grows only where the search goes.
+struct GridUpperBound : public IncrementalUpperBound {
+  const Pomdp* pomdp;
+  const ZMDPConfig* config;
+  BoundPairCore* core;
+  int numStates;
+  int resolution;
+  sla::dvector cornerPts;
+  EXT_NAMESPACE::hash_map<uint64_t, double> vertexValues;
+  int numVertexBackups;
+
+  GridUpperBound(const MDP* _pomdp,
+		 const ZMDPConfig* _config);
+
+  void initialize(double targetPrecision);
+  double getValue(const belief_vector& b, const MDPNode* cn) const;
+  void initNodeBound(MDPNode& cn);
+  void update(MDPNode& cn, int* maxUBActionP);
+  int getStorage(int whichMetric) const;
+
+  void getSimplex(GridSimplex& g, const belief_vector& b) const;
+  void startVertex(GridVertexCursor& c, const GridSimplex& g) const;
+  void nextVertex(GridVertexCursor& c, const GridSimplex& g, int j) const;
+  double getVertexValue(const GridVertexCursor& c) const;
+  void getVertexBelief(belief_vector& result, const GridVertexCursor& c,
+		       const GridSimplex& g) const;
+  void backupVertex(const GridVertexCursor& c, const GridSimplex& g);
+  double getNewUBValueQ(MDPNode& cn, int a);
+};
+
+}; // namespace zmdp
+
+#endif // INCGridUpperBound_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
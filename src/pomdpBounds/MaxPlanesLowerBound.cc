@@ -85,6 +85,38 @@ static bool dominates(const LBPlane* a, const LBPlane* b, bool useMaxPlanesMaski
   }
 }
 
+// with belief truncation or merging, a successor node's belief may omit
+// states that are actually reachable, and a masked plane chosen for it
+// may not define values for them.  sets result to the entries of plane that matter for
+// observation o after action a, with entries outside the plane's mask
+// filled in with pomdp->minBeliefValue, which keeps the backup a valid
+// lower bound.
+static void fillApproximatePlane(cvector& result, const LBPlane& plane,
+			       const Pomdp* pomdp, int a, int o)
+{
+  const cmatrix& Oa = pomdp->O[a];
+  typeof(plane.mask.data.begin()) mi = plane.mask.data.begin();
+  typeof(plane.mask.data.begin()) mend = plane.mask.data.end();
+  typeof(plane.alpha.data.begin()) ai = plane.alpha.data.begin();
+  typeof(plane.alpha.data.begin()) aend = plane.alpha.data.end();
+
+  result.resize(Oa.size1());
+  for (unsigned int j = Oa.col_starts[o]; j < Oa.col_starts[o+1]; j++) {
+    unsigned int sp = Oa.data[j].index;
+    while (mi != mend && mi->index < sp) mi++;
+    while (ai != aend && ai->index < sp) ai++;
+    double v;
+    if (mi != mend && mi->index == sp) {
+      v = (ai != aend && ai->index == sp) ? ai->value : 0.0;
+    } else {
+      v = pomdp->minBeliefValue;
+    }
+    if (0.0 != v) {
+      result.push_back(sp, v);
+    }
+  }
+}
+
 /**********************************************************************
  * LBPLANE
  **********************************************************************/
@@ -98,11 +130,37 @@ LBPlane::LBPlane(const alpha_vector& _alpha, int _action, const sla::mvector& _m
   mask(_mask)
 {}  
 
-void LBPlane::write(std::ostream& out, bool useMaxPlanesMasking) const
+void LBPlane::write(std::ostream& out, bool useMaxPlanesMasking,
+		    const std::vector<int>& originalToReduced) const
 {
   out << "    {" << endl;
   out << "      action => " << action << "," << endl;
 
+  if (!originalToReduced.empty()) {
+    // the model was reduced; write the entries in terms of the original
+    // states.  unreachable states are left out of the plane.
+    std::vector<int> origIndices;
+    FOR (s, originalToReduced.size()) {
+      int r = originalToReduced[s];
+      if (-1 != r && (!useMaxPlanesMasking || 0.0 != mask(r))) {
+	origIndices.push_back(s);
+      }
+    }
+    out << "      numEntries => " << origIndices.size() << "," << endl;
+    out << "      entries => [" << endl;
+    FOR (i, origIndices.size()) {
+      int s = origIndices[i];
+      out << "        " << s << ", " << alpha(originalToReduced[s]);
+      if (i+1 < origIndices.size()) {
+	out << ",";
+      }
+      out << endl;
+    }
+    out << "      ]" << endl;
+    out << "    }";
+    return;
+  }
+
   if (useMaxPlanesMasking) {
     out << "      numEntries => " << mask.filled() << "," << endl;
   } else {
@@ -191,7 +249,7 @@ void MaxPlanesLowerBound::getNewLBPlaneQ(LBPlane& result, MDPNode& cn, int a)
 {
   alpha_vector betaA(pomdp->getBeliefSize());
   const alpha_vector* betaAO;
-  alpha_vector tmp, tmp2, tmp3;
+  alpha_vector tmp, tmp2;
 
   set_to_zero(betaA);
   
@@ -202,8 +260,12 @@ void MaxPlanesLowerBound::getNewLBPlaneQ(LBPlane& result, MDPNode& cn, int a)
   FOR (o, Qa.getNumOutcomes()) {
     MDPEdge* e = Qa.outcomes[o];
     if (NULL != e) {
-      betaAO = &getPlaneForNode(*e->nextState).alpha;
-      if (useMaxPlanesMasking) {
+      const LBPlane& nextPlane = getPlaneForNode(*e->nextState);
+      betaAO = &nextPlane.alpha;
+      if (useMaxPlanesMasking && e->approximationError > 0) {
+	fillApproximatePlane(maskedBeta, nextPlane, pomdp, a, o);
+	betaAO = &maskedBeta;
+      } else if (useMaxPlanesMasking) {
 	// occasionally, even if the nextState belief is sparse, the
 	// corresponding betaAO is one of the dense alpha vectors produced
 	// by the initial blind-policy heuristic.  in that case, we can
@@ -227,8 +289,7 @@ void MaxPlanesLowerBound::getNewLBPlaneQ(LBPlane& result, MDPNode& cn, int a)
 
     emult_column( tmp, pomdp->O[a], o, *betaAO );
     if (useMaxPlanesMasking) {
-      mult( tmp3, pomdp->T[a], tmp );
-      mask_copy( tmp2, tmp3, cn.s );
+      mask_mult_transpose( tmp2, pomdp->Ttr[a], tmp, cn.s );
     } else {
       mult( tmp2, tmp, pomdp->Ttr[a] );
     }
@@ -250,10 +311,39 @@ void MaxPlanesLowerBound::getNewLBPlaneQ(LBPlane& result, MDPNode& cn, int a)
   if (useMaxPlanesMasking) {
     result.mask = cn.s;
   }
-  result.numBackupsAtCreation = core->numBackups;
+  // with BoundPairCore::sharedLock set, other threads may be counting
+  // skipped backups while this runs
+  result.numBackupsAtCreation = __atomic_load_n(&core->numBackups, __ATOMIC_RELAXED);
+}
+
+struct MPNewPlaneData {
+  MaxPlanesLowerBound* x;
+  MDPNode* cn;
+  std::vector<LBPlane> betas;
+};
+
+// getNewLBPlaneQ() only reads the plane set and the search graph, so
+// the backups for different actions can safely run in parallel
+static void mpNewPlaneTask(void* taskData, int a)
+{
+  MPNewPlaneData& d = *((MPNewPlaneData*) taskData);
+  d.x->getNewLBPlaneQ(d.betas[a], *d.cn, a);
 }
 
 void MaxPlanesLowerBound::getNewLBPlane(LBPlane& result, MDPNode& cn)
+{
+  std::vector<double> qLBVals;
+  getNewLBPlane(result, qLBVals, cn);
+  FOR (a, cn.getNumActions()) {
+    cn.Q[a].lbVal = qLBVals[a];
+  }
+}
+
+// same as getNewLBPlane(result, cn), but returns the Q values in qLBVals
+// rather than writing them to cn
+void MaxPlanesLowerBound::getNewLBPlane(LBPlane& result,
+					std::vector<double>& qLBVals,
+					MDPNode& cn)
 {
   timeval startTime;
   if (zmdpDebugLevelG >= 1) {
@@ -261,15 +351,37 @@ void MaxPlanesLowerBound::getNewLBPlane(LBPlane& result, MDPNode& cn)
   }
 
   double val, maxVal = -99e+20;
-  LBPlane betaA;
+  qLBVals.resize(cn.getNumActions());
+
+  if (NULL != core->threadPool) {
+    MPNewPlaneData d;
+    d.x = this;
+    d.cn = &cn;
+    d.betas.resize(cn.getNumActions());
+    core->threadPool->run(cn.getNumActions(), &mpNewPlaneTask, &d);
+
+    // merge in action order so the result matches the serial version
+    int maxAction = -1;
+    FOR (a, cn.getNumActions()) {
+      val = inner_prod(d.betas[a].alpha, cn.s);
+      qLBVals[a] = val;
+      if (val > maxVal) {
+	maxVal = val;
+	maxAction = a;
+      }
+    }
+    result = d.betas[maxAction];
+  } else {
+    LBPlane betaA;
  
-  FOR (a, cn.getNumActions()) {
-    getNewLBPlaneQ(betaA, cn, a);
-    val = inner_prod(betaA.alpha, cn.s);
-    cn.Q[a].lbVal = val;
-    if (val > maxVal) {
-      maxVal = val;
-      result = betaA;
+    FOR (a, cn.getNumActions()) {
+      getNewLBPlaneQ(betaA, cn, a);
+      val = inner_prod(betaA.alpha, cn.s);
+      qLBVals[a] = val;
+      if (val > maxVal) {
+	maxVal = val;
+	result = betaA;
+      }
     }
   }
   if (zmdpDebugLevelG >= 1) {
@@ -305,6 +417,38 @@ void MaxPlanesLowerBound::update(MDPNode& cn)
   maybePrune(core->numBackups);
 }
 
+struct MPBackup {
+  LBPlane* plane;
+  std::vector<double> qLBVals;
+};
+
+void* MaxPlanesLowerBound::getBackup(MDPNode& cn)
+{
+  MPBackup* backup = new MPBackup();
+  backup->plane = new LBPlane();
+  getNewLBPlane(*backup->plane, backup->qLBVals, cn);
+  return backup;
+}
+
+void MaxPlanesLowerBound::setBackup(MDPNode& cn, void* backupData)
+{
+  MPBackup* backup = (MPBackup*) backupData;
+  FOR (a, cn.getNumActions()) {
+    cn.Q[a].lbVal = backup->qLBVals[a];
+  }
+  // other backups may have been applied since the plane was computed;
+  // with useMaxPlanesCache, nodes only check planes created since their
+  // plane was last set, so the plane must count as new
+  LBPlane* newPlane = backup->plane;
+  newPlane->numBackupsAtCreation = core->numBackups;
+
+  setPlaneForNode(cn, newPlane);
+
+  addLBPlane(newPlane);
+  maybePrune(core->numBackups);
+  delete backup;
+}
+
 int MaxPlanesLowerBound::chooseAction(const state_vector& b)
 {
   return getBestLBPlaneConst(b).action; 
@@ -541,11 +685,32 @@ void MaxPlanesLowerBound::deleteAndForward(LBPlane* victim, LBPlane* dominator)
   delete victim;
 }
 
+// the snapshot copies the planes but not the bookkeeping used to update
+// them (back pointers, cache ages), so it can only be queried
+IncrementalLowerBound* MaxPlanesLowerBound::newSnapshot(void) const
+{
+  MaxPlanesLowerBound* result = new MaxPlanesLowerBound(pomdp, config);
+  result->useMaxPlanesCache = false;
+  FOR_EACH (planeP, planes) {
+    const LBPlane& p = **planeP;
+    LBPlane* copy = new LBPlane(p.alpha, p.action, p.mask);
+    copy->numBackupsAtCreation = p.numBackupsAtCreation;
+    result->addLBPlane(copy);
+  }
+  result->lastPruneNumPlanes = planes.size();
+  result->initialized = true;
+
+  return result;
+}
+
+// the policy is written to a temporary file that is renamed over
+// outFileName only when complete, so readers never see a partial policy
 void MaxPlanesLowerBound::writeToFile(const std::string& outFileName) const
 {
-  ofstream out(outFileName.c_str());
+  std::string tmpFileName = outFileName + ".tmp";
+  ofstream out(tmpFileName.c_str());
   if (!out) {
-    cerr << "ERROR: MaxPlanesLowerBound::writeToFile: couldn't open " << outFileName
+    cerr << "ERROR: MaxPlanesLowerBound::writeToFile: couldn't open " << tmpFileName
 	 << " for writing: " << strerror(errno) << endl;
     exit(EXIT_FAILURE);
   }
@@ -580,12 +745,12 @@ void MaxPlanesLowerBound::writeToFile(const std::string& outFileName) const
 
   PlaneSet::const_iterator pi = planes.begin();
   FOR (i, planes.size()-1) {
-    (*pi)->write(out, useMaxPlanesMasking);
+    (*pi)->write(out, useMaxPlanesMasking, pomdp->originalToReducedState);
     out << "," << endl;
     pi++;
   }
   if (planes.size() > 0) {
-    (*pi)->write(out, useMaxPlanesMasking);
+    (*pi)->write(out, useMaxPlanesMasking, pomdp->originalToReducedState);
   }
   out << endl;
 
@@ -593,6 +758,16 @@ void MaxPlanesLowerBound::writeToFile(const std::string& outFileName) const
   out << "}" << endl;
 
   out.close();
+  if (!out) {
+    cerr << "ERROR: MaxPlanesLowerBound::writeToFile: couldn't write " << tmpFileName
+	 << ": " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (0 != rename(tmpFileName.c_str(), outFileName.c_str())) {
+    cerr << "ERROR: MaxPlanesLowerBound::writeToFile: couldn't rename " << tmpFileName
+	 << " to " << outFileName << ": " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
 }
 
 void MaxPlanesLowerBound::readFromFile(const std::string& inFileName)
@@ -609,6 +784,11 @@ void MaxPlanesLowerBound::readFromFile(const std::string& inFileName)
   LBPlane plane;
   int entryIndex;
   double entryVal;
+  // if the model was reduced, entries are indexed by original state and
+  // are collected here, then translated to reduced states (see
+  // finishPlane())
+  const std::vector<int>& stateMap = pomdp->originalToReducedState;
+  std::map<int, double> reducedEntries;
   int parseState = 0;
   int lnum = 0;
   while (!inFile.eof()) {
@@ -660,13 +840,25 @@ void MaxPlanesLowerBound::readFromFile(const std::string& inFileName)
 	/* finding the 'action' keyword indicates we are at the start of
 	   another plane; finish up the plane we were working on and
 	   reparse the current line in parse state 1 */
-	mask_set_to_one(plane.mask, plane.alpha);
-	addLBPlane(new LBPlane(plane));
+	finishPlane(plane, reducedEntries);
 	parseState = 1;
 	goto parseLineAgain;
       } else if (2 == sscanf(s.c_str(), "%d, %lf", &entryIndex, &entryVal)) {
 	/* push another entry into the plane */
-	plane.alpha.push_back(entryIndex, entryVal);
+	if (stateMap.empty()) {
+	  plane.alpha.push_back(entryIndex, entryVal);
+	} else {
+	  if (entryIndex < 0 || entryIndex >= (int) stateMap.size()) {
+	    fprintf(stderr, "ERROR: %s: line %d: state index %d out of range\n",
+		    inFileName.c_str(), lnum, entryIndex);
+	    exit(EXIT_FAILURE);
+	  }
+	  if (-1 != stateMap[entryIndex]) {
+	    // merged states have the same value, so it doesn't matter
+	    // which one is kept
+	    reducedEntries[stateMap[entryIndex]] = entryVal;
+	  }
+	}
       } else {
 	printf("s=[%s]\n", s.c_str());
 	fprintf(stderr, "ERROR: %s: line %d: expected entry '<int>, <double>'\n",
@@ -681,8 +873,7 @@ void MaxPlanesLowerBound::readFromFile(const std::string& inFileName)
   
   /* reached EOF, finish up the last plane */
   if (2 == parseState) {
-    mask_set_to_one(plane.mask, plane.alpha);
-    addLBPlane(new LBPlane(plane));
+    finishPlane(plane, reducedEntries);
   }
 
   inFile.close();
@@ -694,6 +885,22 @@ void MaxPlanesLowerBound::readFromFile(const std::string& inFileName)
   initialized = true;
 }
 
+// adds a plane read by readFromFile() to the bound.  if the model was
+// reduced, the plane's entries have been collected in reducedEntries
+// rather than in plane.alpha.
+void MaxPlanesLowerBound::finishPlane(LBPlane& plane,
+				      std::map<int, double>& reducedEntries)
+{
+  if (pomdp->getIsReduced()) {
+    FOR_EACH (ei, reducedEntries) {
+      plane.alpha.push_back(ei->first, ei->second);
+    }
+    reducedEntries.clear();
+  }
+  mask_set_to_one(plane.mask, plane.alpha);
+  addLBPlane(new LBPlane(plane));
+}
+
 void MaxPlanesLowerBound::readFromCassandraAlphaFile(const std::string& inFileName)
 {
   ifstream inFile(inFileName.c_str());
@@ -710,13 +917,30 @@ void MaxPlanesLowerBound::readFromCassandraAlphaFile(const std::string& inFileNa
   mask_set_all(plane.mask, pomdp->numStates);
   plane.numBackupsAtCreation = -1;
 
+  // the file contains a value for each state of the original model;
+  // if the model was reduced, keep one value per reduced state
+  const std::vector<int>& stateMap = pomdp->originalToReducedState;
+  int numFileStates = pomdp->getIsReduced() ? ((int) stateMap.size()) : pomdp->numStates;
+  dvector reducedVals;
+
   while (!inFile.eof()) {
     inFile >> plane.action;
     plane.alpha.clear();
     plane.alpha.resize(pomdp->numStates);
-    for (int i=0; i < pomdp->numStates; i++) {
-      inFile >> val;
-      plane.alpha.push_back(i, val);
+    if (pomdp->getIsReduced()) {
+      reducedVals.resize(pomdp->numStates);
+      for (int i=0; i < numFileStates; i++) {
+	inFile >> val;
+	if (-1 != stateMap[i]) {
+	  reducedVals(stateMap[i]) = val;
+	}
+      }
+      copy(plane.alpha, reducedVals);
+    } else {
+      for (int i=0; i < numFileStates; i++) {
+	inFile >> val;
+	plane.alpha.push_back(i, val);
+      }
     }
     addLBPlane(new LBPlane(plane));
   }
@@ -34,6 +34,7 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <map>
 
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTypes.h"
@@ -58,7 +59,10 @@ struct LBPlane {
 
   LBPlane(void);
   LBPlane(const alpha_vector& _alpha, int _action, const sla::mvector& _mask);
-  void write(std::ostream& out, bool useMaxPlanesMasking) const;
+  // if originalToReduced is non-empty, the plane is written in terms of
+  // the states of the original (unreduced) model
+  void write(std::ostream& out, bool useMaxPlanesMasking,
+	     const std::vector<int>& originalToReduced) const;
 };
 
 typedef std::list< LBPlane* > PlaneSet;
@@ -85,10 +89,14 @@ struct MaxPlanesLowerBound : public IncrementalLowerBound {
   double getValue(const belief_vector& b, const MDPNode* cn) const;
   void initNodeBound(MDPNode& cn);
   void update(MDPNode& cn);
+  void* getBackup(MDPNode& cn);
+  void setBackup(MDPNode& cn, void* backupData);
   int chooseAction(const state_vector& b);
 
   void getNewLBPlaneQ(LBPlane& result, MDPNode& cn, int a);
   void getNewLBPlane(LBPlane& result, MDPNode& cn);
+  void getNewLBPlane(LBPlane& result, std::vector<double>& qLBVals,
+		     MDPNode& cn);
   void updateLowerBound(MDPNode& cn);
   void setPlaneForNode(MDPNode& cn, LBPlane* newPlane);
   const LBPlane& getPlaneForNode(MDPNode& cn);
@@ -102,7 +110,9 @@ struct MaxPlanesLowerBound : public IncrementalLowerBound {
   void maybePrune(int numBackups);
   void deleteAndForward(LBPlane* victim, LBPlane* dominator);
 
+  IncrementalLowerBound* newSnapshot(void) const;
   void writeToFile(const std::string& outFileName) const;
+  void finishPlane(LBPlane& plane, std::map<int, double>& reducedEntries);
   void readFromFile(const std::string& inFileName);
   void readFromCassandraAlphaFile(const std::string& inFileName);
   int getStorage(int whichMetric) const;
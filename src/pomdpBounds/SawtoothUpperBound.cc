@@ -28,9 +28,13 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 
 #include <iostream>
+#include <fstream>
 #include <list>
+#include <map>
 
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTime.h"
@@ -47,6 +51,31 @@ using namespace MatrixUtils;
 
 namespace zmdp {
 
+/**********************************************************************
+ * LOCAL HELPER FUNCTIONS
+ **********************************************************************/
+
+static std::string stripWhiteSpace(const std::string& s)
+{
+  string::size_type p1, p2;
+  p1 = s.find_first_not_of(" \t");
+  if (string::npos == p1) {
+    return s;
+  } else {
+    p2 = s.find_last_not_of(" \t")+1;
+    return s.substr(p1, p2-p1);
+  }
+}
+
+static bool startsWith(const std::string& s, const char* prefix)
+{
+  return 0 == s.compare(0, strlen(prefix), prefix);
+}
+
+/**********************************************************************
+ * SAWTOOTH UPPER BOUND
+ **********************************************************************/
+
 SawtoothUpperBound::SawtoothUpperBound(const MDP* _pomdp,
 				       const ZMDPConfig* _config) :
   pomdp((const Pomdp*) _pomdp),
@@ -91,6 +120,48 @@ void SawtoothUpperBound::update(MDPNode& cn, int* maxUBActionP)
   setUBForNode(cn, newUBVal, true);
 }
 
+struct SUBackup {
+  dvector qUBVals;
+  std::vector<bool> updatedAction;
+};
+
+void* SawtoothUpperBound::getBackup(MDPNode& cn)
+{
+  SUBackup* backup = new SUBackup();
+  int numActions = pomdp->getNumActions();
+  backup->qUBVals.resize(numActions);
+  if (BP_QVAL_UNDEFINED == cn.Q[0].ubVal) {
+    backup->updatedAction.resize(numActions);
+    FOR (a, numActions) {
+      backup->qUBVals(a) = getQUBValue(cn, a);
+      backup->updatedAction[a] = true;
+    }
+  } else {
+    FOR (a, numActions) {
+      backup->qUBVals(a) = cn.Q[a].ubVal;
+    }
+    updateCachedQValues(backup->qUBVals, backup->updatedAction, cn);
+  }
+  return backup;
+}
+
+void SawtoothUpperBound::setBackup(MDPNode& cn, void* backupData,
+				   int* maxUBActionP)
+{
+  SUBackup* backup = (SUBackup*) backupData;
+  FOR (a, pomdp->getNumActions()) {
+    if (backup->updatedAction[a]) {
+      cn.Q[a].ubVal = backup->qUBVals(a);
+    }
+  }
+  // the Q values that were not recomputed may have been changed by
+  // other backups since getBackup(), so take the best action from cn
+  int maxUBAction = BoundPairCore::getMaxUBAction(cn);
+  if (NULL != maxUBActionP) *maxUBActionP = maxUBAction;
+  setUBForNode(cn, cn.Q[maxUBAction].ubVal, true);
+  delete backup;
+}
+
 // returns the upper bound that the (belief,value) pair c induces on b.
 double SawtoothUpperBound::getBVValue(const belief_vector& b,
 				      const BVPair* cPair,
@@ -132,7 +203,7 @@ double SawtoothUpperBound::getBVValue(const belief_vector& b,
       return 99e+20;
     }
     
-    minRatio = std::min(minRatio, bi->value / ci->value);
+    minRatio = std::min(minRatio, ((double) bi->value) / ci->value);
   }
  breakCiLoop:
   if (bdone) {
@@ -339,23 +410,44 @@ void SawtoothUpperBound::printToStream(ostream& out) const
 }
 
 // upper bound on long-term reward for taking action a
-double SawtoothUpperBound::getNewUBValueQ(MDPNode& cn, int a)
+// returns the backed-up upper bound for action a without modifying cn
+double SawtoothUpperBound::getQUBValue(const MDPNode& cn, int a) const
 {
   double val = 0;
 
-  MDPQEntry& Qa = cn.Q[a];
+  const MDPQEntry& Qa = cn.Q[a];
   FOR (o, Qa.getNumOutcomes()) {
-    MDPEdge* e = Qa.outcomes[o];
+    const MDPEdge* e = Qa.outcomes[o];
     if (NULL != e) {
-      val += e->obsProb * getValue(e->nextState->s, NULL);
+      val += e->obsProb * (getValue(e->nextState->s, NULL) + e->approximationError);
     }
   }
   val = Qa.immediateReward + pomdp->getDiscount() * val;
-  Qa.ubVal = val;
 
   return val;
 }
 
+double SawtoothUpperBound::getNewUBValueQ(MDPNode& cn, int a)
+{
+  double val = getQUBValue(cn, a);
+  cn.Q[a].ubVal = val;
+
+  return val;
+}
+
+struct SUNewValueData {
+  SawtoothUpperBound* x;
+  MDPNode* cn;
+};
+
+// getNewUBValueQ() only reads the point set and writes the Q entry for
+// its own action, so different actions can safely run in parallel
+static void suNewValueTask(void* taskData, int a)
+{
+  SUNewValueData& d = *((SUNewValueData*) taskData);
+  d.x->getNewUBValueQ(*d.cn, a);
+}
+
 double SawtoothUpperBound::getNewUBValueSimple(MDPNode& cn, int* maxUBActionP)
 {
   timeval startTime;
@@ -365,8 +457,18 @@ double SawtoothUpperBound::getNewUBValueSimple(MDPNode& cn, int* maxUBActionP)
 
   double val, maxVal = -99e+20;
   int maxUBAction = -1;
+  if (NULL != core->threadPool) {
+    SUNewValueData d;
+    d.x = this;
+    d.cn = &cn;
+    core->threadPool->run(pomdp->getNumActions(), &suNewValueTask, &d);
+  }
   FOR (a, pomdp->getNumActions()) {
-    val = getNewUBValueQ(cn,a);
+    if (NULL != core->threadPool) {
+      val = cn.Q[a].ubVal;
+    } else {
+      val = getNewUBValueQ(cn,a);
+    }
     if (val > maxVal) {
       maxVal = val;
       maxUBAction = a;
@@ -397,8 +499,37 @@ double SawtoothUpperBound::getNewUBValueUseCache(MDPNode& cn, int* maxUBActionP)
     cachedUpperBound(a) = cn.Q[a].ubVal;
   }
 
+  std::vector<bool> updatedAction;
+  int maxUBAction = updateCachedQValues(cachedUpperBound, updatedAction, cn);
+  FOR (a, pomdp->getNumActions()) {
+    if (updatedAction[a]) {
+      cn.Q[a].ubVal = cachedUpperBound(a);
+    }
+  }
+
+  double maxVal = cachedUpperBound(maxUBAction);
+  
+  if (NULL != maxUBActionP) *maxUBActionP = maxUBAction;
+
+  if (zmdpDebugLevelG >= 1) {
+    cout << "** newUpperBound: elapsed time = "
+	 << timevalToSeconds(getTime() - startTime)
+	 << endl;
+  }
+
+  return maxVal;
+}
+
+// given the cached Q values of cn in cachedUpperBound, recomputes them
+// in order of decreasing cached value until the best action is one that
+// has been recomputed.  updatedAction is set for the recomputed actions.
+// returns the best action.  does not modify cn.
+int SawtoothUpperBound::updateCachedQValues(dvector& cachedUpperBound,
+					    std::vector<bool>& updatedAction,
+					    const MDPNode& cn) const
+{
   // remember which Q functions we have updated on this call
-  std::vector<bool> updatedAction(pomdp->getNumActions());
+  updatedAction.resize(pomdp->getNumActions());
   FOR (a, pomdp->getNumActions()) {
     updatedAction[a] = false;
   }
@@ -407,7 +538,7 @@ double SawtoothUpperBound::getNewUBValueUseCache(MDPNode& cn, int* maxUBActionP)
   int maxUBAction = argmax_elt(cachedUpperBound);
   while (1) {
     // do the backup for the best Q
-    val = getNewUBValueQ(cn,maxUBAction);
+    val = getQUBValue(cn,maxUBAction);
     cachedUpperBound(maxUBAction) = val;
     updatedAction[maxUBAction] = true;
       
@@ -419,17 +550,7 @@ double SawtoothUpperBound::getNewUBValueUseCache(MDPNode& cn, int* maxUBActionP)
     if (updatedAction[maxUBAction]) break;
   }
 
-  double maxVal = cachedUpperBound(maxUBAction);
-  
-  if (NULL != maxUBActionP) *maxUBActionP = maxUBAction;
-
-  if (zmdpDebugLevelG >= 1) {
-    cout << "** newUpperBound: elapsed time = "
-	 << timevalToSeconds(getTime() - startTime)
-	 << endl;
-  }
-
-  return maxVal;
+  return maxUBAction;
 }
 
 double SawtoothUpperBound::getNewUBValue(MDPNode& cn, int* maxUBActionP)
@@ -480,6 +601,251 @@ int SawtoothUpperBound::getStorage(int whichMetric) const
   }
 }
 
+// as with MaxPlanesLowerBound::writeToFile(), the bound is written to a
+// temporary file that is renamed over outFileName only when complete
+void SawtoothUpperBound::writeToFile(const std::string& outFileName) const
+{
+  std::string tmpFileName = outFileName + ".tmp";
+  ofstream out(tmpFileName.c_str());
+  if (!out) {
+    cerr << "ERROR: SawtoothUpperBound::writeToFile: couldn't open " << tmpFileName
+	 << " for writing: " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  // values are read back as an upper bound, so don't round them
+  out.precision(17);
+
+  // if the model was reduced, each reduced state is written as the first
+  // original state that maps to it
+  const std::vector<int>& stateMap = pomdp->originalToReducedState;
+  std::vector<int> reducedToOriginal;
+  if (!stateMap.empty()) {
+    reducedToOriginal.resize(numStates, -1);
+    FOR (s, stateMap.size()) {
+      int r = stateMap[s];
+      if (-1 != r && -1 == reducedToOriginal[r]) {
+	reducedToOriginal[r] = s;
+      }
+    }
+  }
+
+  out <<
+"# This file is a POMDP upper bound in the sawtooth representation: a\n"
+"# value for each corner of the belief simplex (each state), plus a set\n"
+"# of (belief, value) points.  The bound at a belief b is the minimum,\n"
+"# over the points (c, v), of the value of the linear interpolation of\n"
+"# the corner values at b, corrected downward in proportion to how far v\n"
+"# lies below the interpolation at c.  Corner values are indexed by\n"
+"# state, and point beliefs are sparse lists of (state, probability)\n"
+"# entries.\n"
+"\n"
+    ;
+  out << "{" << endl;
+  out << "  boundType => \"SawtoothUpperBound\"," << endl;
+
+  std::vector<int> cornerStates;
+  if (stateMap.empty()) {
+    FOR (s, numStates) cornerStates.push_back(s);
+  } else {
+    FOR (s, stateMap.size()) {
+      if (-1 != stateMap[s]) cornerStates.push_back(s);
+    }
+  }
+  out << "  numCornerPoints => " << cornerStates.size() << "," << endl;
+  out << "  cornerPoints => [" << endl;
+  FOR (i, cornerStates.size()) {
+    int s = cornerStates[i];
+    int r = stateMap.empty() ? s : stateMap[s];
+    out << "    " << s << ", " << cornerPts(r);
+    if (i+1 < cornerStates.size()) {
+      out << ",";
+    }
+    out << endl;
+  }
+  out << "  ]," << endl;
+
+  out << "  numPoints => " << pts.size() << "," << endl;
+  out << "  points => [" << endl;
+  int ptIndex = 0;
+  FOR_EACH (ptP, pts) {
+    const BVPair& pt = **ptP;
+    out << "    {" << endl;
+    out << "      value => " << pt.v << "," << endl;
+    out << "      numEntries => " << pt.b.filled() << "," << endl;
+    out << "      entries => [" << endl;
+    FOR (j, pt.b.filled()) {
+      int r = pt.b.data[j].index;
+      out << "        " << (stateMap.empty() ? r : reducedToOriginal[r])
+	  << ", " << pt.b.data[j].value;
+      if (j+1 < pt.b.filled()) {
+	out << ",";
+      }
+      out << endl;
+    }
+    out << "      ]" << endl;
+    out << "    }";
+    if (++ptIndex < (int) pts.size()) {
+      out << ",";
+    }
+    out << endl;
+  }
+  out << "  ]" << endl;
+  out << "}" << endl;
+
+  out.close();
+  if (!out) {
+    cerr << "ERROR: SawtoothUpperBound::writeToFile: couldn't write " << tmpFileName
+	 << ": " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (0 != rename(tmpFileName.c_str(), outFileName.c_str())) {
+    cerr << "ERROR: SawtoothUpperBound::writeToFile: couldn't rename " << tmpFileName
+	 << " to " << outFileName << ": " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+void SawtoothUpperBound::readFromFile(const std::string& inFileName)
+{
+  ifstream inFile(inFileName.c_str());
+  if (!inFile) {
+    cerr << "ERROR: couldn't open " << inFileName << " for reading: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  FOR_EACH (entryP, pts) {
+    delete *entryP;
+  }
+  pts.clear();
+  FOR_EACH (bvlP, supportList) {
+    bvlP->clear();
+  }
+  cornerPts.resize(numStates);
+  set_to_zero(cornerPts);
+
+  // entries are indexed by original state.  if the model was reduced,
+  // probabilities of merged states are added together, and unreachable
+  // states are dropped.
+  const std::vector<int>& stateMap = pomdp->originalToReducedState;
+  int numFileStates = stateMap.empty() ? numStates : ((int) stateMap.size());
+  std::map<int, double> entries;
+  double value = 0;
+
+  char buf[1024];
+  std::string s;
+  int entryIndex;
+  double entryVal;
+  // 0: expect boundType, 1: corner points, 2: points
+  int parseState = 0;
+  bool inPoint = false;
+  int lnum = 0;
+  while (!inFile.eof()) {
+    inFile.getline(buf, sizeof(buf));
+    lnum++;
+
+    // strip whitespace, ignore empty lines and comments
+    s = stripWhiteSpace(buf);
+    if (0 == s.size()) continue;
+    if ('#' == s[0]) continue;
+
+    // ignore these types of lines because they contain redundant information
+    if (s == "{") continue;
+    if (s == "}" or s == "},") continue;
+    if (s == "[") continue;
+    if (s == "]" or s == "],") continue;
+    if (startsWith(s, "numCornerPoints")) continue;
+    if (startsWith(s, "numPoints")) continue;
+    if (startsWith(s, "numEntries")) continue;
+    if (startsWith(s, "entries")) continue;
+
+    if (0 == parseState) {
+      if (startsWith(s, "boundType")
+	  && string::npos != s.find("SawtoothUpperBound")) {
+	parseState = 1;
+	continue;
+      } else {
+	fprintf(stderr, "ERROR: %s: line %d: expected 'boundType => \"SawtoothUpperBound\"'\n",
+		inFileName.c_str(), lnum);
+	exit(EXIT_FAILURE);
+      }
+    }
+    if (startsWith(s, "cornerPoints")) {
+      parseState = 1;
+      continue;
+    }
+    if (startsWith(s, "points")) {
+      parseState = 2;
+      continue;
+    }
+    if (2 == parseState && 1 == sscanf(s.c_str(), "value => %lf", &entryVal)) {
+      // start of a new point; finish the last one
+      if (inPoint) {
+	addFilePoint(entries, value);
+      }
+      value = entryVal;
+      inPoint = true;
+      continue;
+    }
+    if (2 != sscanf(s.c_str(), "%d, %lf", &entryIndex, &entryVal)) {
+      fprintf(stderr, "ERROR: %s: line %d: expected entry '<int>, <double>'\n",
+	      inFileName.c_str(), lnum);
+      exit(EXIT_FAILURE);
+    }
+    if (entryIndex < 0 || entryIndex >= numFileStates) {
+      fprintf(stderr, "ERROR: %s: line %d: state index %d out of range (model has %d states)\n",
+	      inFileName.c_str(), lnum, entryIndex, numFileStates);
+      exit(EXIT_FAILURE);
+    }
+    int r = stateMap.empty() ? entryIndex : stateMap[entryIndex];
+    if (-1 == r) continue;
+    if (1 == parseState) {
+      // merged states have the same value, so it doesn't matter which
+      // one is kept
+      cornerPts(r) = entryVal;
+    } else if (inPoint) {
+      entries[r] += entryVal;
+    } else {
+      fprintf(stderr, "ERROR: %s: line %d: expected 'value => <double>'\n",
+	      inFileName.c_str(), lnum);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (inPoint) {
+    addFilePoint(entries, value);
+  }
+
+  inFile.close();
+
+  // the point set should have been pruned before it was written out
+  lastPruneNumPts = pts.size();
+  lastPruneNumBackups = -1;
+}
+
+// adds a point read by readFromFile().  entries is cleared.
+void SawtoothUpperBound::addFilePoint(std::map<int, double>& entries, double value)
+{
+  // renormalize in case some of the point's states were dropped
+  double sum = 0;
+  FOR_EACH (ei, entries) {
+    sum += ei->second;
+  }
+  BVPair* bv = new BVPair();
+  bv->b.resize(numStates);
+  FOR_EACH (ei, entries) {
+    bv->b.push_back(ei->first, ei->second / sum);
+  }
+  entries.clear();
+  bv->v = value;
+  bv->numBackupsAtCreation = -1;
+  if (0 == bv->b.filled()) {
+    // all of the point's states are unreachable in this model
+    delete bv;
+  } else {
+    addPoint(bv);
+  }
+}
+
 }; // namespace zmdp
 
 /***************************************************************************
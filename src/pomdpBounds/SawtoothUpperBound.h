@@ -24,6 +24,8 @@
 #define INCSawtoothUpperBound_h
 
 #include <list>
+#include <map>
+#include <string>
 
 #include "zmdpConfig.h"
 #include "MatrixUtils.h"
@@ -67,6 +69,8 @@ struct SawtoothUpperBound : public IncrementalUpperBound {
   double getValue(const belief_vector& b, const MDPNode* cn) const;
   void initNodeBound(MDPNode& cn);
   void update(MDPNode& cn, int* maxUBActionP);
+  void* getBackup(MDPNode& cn);
+  void setBackup(MDPNode& cn, void* backupData, int* maxUBActionP);
 
   static double getBVValue(const belief_vector& b,
 			   const BVPair* cPair,
@@ -85,13 +89,25 @@ struct SawtoothUpperBound : public IncrementalUpperBound {
   void addPoint(BVPair* bv);
   void printToStream(std::ostream& out) const;
 
+  double getQUBValue(const MDPNode& cn, int a) const;
   double getNewUBValueQ(MDPNode& cn, int a);
   double getNewUBValueSimple(MDPNode& cn, int* maxUBActionP);
   double getNewUBValueUseCache(MDPNode& cn, int* maxUBActionP);
+  int updateCachedQValues(sla::dvector& cachedUpperBound,
+			  std::vector<bool>& updatedAction,
+			  const MDPNode& cn) const;
   double getNewUBValue(MDPNode& cn, int* maxUBActionP);
   void setUBForNode(MDPNode& cn, double newUB, bool addBV);
   double getUBForNode(MDPNode& cn);
   int getStorage(int whichMetric) const;
+
+  // the point set is written in terms of the states of the original
+  // (unreduced) model, like the MaxPlanesLowerBound policy file.
+  // readFromFile() replaces the current bound, so it only gives a valid
+  // bound for the model the file was written from.
+  void writeToFile(const std::string& outFileName) const;
+  void readFromFile(const std::string& inFileName);
+  void addFilePoint(std::map<int, double>& entries, double value);
 };
 
 }; // namespace zmdp
@@ -0,0 +1,482 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    WarmStartInitializer.cc
+ @brief   Reuses the bounds written by an earlier run on a slightly
+          different model to initialize the bounds for a new run.
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+
+#include <iostream>
+#include <map>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTime.h"
+#include "MatrixUtils.h"
+#include "WarmStartInitializer.h"
+
+// observations less likely than this at a witness belief don't affect
+// the choice of the next plane
+#define WS_MIN_OBS_PROB (1e-10)
+
+// planes are re-evaluated to within this fraction of the target
+// precision, as in bounds initialization
+#define WS_PRECISION_FACTOR (1e-2)
+
+using namespace std;
+using namespace sla;
+using namespace MatrixUtils;
+
+namespace zmdp {
+
+// returns the index in planes of the plane with the highest value at b,
+// or -1 if no plane applies to b
+static int getBestPlaneIndex(const std::vector<const LBPlane*>& planes,
+			     const belief_vector& b, bool useMaxPlanesMasking)
+{
+  double val, maxVal = -99e+20;
+  int ret = -1;
+  FOR (i, planes.size()) {
+    const LBPlane& p = *planes[i];
+    if (useMaxPlanesMasking && !mask_subset(b, p.mask)) continue;
+    val = inner_prod(p.alpha, b);
+    if (val > maxVal) {
+      maxVal = val;
+      ret = i;
+    }
+  }
+  return ret;
+}
+
+// returns the active plane in candidates with the highest value at b,
+// or the first active one if b is NULL.  returns -1 if no candidate is
+// active.
+static int getBestCandidate(const std::vector<const LBPlane*>& planes,
+			    const std::vector<int>& candidates,
+			    const std::vector<bool>& isActive,
+			    const belief_vector* b)
+{
+  double val, maxVal = -99e+20;
+  int ret = -1;
+  FOR_EACH (ci, candidates) {
+    int j = *ci;
+    if (!isActive[j]) continue;
+    if (NULL == b) return j;
+    val = inner_prod(planes[j]->alpha, *b);
+    if (val > maxVal) {
+      maxVal = val;
+      ret = j;
+    }
+  }
+  return ret;
+}
+
+// sets result to the uniform belief over the states in mask
+static void getUniformBelief(belief_vector& result, const mvector& mask)
+{
+  result.resize(mask.size());
+  FOR (j, mask.filled()) {
+    result.push_back(mask.data[j].index, 1.0 / mask.filled());
+  }
+}
+
+WarmStartInitializer::WarmStartInitializer(const MDP* _pomdp,
+					   const ZMDPConfig* _config) :
+  pomdp((const Pomdp*) _pomdp),
+  config(_config)
+{}
+
+bool WarmStartInitializer::getIsEnabled(const ZMDPConfig* config)
+{
+  return (config->getString("warmStartPolicyFile") != "none"
+	  || config->getString("warmStartUpperBoundFile") != "none");
+}
+
+void WarmStartInitializer::warmStart(BoundPair* bounds, double targetPrecision)
+{
+  string policyFileName = config->getString("warmStartPolicyFile");
+  string upperBoundFileName = config->getString("warmStartUpperBoundFile");
+
+  // solverUtils checks that the bounds have the right representations
+  std::vector<belief_vector> witnesses;
+  if (bounds->maintainUpperBound && upperBoundFileName != "none") {
+    addUpperBoundPoints((SawtoothUpperBound*) bounds->upperBound,
+			upperBoundFileName, witnesses);
+  }
+  if (bounds->maintainLowerBound && policyFileName != "none") {
+    witnesses.push_back(pomdp->getInitialBelief());
+    addPolicyPlanes((MaxPlanesLowerBound*) bounds->lowerBound, policyFileName,
+		    witnesses, WS_PRECISION_FACTOR * targetPrecision);
+  }
+
+  // the root node was created with the initial bounds
+  MDPNode& root = *bounds->getRootNode();
+  if (!root.isTerminal) {
+    bounds->update(root, NULL);
+  }
+  printf("warm start: initial belief bounds [%g .. %g]\n", root.lbVal, root.ubVal);
+}
+
+void WarmStartInitializer::addPolicyPlanes(MaxPlanesLowerBound* bound,
+					   const std::string& policyFileName,
+					   const std::vector<belief_vector>& witnesses,
+					   double targetPrecision)
+{
+  timeval startTime = getTime();
+
+  if (pomdp->getDiscount() >= 1.0 || -1 != pomdp->maxHorizon) {
+    fprintf(stderr, "ERROR: warmStartPolicyFile requires a model with discount < 1 and no maxHorizon\n");
+    exit(EXIT_FAILURE);
+  }
+
+  MaxPlanesLowerBound old(pomdp, config);
+  old.readFromFile(policyFileName);
+  std::vector<const LBPlane*> planes(old.planes.begin(), old.planes.end());
+  int numPlanes = planes.size();
+  FOR (i, numPlanes) {
+    if (planes[i]->action < 0 || planes[i]->action >= pomdp->getNumActions()) {
+      fprintf(stderr, "ERROR: %s: plane has action %d, but the model has %d actions\n",
+	      policyFileName.c_str(), planes[i]->action, pomdp->getNumActions());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // masks[i] is the set of states where plane i applies
+  mvector fullMask;
+  mask_set_all(fullMask, pomdp->numStates);
+  std::vector<const mvector*> masks(numPlanes);
+  FOR (i, numPlanes) {
+    masks[i] = old.useMaxPlanesMasking ? &planes[i]->mask : &fullMask;
+  }
+
+  // choose a witness belief for each plane.  planes that are not the
+  // best plane at any of the given witnesses use the uniform belief over
+  // their masks.
+  std::vector<belief_vector> planeWitness(numPlanes);
+  std::vector<bool> hasWitness(numPlanes, false);
+  FOR_EACH (wi, witnesses) {
+    int i = getBestPlaneIndex(planes, *wi, old.useMaxPlanesMasking);
+    if (-1 != i && !hasWitness[i]) {
+      planeWitness[i] = *wi;
+      hasWitness[i] = true;
+    }
+  }
+  FOR (i, numPlanes) {
+    if (!hasWitness[i]) {
+      getUniformBelief(planeWitness[i], *masks[i]);
+    }
+  }
+
+  // candidates[i][o] lists the planes whose masks cover every state that
+  // can follow a state in plane i's mask after observation o.  if the
+  // next plane is always chosen among the candidates, the values of plane
+  // i inside its mask depend only on values inside other planes' masks,
+  // so entries outside the masks can be ignored.  if o can't follow
+  // plane i, any plane will do and the list holds only i.
+  int numObs = pomdp->getNumObservations();
+  std::vector< std::vector< std::vector<int> > > candidates(numPlanes);
+  obs_prob_vector opv;
+  belief_vector maskBelief, nextBelief;
+  FOR (i, numPlanes) {
+    int a = planes[i]->action;
+    candidates[i].resize(numObs);
+    getUniformBelief(maskBelief, *masks[i]);
+    pomdp->getObsProbVector(opv, maskBelief, a);
+    FOR (o, numObs) {
+      if (0.0 == opv(o)) {
+	candidates[i][o].push_back(i);
+	continue;
+      }
+      pomdp->getNextBelief(nextBelief, maskBelief, a, o);
+      FOR (j, numPlanes) {
+	if (masks[j]->filled() >= nextBelief.filled()
+	    && mask_subset(nextBelief, *masks[j])) {
+	  candidates[i][o].push_back(j);
+	}
+      }
+    }
+  }
+
+  // drop planes that have no candidate for some observation, until the
+  // remaining planes are closed under the choice of next plane
+  std::vector<bool> isActive(numPlanes, true);
+  int numActive = numPlanes;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    FOR (i, numPlanes) {
+      if (!isActive[i]) continue;
+      FOR (o, numObs) {
+	if (-1 == getBestCandidate(planes, candidates[i][o], isActive, NULL)) {
+	  isActive[i] = false;
+	  numActive--;
+	  changed = true;
+	  break;
+	}
+      }
+    }
+  }
+
+  // the controller moves from plane i to plane nextPlane[i][o] after
+  // observation o: the best candidate at the witness's successor belief.
+  // any choice among the candidates keeps the re-evaluated planes sound.
+  std::vector< std::vector<int> > nextPlane(numPlanes);
+  FOR (i, numPlanes) {
+    if (!isActive[i]) continue;
+    int a = planes[i]->action;
+    nextPlane[i].resize(numObs);
+    pomdp->getObsProbVector(opv, planeWitness[i], a);
+    FOR (o, numObs) {
+      const belief_vector* b = NULL;
+      if (opv(o) >= WS_MIN_OBS_PROB) {
+	pomdp->getNextBelief(nextBelief, planeWitness[i], a, o);
+	b = &nextBelief;
+      }
+      nextPlane[i][o] = getBestCandidate(planes, candidates[i][o], isActive, b);
+    }
+  }
+  candidates.clear();
+
+  // start from the old planes.  if one application of the controller's
+  // Bellman operator T lowers some entry of the planes by at most delta,
+  // then T(vals - c) >= vals - c for c = delta/(1-gamma).  iterating T
+  // from there only raises the values, and they converge to the
+  // controller's value from below.  updating in place (Gauss-Seidel)
+  // keeps the same guarantee, since T is monotone.
+  std::vector<dvector> vals(numPlanes);
+  FOR (i, numPlanes) {
+    if (isActive[i]) {
+      copy(vals[i], planes[i]->alpha);
+    }
+  }
+  initObsRows();
+  dvector newVals(pomdp->numStates);
+  double maxDecrease = 0;
+  FOR (i, numPlanes) {
+    if (!isActive[i]) continue;
+    const mvector& mask = *masks[i];
+    getControllerBackup(newVals, mask, planes[i]->action, nextPlane[i], vals);
+    FOR_CV (mask) {
+      int s = CV_INDEX(mask);
+      maxDecrease = std::max(maxDecrease, vals[i](s) - newVals(s));
+    }
+  }
+  double correction = maxDecrease / (1.0 - pomdp->getDiscount());
+  FOR (i, numPlanes) {
+    if (!isActive[i]) continue;
+    const mvector& mask = *masks[i];
+    FOR_CV (mask) {
+      vals[i](CV_INDEX(mask)) -= correction;
+    }
+  }
+
+  double maxResidual;
+  int numIterations = 0;
+  do {
+    maxResidual = 0;
+    FOR (i, numPlanes) {
+      if (!isActive[i]) continue;
+      const mvector& mask = *masks[i];
+      getControllerBackup(newVals, mask, planes[i]->action, nextPlane[i], vals);
+      FOR_CV (mask) {
+	int s = CV_INDEX(mask);
+	maxResidual = std::max(maxResidual, fabs(newVals(s) - vals[i](s)));
+	vals[i](s) = newVals(s);
+      }
+    }
+    numIterations++;
+  } while (maxResidual > targetPrecision);
+
+  mvector emptyMask;
+  FOR (i, numPlanes) {
+    if (!isActive[i]) continue;
+    alpha_vector alpha;
+    mask_copy(alpha, vals[i], *masks[i]);
+    LBPlane* plane = new LBPlane(alpha, planes[i]->action,
+				 bound->useMaxPlanesMasking ? *masks[i] : emptyMask);
+    plane->numBackupsAtCreation = 0;
+    bound->addLBPlane(plane);
+  }
+
+  printf("warm start: re-evaluated %d of %d planes from %s with correction %g (%d iterations, %.3lf seconds)\n",
+	 numActive, numPlanes, policyFileName.c_str(), correction, numIterations,
+	 timevalToSeconds(getTime() - startTime));
+}
+
+// sets the entries of result inside mask to the value of taking action
+// a, then following the plane nextPlane[o] after each observation o,
+// where plane values are vals.  the caller must have built obsRows.
+void WarmStartInitializer::getControllerBackup(dvector& result,
+					       const mvector& mask, int a,
+					       const std::vector<int>& nextPlane,
+					       const std::vector<dvector>& vals)
+{
+  const cmatrix& Ttr = pomdp->Ttr[a];
+  const cmatrix& Orows = obsRows[pomdp->O.getId(a)];
+  FOR_CV (mask) {
+    int s = CV_INDEX(mask);
+    double sum = 0;
+    typeof(Ttr.data.begin()) ti, tend = Ttr.data.begin() + Ttr.col_starts[s+1];
+    for (ti = Ttr.data.begin() + Ttr.col_starts[s]; ti != tend; ti++) {
+      int sp = ti->index;
+      double v = 0;
+      typeof(Orows.data.begin()) oi, oend = Orows.data.begin() + Orows.col_starts[sp+1];
+      for (oi = Orows.data.begin() + Orows.col_starts[sp]; oi != oend; oi++) {
+	v += oi->value * vals[nextPlane[oi->index]](sp);
+      }
+      sum += ti->value * v;
+    }
+    result(s) = pomdp->R(s,a) + pomdp->getDiscount() * sum;
+  }
+}
+
+// builds obsRows, the transposes of the distinct observation matrices,
+// so that the observation probabilities for a state are contiguous
+void WarmStartInitializer::initObsRows(void)
+{
+  obsRows.clear();
+  obsRows.resize(pomdp->O.getNumDistinct());
+  std::vector<bool> isDone(obsRows.size(), false);
+  FOR (a, pomdp->getNumActions()) {
+    int id = pomdp->O.getId(a);
+    if (isDone[id]) continue;
+    const cmatrix& O = pomdp->O[a];
+    kmatrix k(O.size2(), O.size1());
+    FOR (o, O.size2()) {
+      FOR (j, O.filled_in_column(o)) {
+	const cvector_entry& e = O.data[O.col_starts[o] + j];
+	k.push_back(o, e.index, e.value);
+      }
+    }
+    copy(obsRows[id], k);
+    isDone[id] = true;
+  }
+}
+
+// returns the value of b after one backup in the new model, using bound
+// for the value of the successor beliefs
+double WarmStartInitializer::getBackupValue(const SawtoothUpperBound& bound,
+					    const belief_vector& b)
+{
+  if (getIsTerminalBelief(b)) return 0;
+
+  obs_prob_vector opv;
+  belief_vector nextBelief;
+  double maxVal = -99e+20;
+  FOR (a, pomdp->getNumActions()) {
+    pomdp->getObsProbVector(opv, b, a);
+    double val = 0;
+    FOR (o, pomdp->getNumObservations()) {
+      if (0.0 == opv(o)) continue;
+      pomdp->getNextBelief(nextBelief, b, a, o);
+      val += opv(o) * bound.getValue(nextBelief, NULL);
+    }
+    val = inner_prod_column(pomdp->R, a, b) + pomdp->getDiscount() * val;
+    maxVal = std::max(maxVal, val);
+  }
+  return maxVal;
+}
+
+// same test as Pomdp::getIsTerminalState(), which isn't const
+bool WarmStartInitializer::getIsTerminalBelief(const belief_vector& b) const
+{
+  double nonTerminalSum = 0.0;
+  FOR_CV (b) {
+    if (!pomdp->isTerminalState[CV_INDEX(b)]) {
+      nonTerminalSum += CV_VAL(b);
+    }
+  }
+  return (nonTerminalSum < 1e-10);
+}
+
+// Why the correction is sound.  Let U be the old sawtooth bound, H the
+// Bellman operator of the new model, and eps the largest amount by which
+// a backup H U exceeds U at any corner or point of U.  Let c =
+// eps/(1-gamma).  Value iteration V_n+1 = H V_n from a low enough
+// constant V_0 keeps V_n convex, and if V_n <= U + c, then at each
+// corner or point b_i, V_n+1(b_i) <= (H U)(b_i) + gamma c <= v_i + c.
+// Since the sawtooth interpolation of values that lie above a convex
+// function at the points also lies above it, V_n+1 <= U + c, and in the
+// limit V* <= U + c.  So (H U)(b_i) + gamma c, which is at most v_i + c,
+// is a sound value for b_i.
+void WarmStartInitializer::addUpperBoundPoints(SawtoothUpperBound* bound,
+					       const std::string& upperBoundFileName,
+					       std::vector<belief_vector>& points)
+{
+  timeval startTime = getTime();
+
+  SawtoothUpperBound old(pomdp, config);
+  old.readFromFile(upperBoundFileName);
+
+  // back up every corner and point of the old bound once
+  int numStates = pomdp->numStates;
+  dvector cornerVals(numStates);
+  std::vector<double> pointVals;
+  belief_vector corner;
+  double maxResidual = 0;
+  FOR (s, numStates) {
+    corner.resize(numStates);
+    corner.push_back(s, 1.0);
+    cornerVals(s) = getBackupValue(old, corner);
+    maxResidual = std::max(maxResidual, cornerVals(s) - old.cornerPts(s));
+  }
+  FOR_EACH (ptP, old.pts) {
+    const BVPair& pt = **ptP;
+    double val = getBackupValue(old, pt.b);
+    maxResidual = std::max(maxResidual, val - pt.v);
+    pointVals.push_back(val);
+    points.push_back(pt.b);
+  }
+  double gammaCorrection = pomdp->getDiscount() * maxResidual
+    / (1.0 - pomdp->getDiscount());
+
+  // the fresh bound is also sound, so keep the lower of the two values
+  FOR (s, numStates) {
+    bound->cornerPts(s) = std::min(bound->cornerPts(s),
+				   cornerVals(s) + gammaCorrection);
+  }
+  int i = 0;
+  FOR_EACH (ptP, old.pts) {
+    BVPair* bv = new BVPair((*ptP)->b, pointVals[i++] + gammaCorrection);
+    bv->numBackupsAtCreation = bound->core->numBackups;
+    bound->addPoint(bv);
+  }
+  bound->maybePrune(bound->core->numBackups);
+
+  printf("warm start: added %d points from %s with correction %g (%.3lf seconds)\n",
+	 (int) old.pts.size(), upperBoundFileName.c_str(),
+	 maxResidual / (1.0 - pomdp->getDiscount()),
+	 timevalToSeconds(getTime() - startTime));
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
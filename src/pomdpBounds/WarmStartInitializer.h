@@ -0,0 +1,103 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    WarmStartInitializer.h
+ @brief   Reuses the bounds written by an earlier run on a slightly
+          different model to initialize the bounds for a new run.
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCWarmStartInitializer_h
+#define INCWarmStartInitializer_h
+
+#include <string>
+#include <vector>
+
+#include "MatrixUtils.h"
+#include "zmdpConfig.h"
+#include "Pomdp.h"
+#include "MaxPlanesLowerBound.h"
+#include "SawtoothUpperBound.h"
+#include "BoundPair.h"
+
+namespace zmdp {
+
+// Bounds from an earlier run are not valid for a changed model, so
+// nothing read from the old files is used as a bound directly.
+//
+// Lower bound: each plane of the old policy, together with the plane
+// chosen after each observation, defines a finite-state controller.
+// Its value in the new model is computed by iterating the controller's
+// Bellman operator, starting from the old planes lowered by a
+// correction that makes every iterate a lower bound on the controller's
+// value.  The resulting planes are sound however few iterations are
+// run, and few are needed when the model changed only slightly.
+//
+// Upper bound: each corner and point of the old sawtooth bound is backed
+// up once in the new model.  All of the old values are then raised by a
+// single correction that covers the largest amount by which a backup
+// exceeded the old value, which gives a sound bound (see
+// addUpperBoundPoints()).  When the model changed only slightly, the
+// correction is small.
+struct WarmStartInitializer {
+  const Pomdp* pomdp;
+  const ZMDPConfig* config;
+  std::vector<sla::cmatrix> obsRows;
+
+  WarmStartInitializer(const MDP* _pomdp, const ZMDPConfig* _config);
+
+  // returns true if warmStartPolicyFile or warmStartUpperBoundFile is set
+  static bool getIsEnabled(const ZMDPConfig* config);
+
+  // applies the warm start files to bounds, which must already be
+  // initialized.  creates nodes, so call it only once the search
+  // strategy's node handlers are registered.
+  void warmStart(BoundPair* bounds, double targetPrecision);
+
+  // adds the re-evaluated planes of the policy in policyFileName to
+  // bound.  witnesses are beliefs used to choose which plane follows
+  // each plane after each observation; for each old plane, the first
+  // witness at which it is the best plane is used.
+  void addPolicyPlanes(MaxPlanesLowerBound* bound,
+		       const std::string& policyFileName,
+		       const std::vector<belief_vector>& witnesses,
+		       double targetPrecision);
+
+  // lowers bound using the corrected corners and points of the sawtooth
+  // upper bound in upperBoundFileName, and appends the point beliefs to
+  // points
+  void addUpperBoundPoints(SawtoothUpperBound* bound,
+			   const std::string& upperBoundFileName,
+			   std::vector<belief_vector>& points);
+
+  void getControllerBackup(sla::dvector& result, const sla::mvector& mask, int a,
+			   const std::vector<int>& nextPlane,
+			   const std::vector<sla::dvector>& vals);
+  void initObsRows(void);
+  double getBackupValue(const SawtoothUpperBound& bound, const belief_vector& b);
+  bool getIsTerminalBelief(const belief_vector& b) const;
+};
+
+}; // namespace zmdp
+
+#endif /* INCWarmStartInitializer_h */
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
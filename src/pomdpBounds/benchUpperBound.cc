@@ -0,0 +1,262 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    benchUpperBound.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <iostream>
+#include <vector>
+
+#include "MatrixUtils.h"
+#include "zmdpRandom.h"
+#include "Pomdp.h"
+#include "BoundPair.h"
+#include "SawtoothUpperBound.h"
+#include "GridUpperBound.h"
+#include "zmdpMainConfig.h"
+
+#include "zmdpMainConfig.cc" // embed default config file
+
+using namespace std;
+using namespace zmdp;
+
+static double getSeconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// runs RTDP-style trials that follow the upper bound, so that both
+// representations are refined along the same kind of trajectories.
+// visited beliefs are appended to queryBeliefs.
+static double runTrials(BoundPair* bounds, int numTrials, int maxDepth,
+			std::vector<belief_vector>& queryBeliefs)
+{
+  RandomStream rng(/* seedValue = */ 0, ZMDP_RS_SEARCH);
+  std::vector<MDPNode*> path;
+  double startTime = getSeconds();
+
+  FOR (t, numTrials) {
+    path.clear();
+    MDPNode* cn = bounds->getRootNode();
+    FOR (d, maxDepth) {
+      if (cn->isTerminal) break;
+      if (cn->isFringe()) bounds->expand(*cn);
+      int a;
+      bounds->update(*cn, &a);
+      path.push_back(cn);
+      queryBeliefs.push_back(cn->s);
+
+      // sample an outcome
+      MDPQEntry& Qa = cn->Q[a];
+      double r = rng.unitRand();
+      MDPNode* next = NULL;
+      FOR (o, Qa.getNumOutcomes()) {
+	MDPEdge* e = Qa.outcomes[o];
+	if (NULL == e) continue;
+	next = e->nextState;
+	r -= e->obsProb;
+	if (r <= 0) break;
+      }
+      if (NULL == next) break;
+      cn = next;
+    }
+    for (int i = path.size()-1; i >= 0; i--) {
+      bounds->update(*path[i], NULL);
+    }
+  }
+
+  return getSeconds() - startTime;
+}
+
+void doit(const char* modelFileName,
+	  bool useFastModelParser,
+	  int resolution,
+	  int numTrials,
+	  int maxDepth,
+	  int numQueryRounds)
+{
+  MatrixUtils::init_matrix_utils(/* randomSeed = */ 0);
+
+  ZMDPConfig* config = new ZMDPConfig();
+  config->readFromString("<defaultConfig>", defaultConfig.data);
+  config->setBool("useFastModelParser", useFastModelParser);
+  config->setInt("gridUpperBoundResolution", resolution);
+  config->setInt("nodeExpansionThreads", 1);
+
+  printf("reading model\n");
+  Pomdp* pomdp = new Pomdp(modelFileName, config);
+
+  // beliefs visited by the first representation's trials are queried
+  // against both representations
+  std::vector<belief_vector> queryBeliefs;
+
+  printf("%-10s %10s %10s %10s %12s %10s\n",
+	 "bound", "init (s)", "trials (s)", "root ub", "queries/s", "mean ub");
+  FOR (i, 2) {
+    BoundPair* bounds = new BoundPair(/* maintainLowerBound = */ false,
+				      /* maintainUpperBound = */ true,
+				      /* useUpperBoundRunTimeActionSelection = */ true,
+				      /* dualPointBounds = */ false);
+    const char* name;
+    if (0 == i) {
+      SawtoothUpperBound* sub = new SawtoothUpperBound(pomdp, config);
+      sub->core = bounds;
+      bounds->upperBound = sub;
+      name = "sawtooth";
+    } else {
+      GridUpperBound* gub = new GridUpperBound(pomdp, config);
+      gub->core = bounds;
+      bounds->upperBound = gub;
+      name = "grid";
+    }
+
+    double initStartTime = getSeconds();
+    bounds->initialize(pomdp, config);
+    double initTime = getSeconds() - initStartTime;
+
+    std::vector<belief_vector> visited;
+    double trialTime = runTrials(bounds, numTrials, maxDepth, visited);
+    if (queryBeliefs.empty()) queryBeliefs = visited;
+
+    double ubSum = 0;
+    double queryStartTime = getSeconds();
+    FOR (r, numQueryRounds) {
+      FOR_EACH (bi, queryBeliefs) {
+	ubSum += bounds->upperBound->getValue(*bi, NULL);
+      }
+    }
+    double queryTime = getSeconds() - queryStartTime;
+    int numQueries = numQueryRounds * queryBeliefs.size();
+
+    printf("%-10s %10.3f %10.3f %10.4f %12.0f %10.4f\n",
+	   name, initTime, trialTime,
+	   bounds->getRootNode()->ubVal,
+	   numQueries / queryTime,
+	   ubSum / numQueries);
+    printf("%-10s storage: %d elements\n", "",
+	   bounds->upperBound->getStorage(ZMDP_S_NUM_ELTS));
+  }
+}
+
+void usage(const char* binaryName)
+{
+  cerr <<
+    "usage: " << binaryName << " OPTIONS <foo.pomdp>\n"
+    "  -h or --help          Display this help\n"
+    "  -f or --fast          Use fast (but very picky) alternate model parser\n"
+    "  -r or --res <n>       Grid resolution (default 4)\n"
+    "  -n or --trials <n>    Number of search trials (default 200)\n"
+    "  -d or --depth <n>     Maximum depth of each trial (default 20)\n"
+    "  -q or --queries <n>   Number of passes over the query beliefs (default 10)\n"
+    "\n"
+    "Compares the sawtooth and grid upper bound representations.  Each is\n"
+    "refined by the same number of trials that follow the upper bound, then\n"
+    "queried at the beliefs visited by the sawtooth trials.  Reports query\n"
+    "throughput and the mean upper bound over the queries (lower is tighter).\n";
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  static char shortOptions[] = "hfr:n:d:q:";
+  static struct option longOptions[]={
+    {"help",          0,NULL,'h'},
+    {"fast",          0,NULL,'f'},
+    {"res",           1,NULL,'r'},
+    {"trials",        1,NULL,'n'},
+    {"depth",         1,NULL,'d'},
+    {"queries",       1,NULL,'q'},
+    {NULL,0,0,0}
+  };
+
+  bool useFastModelParser = false;
+  int resolution = 4;
+  int numTrials = 200;
+  int maxDepth = 20;
+  int numQueryRounds = 10;
+  while (1) {
+    char optchar = getopt_long(argc,argv,shortOptions,longOptions,NULL);
+    if (optchar == -1) break;
+
+    switch (optchar) {
+    case 'h': // help
+      usage(argv[0]);
+      break;
+
+    case 'f': // fast
+      useFastModelParser = true;
+      break;
+
+    case 'r': // res
+      resolution = atoi(optarg);
+      break;
+
+    case 'n': // trials
+      numTrials = atoi(optarg);
+      break;
+
+    case 'd': // depth
+      maxDepth = atoi(optarg);
+      break;
+
+    case 'q': // queries
+      numQueryRounds = atoi(optarg);
+      break;
+
+    case '?': // unknown option
+    case ':': // option with missing parameter
+      // getopt() prints an informative error message
+      cerr << endl;
+      usage(argv[0]);
+      break;
+    default:
+      abort(); // never reach this point
+    }
+  }
+  if (argc-optind != 1) {
+    cerr << "ERROR: wrong number of arguments (should be 1)" << endl << endl;
+    usage(argv[0]);
+  }
+
+  doit(argv[optind], useFastModelParser, resolution,
+       numTrials, maxDepth, numQueryRounds);
+
+  return 0;
+}
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
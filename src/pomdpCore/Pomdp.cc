@@ -32,6 +32,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <functional>
 
 #include "zmdpCommonDefs.h"
 #include "Pomdp.h"
@@ -41,6 +43,8 @@
 #include "SawtoothUpperBound.h"
 #include "FastParser.h"
 #include "CassandraParser.h"
+#include "ModelReducer.h"
+#include "StateReorderer.h"
 
 using namespace std;
 using namespace MatrixUtils;
@@ -56,15 +60,56 @@ Pomdp::Pomdp(const std::string& fileName,
     parser.readPomdpFromFile(*this, fileName);
   } else {
     CassandraParser parser;
+    parser.numRewardThreads = config->getInt("modelParserThreads");
     parser.readPomdpFromFile(*this, fileName);
   }
 
   maxHorizon = config->getInt("maxHorizon");
 
+  if (config->getBool("reduceModel")) {
+    ModelReducer reducer;
+    reducer.reducePomdp(*this);
+  }
+  StateReorderer reorderer;
+  reorderer.reorderPomdp(*this,
+			 StateReorderer::parseOrdering(config->getString("reorderStates")));
+
+  shareMatrices();
+  if (config->getBool("blockSparseTransitions")) {
+    initBlockTransitions();
+  }
+
+  if (config->getBool("validateCompactStorage")) {
+    validateStorage();
+  }
+
   // belief vectors are the 'state vectors' of the belief-MDP; the
   // dimensionality of these vectors is the number of states in
   // the POMDP
   numStateDimensions = numStates;
+
+  beliefTruncationThreshold = config->getDouble("beliefTruncationThreshold");
+  beliefTruncationMaxEntries = config->getInt("beliefTruncationMaxEntries");
+  if ((beliefTruncationThreshold > 0 || beliefTruncationMaxEntries > 0)
+      && discount >= 1.0) {
+    fprintf(stderr, "ERROR: belief truncation requires discount < 1, in order to bound the resulting error\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // any belief's value is a discounted sum of rewards, each of which
+  // lies between the smallest and largest entries of R (including the
+  // implicit zeros)
+  minBeliefValue = 0.0;
+  maxBeliefValue = 0.0;
+  if (discount < 1.0) {
+    double minReward = 0.0, maxReward = 0.0;
+    FOR (i, R.data.size()) {
+      minReward = std::min(minReward, (double) R.data[i].value);
+      maxReward = std::max(maxReward, (double) R.data[i].value);
+    }
+    minBeliefValue = minReward / (1.0 - discount);
+    maxBeliefValue = maxReward / (1.0 - discount);
+  }
 }
 
 const belief_vector& Pomdp::getInitialBelief(void) const
@@ -102,6 +147,192 @@ belief_vector& Pomdp::getNextBelief(belief_vector& result,
   return result;
 }
 
+// returns T_a' * b.  while ws is caching results for b (see
+// MDPWorkspace), the product is kept in the cache slot of Ttr[a], so
+// it is computed only once for all actions that share Ttr[a].
+const cvector& Pomdp::getPredictedBelief(const belief_vector& b, int a,
+					 MDPWorkspace& ws) const
+{
+  if (&b != ws.cacheState) {
+    multTransition( ws.ctmp, b, a, ws );
+    return ws.ctmp;
+  }
+
+  int t = Ttr.getId(a);
+  if (ws.cache.size() < (unsigned int) Ttr.getNumDistinct()) {
+    ws.cache.resize(Ttr.getNumDistinct());
+    ws.cacheValid.resize(Ttr.getNumDistinct(), false);
+  }
+  if (!ws.cacheValid[t]) {
+    multTransition( ws.cache[t], b, a, ws );
+    ws.cacheValid[t] = true;
+  }
+  return ws.cache[t];
+}
+
+// result = T_a' * b, using the block-sparse copy of Ttr[a] if there is
+// one.  both forms give identical results.
+void Pomdp::multTransition(cvector& result, const belief_vector& b, int a,
+			   MDPWorkspace& ws) const
+{
+  if (!TtrBlocks.empty()) {
+    const bcmatrix& A = TtrBlocks[Ttr.getId(a)];
+    if (A.size1() > 0) {
+      mult( result, A, b, ws.accum );
+      return;
+    }
+  }
+  mult( result, Ttr[a], b, ws.accum );
+}
+
+// a block-sparse copy is kept only if its blocks span several rows and
+// it is substantially smaller than the cmatrix.  mult() visits a block
+// column once per nonzero entry of b, so blocks one row tall save
+// memory but not work, and a marginal gain in size is not worth the
+// overhead of touching the explicit zeros in partly filled blocks.
+void Pomdp::initBlockTransitions(void)
+{
+  unsigned int numBlocked = 0;
+  TtrBlocks.clear();
+  TtrBlocks.resize(Ttr.getNumDistinct());
+  FOR (a, numActions) {
+    int t = Ttr.getId(a);
+    if (TtrBlocks[t].size1() > 0) continue;
+
+    unsigned int bs1, bs2;
+    choose_block_size(bs1, bs2, Ttr[a]);
+    if (bs1 < 2) continue;
+
+    copy(TtrBlocks[t], Ttr[a], bs1, bs2);
+    if (TtrBlocks[t].get_bytes() * 4 > Ttr[a].get_bytes() * 3) {
+      TtrBlocks[t] = bcmatrix();
+      continue;
+    }
+    numBlocked++;
+    if (zmdpDebugLevelG >= 1) {
+      printf("transition matrix %d: %u x %u blocks, %lu -> %lu bytes\n",
+	     t, bs1, bs2, (unsigned long) Ttr[a].get_bytes(),
+	     (unsigned long) TtrBlocks[t].get_bytes());
+    }
+  }
+  if (0 == numBlocked) {
+    TtrBlocks.clear();
+  }
+}
+
+obs_prob_vector& Pomdp::getObsProbVector(obs_prob_vector& result,
+					 const belief_vector& b,
+					 int a, MDPWorkspace& ws) const
+{
+  // result = O_a' * T_a' * b
+  mult( result, getPredictedBelief(b, a, ws), O[a] );
+
+  return result;
+}
+
+belief_vector& Pomdp::getNextBelief(belief_vector& result,
+				    const belief_vector& b,
+				    int a, int o, MDPWorkspace& ws) const
+{
+  // result = O_a(:,o) .* (T_a * b)
+  emult_column( result, O[a], o, getPredictedBelief(b, a, ws) );
+
+  // renormalize
+  result *= (1.0/sum(result));
+
+  return result;
+}
+
+// beliefs are written with the state indices they had before the states
+// were reordered (see StateReorderer)
+const state_vector& Pomdp::getLogState(state_vector& storage,
+				       const state_vector& s)
+{
+  if (stateOrder.empty()) {
+    return s;
+  }
+  std::vector< std::pair<int, double> > entries;
+  FOR_CV (s) {
+    entries.push_back(std::make_pair(stateOrder[CV_INDEX(s)], (double) CV_VAL(s)));
+  }
+  std::sort(entries.begin(), entries.end());
+  storage.resize(s.size());
+  FOR_EACH (ep, entries) {
+    storage.push_back(ep->first, ep->second);
+  }
+  return storage;
+}
+
+int Pomdp::sampleOutcome(const state_vector& b, int a, RandomStream& rng,
+			 MDPWorkspace& ws)
+{
+  getObsProbVector(ws.opv, b, a, ws);
+  return chooseFromDistribution(ws.opv, rng);
+}
+
+// drops entries of s smaller than beliefTruncationThreshold, then all
+// but the beliefTruncationMaxEntries largest entries, and renormalizes.
+// the largest entry is always kept.  if the removed mass is m, the
+// truncated belief's value differs from the original's by at most
+// m*getValueRange().  uses no shared storage, so it is safe to call
+// from multiple threads.
+double Pomdp::truncateState(state_vector& s)
+{
+  if (beliefTruncationThreshold <= 0 && beliefTruncationMaxEntries <= 0) {
+    return 0.0;
+  }
+
+  double cutoff = beliefTruncationThreshold;
+  if (beliefTruncationMaxEntries > 0
+      && (int) s.filled() > beliefTruncationMaxEntries) {
+    std::vector<double> vals(s.filled());
+    FOR (i, s.filled()) {
+      vals[i] = s.data[i].value;
+    }
+    int k = beliefTruncationMaxEntries;
+    std::nth_element(vals.begin(), vals.begin() + (k-1), vals.end(),
+		     std::greater<double>());
+    cutoff = std::max(cutoff, vals[k-1]);
+  }
+
+  double maxVal = 0.0;
+  FOR_CV (s) {
+    maxVal = std::max(maxVal, (double) CV_VAL(s));
+  }
+  cutoff = std::min(cutoff, maxVal);
+
+  // entries equal to the cutoff are kept only while there is room, so
+  // ties don't push the count over beliefTruncationMaxEntries
+  int numAbove = 0;
+  FOR_CV (s) {
+    if (CV_VAL(s) > cutoff) numAbove++;
+  }
+  int numTiesToKeep = (beliefTruncationMaxEntries > 0)
+    ? (beliefTruncationMaxEntries - numAbove) : ((int) s.filled());
+
+  double removedMass = 0.0;
+  int j = 0;
+  FOR (i, s.filled()) {
+    double v = s.data[i].value;
+    bool keep = (v > cutoff);
+    if (v == cutoff && numTiesToKeep > 0) {
+      keep = true;
+      numTiesToKeep--;
+    }
+    if (keep) {
+      s.data[j++] = s.data[i];
+    } else {
+      removedMass += v;
+    }
+  }
+  if (removedMass > 0) {
+    s.data.resize(j);
+    s *= (1.0/(1.0 - removedMass));
+  }
+
+  return removedMass;
+}
+
 double Pomdp::getReward(const belief_vector& b, int a)
 {
   return inner_prod_column( R, a, b );
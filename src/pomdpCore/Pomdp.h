@@ -34,6 +34,19 @@ using namespace sla;
 namespace zmdp {
 
 struct Pomdp : public CassandraModel {
+  // belief truncation parameters, see main/zmdp.config
+  double beliefTruncationThreshold;
+  int beliefTruncationMaxEntries;
+  // bounds on the value of any belief, used to bound the error
+  // introduced by belief truncation and merging (both zero if
+  // discount >= 1)
+  double minBeliefValue, maxBeliefValue;
+  // block-sparse copies of the distinct transition matrices, indexed by
+  // Ttr.getId(a).  an entry is empty if the matrix has no useful block
+  // structure, in which case Ttr[a] is used directly.  see the
+  // blockSparseTransitions config field.
+  std::vector<bcmatrix> TtrBlocks;
+
   Pomdp(const std::string& fileName,
 	const ZMDPConfig* _config);
 
@@ -50,6 +63,15 @@ struct Pomdp : public CassandraModel {
   belief_vector& getNextBelief(belief_vector& result, const belief_vector& b,
 			       int a, int o) const;
 
+  // variants of the above that use ws for temporary storage, so they
+  // do not allocate once ws and result have grown large enough.  while
+  // ws is caching results for b, the product T_a' * b is reused by
+  // later calls for any action with the same transition matrix.
+  obs_prob_vector& getObsProbVector(obs_prob_vector& result, const belief_vector& b,
+				    int a, MDPWorkspace& ws) const;
+  belief_vector& getNextBelief(belief_vector& result, const belief_vector& b,
+			       int a, int o, MDPWorkspace& ws) const;
+
   // returns the expected immediate reward when from belief b action a is selected
   double getReward(const belief_vector& b, int a);
 
@@ -68,11 +90,27 @@ struct Pomdp : public CassandraModel {
   outcome_prob_vector& getOutcomeProbVector(outcome_prob_vector& result, const state_vector& b,
 					    int a)
     { return getObsProbVector(result,b,a); }
+  outcome_prob_vector& getOutcomeProbVector(outcome_prob_vector& result, const state_vector& b,
+					    int a, MDPWorkspace& ws)
+    { return getObsProbVector(result,b,a,ws); }
   state_vector& getNextState(state_vector& result, const state_vector& s,
 			     int a, int o)
     { return getNextBelief(result,s,a,o); }
+  state_vector& getNextState(state_vector& result, const state_vector& s,
+			     int a, int o, MDPWorkspace& ws)
+    { return getNextBelief(result,s,a,o,ws); }
+  int sampleOutcome(const state_vector& s, int a, RandomStream& rng,
+		    MDPWorkspace& ws);
+  double truncateState(state_vector& s);
+  double getValueRange(void) { return maxBeliefValue - minBeliefValue; }
+  const state_vector& getLogState(state_vector& storage, const state_vector& s);
   
 protected:
+  const cvector& getPredictedBelief(const belief_vector& b, int a,
+				    MDPWorkspace& ws) const;
+  void multTransition(cvector& result, const belief_vector& b, int a,
+		      MDPWorkspace& ws) const;
+  void initBlockTransitions(void);
   void readFromFileCassandra(const std::string& fileName);
   void readFromFileFast(const std::string& fileName);
 
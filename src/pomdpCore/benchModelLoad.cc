@@ -0,0 +1,408 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-24 17:52:09 $
+
+ @file    benchModelLoad.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <math.h>
+
+#include <iostream>
+#include <vector>
+
+#include "MatrixUtils.h"
+#include "sla_mask.h"
+#include "ThreadPool.h"
+#include "Pomdp.h"
+#include "zmdpMainConfig.h"
+
+#include "zmdpMainConfig.cc" // embed default config file
+
+using namespace std;
+using namespace zmdp;
+
+struct LoadJob {
+  const char* modelFileName;
+  const ZMDPConfig* config;
+  std::vector<Pomdp*> models;
+};
+
+static double getSeconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static void loadTask(void* data, int taskIndex)
+{
+  LoadJob& job = *((LoadJob*) data);
+  job.models[taskIndex] = new Pomdp(job.modelFileName, job.config);
+}
+
+static bool sameMatrix(const cmatrix& a, const cmatrix& b)
+{
+  if (a.size1() != b.size1() || a.size2() != b.size2()
+      || a.col_starts != b.col_starts || a.data.size() != b.data.size()) {
+    return false;
+  }
+  FOR (i, a.data.size()) {
+    if (a.data[i].index != b.data[i].index
+	|| a.data[i].value != b.data[i].value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool sameModel(const Pomdp& a, const Pomdp& b)
+{
+  if (a.numStates != b.numStates
+      || a.numObservations != b.numObservations
+      || a.getNumActions() != b.getNumActions()
+      || a.discount != b.discount
+      || !sameMatrix(a.R, b.R)) {
+    return false;
+  }
+  FOR (ai, a.getNumActions()) {
+    if (!sameMatrix(a.Ttr[ai], b.Ttr[ai]) || !sameMatrix(a.O[ai], b.O[ai])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// loads numModels copies of the model with the given number of threads,
+// returning the elapsed time.  checks that every copy matches the
+// reference copy.
+static double loadModels(LoadJob& job, int numModels, int numThreads,
+			 const Pomdp& reference)
+{
+  job.models.assign(numModels, NULL);
+
+  double startTime = getSeconds();
+  {
+    ThreadPool pool(numThreads);
+    pool.run(numModels, &loadTask, &job);
+  }
+  double elapsed = getSeconds() - startTime;
+
+  FOR (i, numModels) {
+    if (!sameModel(*job.models[i], reference)) {
+      fprintf(stderr, "ERROR: model copy %d read with %d threads differs from the serially read model\n",
+	      (int) i, numThreads);
+      exit(EXIT_FAILURE);
+    }
+    delete job.models[i];
+  }
+  job.models.clear();
+
+  return elapsed;
+}
+
+// compares the model's single transposed copy of the transition matrix
+// against also storing T[a] (as models used to): memory, and the
+// throughput of computing T[a] * x with each
+static void benchTransitions(const Pomdp& p, int numKernelRounds)
+{
+  std::vector<cmatrix> T(p.getNumActions());
+  size_t TBytes = 0;
+  FOR (a, p.getNumActions()) {
+    kmatrix Tk(p.numStates, p.numStates);
+    FOR (s, p.numStates) {
+      FOR_CM_MINOR (s, p.Ttr[a]) {
+	Tk.push_back(CM_ROW(s, p.Ttr[a]), s, CM_VAL(p.Ttr[a]));
+      }
+    }
+    kmatrix_transpose_in_place(Tk);
+    copy(T[a], Tk);
+    TBytes += T[a].get_bytes();
+  }
+  size_t modelBytes = p.getModelBytes();
+  printf("model storage: %.3f MB (storing T as well would add %.3f MB, %.0f%%)\n",
+	 modelBytes / 1e+6, TBytes / 1e+6, 100.0 * TBytes / modelBytes);
+
+  dvector x(p.numStates);
+  cvector cx;
+  FOR (s, p.numStates) {
+    x(s) = (s % 7) / 7.0;
+  }
+  copy(cx, x);
+
+  dvector y1, y2;
+  double maxDiff = 0;
+  double startTime = getSeconds();
+  FOR (r, numKernelRounds) {
+    FOR (a, p.getNumActions()) {
+      mult_transpose(y1, p.Ttr[a], x);
+    }
+  }
+  double transposeTime = getSeconds() - startTime;
+
+  startTime = getSeconds();
+  FOR (r, numKernelRounds) {
+    FOR (a, p.getNumActions()) {
+      mult(y2, T[a], cx);
+    }
+  }
+  double directTime = getSeconds() - startTime;
+
+  FOR (a, p.getNumActions()) {
+    mult_transpose(y1, p.Ttr[a], x);
+    mult(y2, T[a], cx);
+    FOR (s, p.numStates) {
+      maxDiff = std::max(maxDiff, fabs(y1(s) - y2(s)));
+    }
+  }
+
+  int numMults = numKernelRounds * p.getNumActions();
+  printf("T*x: %.0f/s with mult_transpose(Ttr), %.0f/s with mult(T) (max difference %g)\n",
+	 numMults / transposeTime, numMults / directTime, maxDiff);
+
+  // the masked max-planes backup computes T[a] * x restricted to the
+  // support of a sparse belief b, where x is nonzero only on the
+  // support of a successor of b.  use the initial belief as b.
+  const cvector& b = p.initialBelief;
+  std::vector<cvector> xs(p.getNumActions());
+  FOR (a, p.getNumActions()) {
+    mult(xs[a], p.Ttr[a], b);
+  }
+
+  cvector z1, z2, z3, tmp;
+  startTime = getSeconds();
+  FOR (r, numKernelRounds) {
+    FOR (a, p.getNumActions()) {
+      mask_mult_transpose(z1, p.Ttr[a], xs[a], b);
+    }
+  }
+  double maskedTime = getSeconds() - startTime;
+
+  startTime = getSeconds();
+  FOR (r, numKernelRounds) {
+    FOR (a, p.getNumActions()) {
+      mult_transpose(tmp, p.Ttr[a], xs[a]);
+      mask_copy(z2, tmp, b);
+    }
+  }
+  double unmaskedTime = getSeconds() - startTime;
+
+  startTime = getSeconds();
+  FOR (r, numKernelRounds) {
+    FOR (a, p.getNumActions()) {
+      mult(tmp, T[a], xs[a]);
+      mask_copy(z3, tmp, b);
+    }
+  }
+  double directMaskedTime = getSeconds() - startTime;
+
+  bool same = true;
+  FOR (a, p.getNumActions()) {
+    mask_mult_transpose(z1, p.Ttr[a], xs[a], b);
+    mult(tmp, T[a], xs[a]);
+    mask_copy(z3, tmp, b);
+    same = same && (z1.filled() == z3.filled());
+    FOR (i, std::min(z1.filled(), z3.filled())) {
+      same = same && (z1.data[i].index == z3.data[i].index)
+	&& (z1.data[i].value == z3.data[i].value);
+    }
+  }
+  printf("masked T*x (|b| = %d): %.0f/s with mask_mult_transpose(Ttr), %.0f/s with mult_transpose(Ttr) + mask_copy, %.0f/s with mult(T) + mask_copy (results %s)\n",
+	 (int) b.filled(), numMults / maskedTime, numMults / unmaskedTime,
+	 numMults / directMaskedTime, same ? "identical" : "DIFFER");
+}
+
+// compares Ttr[a] * b using the cmatrix and block-sparse forms of each
+// transition matrix that has a block-sparse form
+static void benchBlockTransitions(const Pomdp& p, int numKernelRounds)
+{
+  if (p.TtrBlocks.empty()) {
+    printf("T'*b: no transition matrices are stored in block-sparse form\n");
+    return;
+  }
+
+  dvector x(p.numStates);
+  cvector b;
+  FOR (s, p.numStates) {
+    x(s) = (s % 7) / 7.0;
+  }
+  copy(b, x);
+
+  sparse_accumulator work;
+  cvector y1, y2;
+  int numMults = 0;
+  double cmatrixTime = 0, bcmatrixTime = 0;
+  bool same = true;
+  FOR (a, p.getNumActions()) {
+    const bcmatrix& A = p.TtrBlocks[p.Ttr.getId(a)];
+    if (0 == A.size1()) continue;
+
+    double startTime = getSeconds();
+    FOR (r, numKernelRounds) {
+      mult(y1, p.Ttr[a], b, work);
+    }
+    cmatrixTime += getSeconds() - startTime;
+
+    startTime = getSeconds();
+    FOR (r, numKernelRounds) {
+      mult(y2, A, b, work);
+    }
+    bcmatrixTime += getSeconds() - startTime;
+
+    numMults += numKernelRounds;
+    same = same && (y1.filled() == y2.filled());
+    FOR (i, std::min(y1.filled(), y2.filled())) {
+      same = same && (y1.data[i].index == y2.data[i].index)
+	&& (y1.data[i].value == y2.data[i].value);
+    }
+  }
+  printf("T'*b: %.0f/s with cmatrix, %.0f/s with bcmatrix (results %s)\n",
+	 numMults / cmatrixTime, numMults / bcmatrixTime,
+	 same ? "identical" : "DIFFER");
+}
+
+void doit(const char* modelFileName,
+	  bool useFastModelParser,
+	  int numModels,
+	  int maxThreads,
+	  int numKernelRounds)
+{
+  MatrixUtils::init_matrix_utils(/* randomSeed = */ 0);
+
+  ZMDPConfig* config = new ZMDPConfig();
+  config->readFromString("<defaultConfig>", defaultConfig.data);
+  config->setBool("useFastModelParser", useFastModelParser);
+  // measure concurrency between models, not within one model
+  config->setInt("modelParserThreads", 1);
+
+  LoadJob job;
+  job.modelFileName = modelFileName;
+  job.config = config;
+
+  Pomdp* reference = new Pomdp(modelFileName, config);
+  benchTransitions(*reference, numKernelRounds);
+  benchBlockTransitions(*reference, numKernelRounds);
+
+  printf("%8s %8s %10s %10s\n", "threads", "models", "time (s)", "speedup");
+  double serialTime = 0;
+  for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    double elapsed = loadModels(job, numModels, numThreads, *reference);
+    if (1 == numThreads) serialTime = elapsed;
+    printf("%8d %8d %10.3f %10.2f\n", numThreads, numModels, elapsed,
+	   serialTime / elapsed);
+  }
+}
+
+void usage(const char* binaryName)
+{
+  cerr <<
+    "usage: " << binaryName << " OPTIONS <foo.pomdp>\n"
+    "  -h or --help          Display this help\n"
+    "  -f or --fast          Use fast (but very picky) alternate model parser\n"
+    "  -m or --models <n>    Number of copies of the model to load (default 8)\n"
+    "  -t or --threads <n>   Maximum number of threads (default: one per processor)\n"
+    "  -k or --kernel <n>    Rounds of the transition kernel benchmark (default 100)\n"
+    "\n"
+    "Reports the memory used by the model and the throughput of computing\n"
+    "T[a] * x from the stored transpose of T[a], compared to a separate copy,\n"
+    "both for a dense x and for the sparse, masked products used in backups.\n"
+    "Then loads several copies of a model at once with 1, 2, 4, ... threads, up to\n"
+    "the maximum, and reports the time taken.  Every copy is checked against a\n"
+    "copy loaded on its own, so the benchmark also tests that the model\n"
+    "parsers can safely run concurrently.\n";
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  static char shortOptions[] = "hfm:t:k:";
+  static struct option longOptions[]={
+    {"help",          0,NULL,'h'},
+    {"fast",          0,NULL,'f'},
+    {"models",        1,NULL,'m'},
+    {"threads",       1,NULL,'t'},
+    {"kernel",        1,NULL,'k'},
+    {NULL,0,0,0}
+  };
+
+  bool useFastModelParser = false;
+  int numModels = 8;
+  int maxThreads = ThreadPool::getNumProcessors();
+  int numKernelRounds = 100;
+  while (1) {
+    char optchar = getopt_long(argc,argv,shortOptions,longOptions,NULL);
+    if (optchar == -1) break;
+
+    switch (optchar) {
+    case 'h': // help
+      usage(argv[0]);
+      break;
+
+    case 'f': // fast
+      useFastModelParser = true;
+      break;
+
+    case 'm': // models
+      numModels = atoi(optarg);
+      break;
+
+    case 't': // threads
+      maxThreads = atoi(optarg);
+      break;
+
+    case 'k': // kernel
+      numKernelRounds = atoi(optarg);
+      break;
+
+    case '?': // unknown option
+    case ':': // option with missing parameter
+      // getopt() prints an informative error message
+      cerr << endl;
+      usage(argv[0]);
+      break;
+    default:
+      abort(); // never reach this point
+    }
+  }
+  if (argc-optind != 1) {
+    cerr << "ERROR: wrong number of arguments (should be 1)" << endl << endl;
+    usage(argv[0]);
+  }
+
+  doit(argv[optind], useFastModelParser, numModels, maxThreads,
+       numKernelRounds);
+
+  return 0;
+}
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,368 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-24 17:52:09 $
+
+ @file    benchStateOrder.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <math.h>
+
+#ifdef __linux__
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <linux/perf_event.h>
+#endif
+
+#include <iostream>
+#include <vector>
+
+#include "MatrixUtils.h"
+#include "Pomdp.h"
+#include "zmdpMainConfig.h"
+
+#include "zmdpMainConfig.cc" // embed default config file
+
+using namespace std;
+using namespace zmdp;
+using namespace MatrixUtils;
+
+static const char* orderingsG[] = { "none", "rcm", "bfs", NULL };
+
+static double getSeconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// counts hardware cache misses of the calling thread between start()
+// and stop(), where the kernel allows it.  stop() returns -1 if the
+// count is not available.
+struct CacheMissCounter {
+  int fd;
+
+  CacheMissCounter(void) {
+    fd = -1;
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+  ~CacheMissCounter(void) {
+    if (-1 != fd) close(fd);
+  }
+
+  void start(void) {
+#ifdef __linux__
+    if (-1 != fd) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+  long long stop(void) {
+    long long count = -1;
+#ifdef __linux__
+    if (-1 != fd) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (sizeof(count) != read(fd, &count, sizeof(count))) {
+	count = -1;
+      }
+    }
+#endif
+    return count;
+  }
+};
+
+// generates beliefs by simulating random actions from the initial belief
+static void sampleBeliefs(std::vector<belief_vector>& beliefs, Pomdp& p,
+			  int numBeliefs, int depth)
+{
+  RandomStream rng(/* seedValue = */ 0, ZMDP_RS_MAIN);
+  MDPWorkspace ws;
+  obs_prob_vector opv;
+  belief_vector b, bp;
+  beliefs.clear();
+  while ((int) beliefs.size() < numBeliefs) {
+    b = p.getInitialBelief();
+    for (int i=0; i < depth && (int) beliefs.size() < numBeliefs; i++) {
+      int a = rng.uniformInt(p.getNumActions());
+      p.getObsProbVector(opv, b, a, ws);
+      int o = chooseFromDistribution(opv, rng);
+      p.getNextBelief(bp, b, a, o, ws);
+      b = bp;
+      beliefs.push_back(b);
+    }
+  }
+}
+
+// translates a belief from the state numbering of the model file into
+// the numbering used by p
+static void toModelOrder(belief_vector& result, const belief_vector& b,
+			 const Pomdp& p)
+{
+  if (p.originalToReducedState.empty()) {
+    result = b;
+    return;
+  }
+  dvector tmp(p.numStates);
+  FOR_CV (b) {
+    tmp(p.originalToReducedState[CV_INDEX(b)]) = CV_VAL(b);
+  }
+  copy(result, tmp);
+}
+
+// returns the mean over beliefs of the distance between the smallest
+// and largest state index in the belief's support
+static double getMeanSpan(const std::vector<belief_vector>& beliefs)
+{
+  double total = 0;
+  FOR (i, beliefs.size()) {
+    const belief_vector& b = beliefs[i];
+    if (b.filled() > 0) {
+      total += b.data.back().index - b.data.front().index;
+    }
+  }
+  return total / beliefs.size();
+}
+
+static void printRate(const char* kernel, int numOps, double elapsed,
+		      long long misses)
+{
+  printf("  %-16s %12.0f/s", kernel, numOps / elapsed);
+  if (-1 == misses) {
+    printf("   cache misses/op n/a\n");
+  } else {
+    printf("   cache misses/op %8.1f\n", ((double) misses) / numOps);
+  }
+}
+
+static void benchOrdering(const char* ordering, const char* modelFileName,
+			  ZMDPConfig* config,
+			  const std::vector<belief_vector>& fileBeliefs,
+			  int numRounds)
+{
+  config->setString("reorderStates", ordering);
+  Pomdp p(modelFileName, config);
+
+  std::vector<belief_vector> beliefs(fileBeliefs.size());
+  FOR (i, fileBeliefs.size()) {
+    toModelOrder(beliefs[i], fileBeliefs[i], p);
+  }
+
+  // use the immediate rewards of each action as alpha vectors, both in
+  // the sparse representation used by the bounds and as dense vectors
+  std::vector<alpha_vector> alphas(p.getNumActions());
+  std::vector<dvector> dalphas(p.getNumActions());
+  FOR (a, p.getNumActions()) {
+    dvector& da = dalphas[a];
+    da.resize(p.numStates);
+    FOR (s, p.numStates) {
+      da(s) = p.R(s, a);
+    }
+    copy(alphas[a], da);
+  }
+
+  printf("reorderStates %s: mean belief index span %.1f\n",
+	 ordering, getMeanSpan(beliefs));
+
+  CacheMissCounter counter;
+  MDPWorkspace ws;
+  obs_prob_vector opv;
+  belief_vector bp;
+  double checkSum = 0;
+
+  // getNextBelief() for every action and observation with nonzero
+  // probability
+  int numOps = 0;
+  counter.start();
+  double startTime = getSeconds();
+  FOR (r, numRounds) {
+    FOR (i, beliefs.size()) {
+      FOR (a, p.getNumActions()) {
+	p.getObsProbVector(opv, beliefs[i], a, ws);
+	FOR (o, opv.size()) {
+	  if (opv(o) > OBS_IS_ZERO_EPS) {
+	    p.getNextBelief(bp, beliefs[i], a, o, ws);
+	    checkSum += bp.filled();
+	    numOps++;
+	  }
+	}
+      }
+    }
+  }
+  double elapsed = getSeconds() - startTime;
+  printRate("getNextBelief", numOps, elapsed, counter.stop());
+
+  numOps = 0;
+  counter.start();
+  startTime = getSeconds();
+  FOR (r, numRounds) {
+    FOR (i, beliefs.size()) {
+      FOR (a, p.getNumActions()) {
+	checkSum += inner_prod(alphas[a], beliefs[i]);
+	numOps++;
+      }
+    }
+  }
+  elapsed = getSeconds() - startTime;
+  printRate("inner_prod", numOps, elapsed, counter.stop());
+
+  numOps = 0;
+  counter.start();
+  startTime = getSeconds();
+  FOR (r, numRounds) {
+    FOR (i, beliefs.size()) {
+      FOR (a, p.getNumActions()) {
+	checkSum += inner_prod(dalphas[a], beliefs[i]);
+	numOps++;
+      }
+    }
+  }
+  elapsed = getSeconds() - startTime;
+  printRate("inner_prod dense", numOps, elapsed, counter.stop());
+
+  // printing the checksum keeps the compiler from dropping the loops
+  printf("  (checksum %g)\n", checkSum);
+}
+
+void doit(const char* modelFileName,
+	  bool useFastModelParser,
+	  int numBeliefs,
+	  int depth,
+	  int numRounds)
+{
+  MatrixUtils::init_matrix_utils(/* randomSeed = */ 0);
+
+  ZMDPConfig* config = new ZMDPConfig();
+  config->readFromString("<defaultConfig>", defaultConfig.data);
+  config->setBool("useFastModelParser", useFastModelParser);
+
+  std::vector<belief_vector> beliefs;
+  {
+    Pomdp p(modelFileName, config);
+    sampleBeliefs(beliefs, p, numBeliefs, depth);
+  }
+
+  for (int i=0; NULL != orderingsG[i]; i++) {
+    benchOrdering(orderingsG[i], modelFileName, config, beliefs, numRounds);
+  }
+}
+
+void usage(const char* binaryName)
+{
+  cerr <<
+    "usage: " << binaryName << " OPTIONS <foo.pomdp>\n"
+    "  -h or --help          Display this help\n"
+    "  -f or --fast          Use fast (but very picky) alternate model parser\n"
+    "  -b or --beliefs <n>   Number of beliefs to sample (default 200)\n"
+    "  -d or --depth <n>     Length of each random walk used to sample (default 20)\n"
+    "  -r or --rounds <n>    Rounds of each kernel benchmark (default 5)\n"
+    "\n"
+    "Samples beliefs by random walks from the initial belief, then loads the\n"
+    "model with each setting of reorderStates and reports the throughput and\n"
+    "cache misses (where the kernel allows counting them) of getNextBelief()\n"
+    "and of inner_prod() between alpha vectors and the beliefs.\n";
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  static char shortOptions[] = "hfb:d:r:";
+  static struct option longOptions[]={
+    {"help",          0,NULL,'h'},
+    {"fast",          0,NULL,'f'},
+    {"beliefs",       1,NULL,'b'},
+    {"depth",         1,NULL,'d'},
+    {"rounds",        1,NULL,'r'},
+    {NULL,0,0,0}
+  };
+
+  bool useFastModelParser = false;
+  int numBeliefs = 200;
+  int depth = 20;
+  int numRounds = 5;
+  while (1) {
+    char optchar = getopt_long(argc,argv,shortOptions,longOptions,NULL);
+    if (optchar == -1) break;
+
+    switch (optchar) {
+    case 'h': // help
+      usage(argv[0]);
+      break;
+
+    case 'f': // fast
+      useFastModelParser = true;
+      break;
+
+    case 'b': // beliefs
+      numBeliefs = atoi(optarg);
+      break;
+
+    case 'd': // depth
+      depth = atoi(optarg);
+      break;
+
+    case 'r': // rounds
+      numRounds = atoi(optarg);
+      break;
+
+    case '?': // unknown option
+    case ':': // option with missing parameter
+      // getopt() prints an informative error message
+      cerr << endl;
+      usage(argv[0]);
+      break;
+    default:
+      abort(); // never reach this point
+    }
+  }
+  if (argc-optind != 1) {
+    cerr << "ERROR: wrong number of arguments (should be 1)" << endl << endl;
+    usage(argv[0]);
+  }
+
+  doit(argv[optind], useFastModelParser, numBeliefs, depth, numRounds);
+
+  return 0;
+}
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
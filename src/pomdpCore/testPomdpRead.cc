@@ -83,10 +83,10 @@ int main(int argc, char *argv[]) {
   cout << endl;
 
   for (a=0; a < p.getNumActions(); a++) {
-    printf("T_%d(s,sp) matrix (%d x %d) =\n", a, p.T[a].size1(), p.T[a].size2());
+    printf("T_%d(s,sp) matrix (%d x %d) =\n", a, p.Ttr[a].size2(), p.Ttr[a].size1());
     for (s=0; s < p.getBeliefSize(); s++) {
       for (sp=0; sp < p.getBeliefSize(); sp++) {
-	printf("%5.3f ", p.T[a](s,sp));
+	printf("%5.3f ", p.Ttr[a](sp,s));
       }
       cout << endl;
     }
@@ -38,6 +38,7 @@
 #include <sstream>
 #include <queue>
 
+#include "zmdpRandom.h"
 #include "REBasicPomdp.h"
 #include "RockExplore.h"
 
@@ -289,7 +290,7 @@ void REBasicPomdp::writeCassandraModel(const std::string& outFile)
 int REBasicPomdp::chooseStochasticOutcome(const REBelief& b)
 {
   // Generate a random floating point value between 0 and 1.
-  double p = ((double) std::rand()) / RAND_MAX;
+  double p = getThreadRandomStream().unitRand();
   
   // Select an outcome based on p.
   for (int i=0; i < (int)b.size(); i++) {
@@ -305,7 +306,7 @@ int REBasicPomdp::chooseStochasticOutcome(const REBelief& b)
 int REBasicPomdp::chooseStochasticOutcome(const REObsProbs& obsProbs)
 {
   // Generate a random floating point value between 0 and 1.
-  double p = ((double) std::rand()) / RAND_MAX;
+  double p = getThreadRandomStream().unitRand();
 
   // Select an outcome based on p.
   for (int o=0; o < (int)obsProbs.size(); o++) {
@@ -277,10 +277,8 @@ void doDisplayMDPPolicy(void)
 }
 
 int main(int argc, char **argv) {
-  // Initialize the random number generator
-  srand(time(0));
-  // Seems the random number generator needs to "clear its throat" on some systems.
-  rand();
+  // Initialize the random number generator (seeded from the time)
+  setRandomSeed(-1);
 
   while (1) {
     printf("\nMain menu\n"
@@ -54,7 +54,7 @@ FRTDP::FRTDP(void)
 void FRTDP::getNodeHandler(MDPNode& cn)
 {
   FRTDPExtraNodeData* searchData = new FRTDPExtraNodeData;
-  cn.searchData = searchData;
+  getSearchData(cn) = searchData;
   double excessWidth = cn.ubVal - cn.lbVal - RT_PRIO_IMPROVEMENT_CONSTANT * targetPrecision;
   searchData->prio = (excessWidth <= 0) ? RT_PRIO_MINUS_INFINITY : log(excessWidth);
 }
@@ -65,9 +65,9 @@ void FRTDP::staticGetNodeHandler(MDPNode& s, void* handlerData)
   x->getNodeHandler(s);
 }
 
-double& FRTDP::getPrio(const MDPNode& cn)
+double& FRTDP::getPrio(const MDPNode& cn) const
 {
-  return ((FRTDPExtraNodeData*) cn.searchData)->prio;
+  return ((FRTDPExtraNodeData*) getSearchData(cn))->prio;
 }
 
 void FRTDP::getMaxPrioOutcome(MDPNode& cn, int a, FRTDPUpdateResult& r) const
@@ -151,7 +151,10 @@ void FRTDP::trialRecurse(MDPNode& cn, double logOcc, int depth)
     oldNumUpdates++;
   }
 
-  if (excessWidth <= 0 || depth > maxDepth) {
+  if (excessWidth <= 0 || depth > maxDepth
+      // with belief truncation, a node's bounds can remain wide after
+      // all of its successors have converged
+      || -1 == r.maxPrioOutcome) {
     if (zmdpDebugLevelG >= 1) {
       printf("  trialRecurse: depth=%d excessWidth=%g (terminating)\n",
 	     depth, excessWidth);
@@ -162,7 +165,6 @@ void FRTDP::trialRecurse(MDPNode& cn, double logOcc, int depth)
   }
 
   // recurse to successor
-  assert(-1 != r.maxPrioOutcome);
   double obsProb = cn.Q[r.maxUBAction].outcomes[r.maxPrioOutcome]->obsProb;
   double weight = problem->getDiscount() * obsProb;
   double nextLogOcc = logOcc + log(weight);
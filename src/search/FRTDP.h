@@ -50,7 +50,7 @@ struct FRTDP : public RTDPCore {
 
   void getNodeHandler(MDPNode& cn);
   static void staticGetNodeHandler(MDPNode& cn, void* handlerData);
-  static double& getPrio(const MDPNode& cn);
+  double& getPrio(const MDPNode& cn) const;
   void getMaxPrioOutcome(MDPNode& cn, int a, FRTDPUpdateResult& result) const;
   void update(MDPNode& cn, FRTDPUpdateResult& result);
   void trialRecurse(MDPNode& cn, double logOcc, int depth);
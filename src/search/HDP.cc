@@ -64,7 +64,7 @@ HDP::HDP(void)
 void HDP::getNodeHandler(MDPNode& cn)
 {
   HDPExtraNodeData* searchData = new HDPExtraNodeData;
-  cn.searchData = searchData;
+  getSearchData(cn) = searchData;
   searchData->isSolved = cn.isTerminal;
   searchData->idx = RT_IDX_PLUS_INFINITY;
   searchData->low = RT_IDX_PLUS_INFINITY;
@@ -76,19 +76,19 @@ void HDP::staticGetNodeHandler(MDPNode& s, void* handlerData)
   x->getNodeHandler(s);
 }
 
-bool& HDP::getIsSolved(const MDPNode& cn)
+bool& HDP::getIsSolved(const MDPNode& cn) const
 {
-  return ((HDPExtraNodeData *) cn.searchData)->isSolved;
+  return ((HDPExtraNodeData *) getSearchData(cn))->isSolved;
 }
 
-int& HDP::getLow(const MDPNode& cn)
+int& HDP::getLow(const MDPNode& cn) const
 {
-  return ((HDPExtraNodeData *) cn.searchData)->low;
+  return ((HDPExtraNodeData *) getSearchData(cn))->low;
 }
 
-int& HDP::getIdx(const MDPNode& cn)
+int& HDP::getIdx(const MDPNode& cn) const
 {
-  return ((HDPExtraNodeData *) cn.searchData)->idx;
+  return ((HDPExtraNodeData *) getSearchData(cn))->idx;
 }
 
 void HDP::cacheQ(MDPNode& cn)
@@ -98,7 +98,7 @@ void HDP::cacheQ(MDPNode& cn)
   bounds->update(cn, NULL);
   trackBackup(cn);
   // keep the changes to Q but undo the change to cn.ubVal
-  cn.ubVal = oldUBVal;
+  bounds->setNodeUBVal(cn, oldUBVal);
 }
 
 // assumes correct Q values are already cached (using cacheQ)
@@ -112,7 +112,7 @@ void HDP::updateInternal(MDPNode& cn)
 {
   cacheQ(cn);
   int maxUBAction = bounds->getMaxUBAction(cn);
-  cn.ubVal = cn.Q[maxUBAction].ubVal;
+  bounds->setNodeUBVal(cn, cn.Q[maxUBAction].ubVal);
 }
 
 bool HDP::trialRecurse(MDPNode& cn, int depth)
@@ -131,12 +131,16 @@ bool HDP::trialRecurse(MDPNode& cn, int depth)
     return false;
   }
 
+  // the depth-first search can cover much of the graph.  returning true
+  // means no state is labeled solved on the way back up.
+  if (getStopRequested()) return true;
+
   // check residual
   cacheQ(cn);
   int maxUBAction = bounds->getMaxUBAction(cn);
   // FIX do not recalculate maxUBAction in residual()
   if (residual(cn) > targetPrecision) {
-    cn.ubVal = cn.Q[maxUBAction].ubVal;
+    bounds->setNodeUBVal(cn, cn.Q[maxUBAction].ubVal);
 
     if (zmdpDebugLevelG >= 1) {
       printf("  trialRecurse: big residual (terminating)\n");
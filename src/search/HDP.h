@@ -42,9 +42,9 @@ struct HDP : public RTDPCore {
 
   void getNodeHandler(MDPNode& cn);
   static void staticGetNodeHandler(MDPNode& cn, void* handlerData);
-  static bool& getIsSolved(const MDPNode& cn);
-  static int& getLow(const MDPNode& cn);
-  static int& getIdx(const MDPNode& cn);
+  bool& getIsSolved(const MDPNode& cn) const;
+  int& getLow(const MDPNode& cn) const;
+  int& getIdx(const MDPNode& cn) const;
 
   void cacheQ(MDPNode& cn);
   double residual(MDPNode& cn);
@@ -62,7 +62,7 @@ LRTDP::LRTDP(void)
 void LRTDP::getNodeHandler(MDPNode& cn)
 {
   LRTDPExtraNodeData* searchData = new LRTDPExtraNodeData;
-  cn.searchData = searchData;
+  getSearchData(cn) = searchData;
   searchData->isSolved = cn.isTerminal;
 }
 
@@ -72,9 +72,9 @@ void LRTDP::staticGetNodeHandler(MDPNode& s, void* handlerData)
   x->getNodeHandler(s);
 }
 
-bool& LRTDP::getIsSolved(const MDPNode& cn)
+bool& LRTDP::getIsSolved(const MDPNode& cn) const
 {
-  return ((LRTDPExtraNodeData *) cn.searchData)->isSolved;
+  return ((LRTDPExtraNodeData *) getSearchData(cn))->isSolved;
 }
 
 void LRTDP::cacheQ(MDPNode& cn)
@@ -84,7 +84,7 @@ void LRTDP::cacheQ(MDPNode& cn)
   bounds->update(cn, NULL);
   trackBackup(cn);
   // keep the changes to Q but undo the change to cn.ubVal
-  cn.ubVal = oldUBVal;
+  bounds->setNodeUBVal(cn, oldUBVal);
 }
 
 // assumes correct Q values are already cached (using cacheQ)
@@ -102,6 +102,11 @@ bool LRTDP::checkSolved(MDPNode& cn)
   
   if (!getIsSolved(cn)) open.push(&cn);
   while (!open.empty()) {
+    if (getStopRequested()) {
+      // the search for unsolved states can cover much of the graph, so
+      // give up without labeling or updating anything
+      return false;
+    }
     MDPNode& n = *open.pop();
     closed.push(&n);
 
@@ -154,7 +159,7 @@ void LRTDP::updateInternal(MDPNode& cn)
 {
   cacheQ(cn);
   int maxUBAction = bounds->getMaxUBAction(cn);
-  cn.ubVal = cn.Q[maxUBAction].ubVal;
+  bounds->setNodeUBVal(cn, cn.Q[maxUBAction].ubVal);
 }
 
 bool LRTDP::trialRecurse(MDPNode& cn, int depth)
@@ -173,7 +178,7 @@ bool LRTDP::trialRecurse(MDPNode& cn, int depth)
   bounds->update(cn, &maxUBAction);
   trackBackup(cn);
 
-  int simulatedOutcome = bounds->getSimulatedOutcome(cn, maxUBAction);
+  int simulatedOutcome = bounds->getSimulatedOutcome(cn, maxUBAction, rng);
 
   if (zmdpDebugLevelG >= 1) {
     printf("  trialRecurse: depth=%d a=%d o=%d ubVal=%g\n",
@@ -36,7 +36,7 @@ struct LRTDP : public RTDPCore {
 
   void getNodeHandler(MDPNode& cn);
   static void staticGetNodeHandler(MDPNode& cn, void* handlerData);
-  static bool& getIsSolved(const MDPNode& cn);
+  bool& getIsSolved(const MDPNode& cn) const;
   void cacheQ(MDPNode& cn);
   double residual(MDPNode& cn);
   bool checkSolved(MDPNode& cn);
@@ -0,0 +1,294 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    PBVI.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include <iostream>
+
+#include "zmdpCommonDefs.h"
+#include "MatrixUtils.h"
+#include "BoundPair.h"
+#include "PBVI.h"
+
+using namespace std;
+using namespace sla;
+using namespace MatrixUtils;
+
+// give up on collecting more beliefs after this many simulation steps
+// per requested belief (the reachable belief set may be small)
+#define PBVI_COLLECT_STEPS_FACTOR (20)
+
+namespace zmdp {
+
+/**********************************************************************
+ * LOCAL HELPER FUNCTIONS
+ **********************************************************************/
+
+// task i computes the backup of batch node i / numActions for action
+// i % numActions.  getNewLBPlaneQ() and getNewUBValueQ() only read the
+// bounds and write data for their own node and action, so all the tasks
+// can run in parallel.
+static void pbviBackupTask(void* taskData, int i)
+{
+  PBVI& x = *((PBVI*) taskData);
+  int numActions = x.problem->getNumActions();
+  MDPNode& cn = *x.batch[i / numActions];
+  int a = i % numActions;
+  x.lowerBound->getNewLBPlaneQ(x.betas[i], cn, a);
+  x.upperBound->getNewUBValueQ(cn, a);
+}
+
+/**********************************************************************
+ * PBVI
+ **********************************************************************/
+
+PBVI::PBVI(void) :
+  lowerBound(NULL),
+  upperBound(NULL),
+  backupPool(NULL),
+  nextPending(0),
+  numRounds(0),
+  numBeliefsSkipped(0)
+{}
+
+PBVI::~PBVI(void)
+{
+  if (NULL != backupPool) {
+    delete backupPool;
+  }
+}
+
+void PBVI::derivedClassInit(void)
+{
+  BoundPair* bp = (BoundPair*) bounds;
+  lowerBound = (MaxPlanesLowerBound*) bp->lowerBound;
+  upperBound = (SawtoothUpperBound*) bp->upperBound;
+
+  batchSize = config->getInt("pbviBatchSize");
+  collectMaxDepth = config->getInt("pbviCollectMaxDepth");
+  if (batchSize < 1 || collectMaxDepth < 1) {
+    fprintf(stderr, "ERROR: pbviBatchSize and pbviCollectMaxDepth must be at least 1\n");
+    exit(EXIT_FAILURE);
+  }
+
+  int numThreads = config->getInt("pbviThreads");
+  if (numThreads <= 0) {
+    numThreads = ThreadPool::getNumProcessors();
+  }
+  if (numThreads > 1 && NULL == backupPool) {
+    backupPool = new ThreadPool(numThreads);
+  }
+
+  beliefSet.clear();
+  inBeliefSet.clear();
+  numRounds = 0;
+  numBeliefsSkipped = 0;
+
+  collectBeliefs(config->getInt("pbviBeliefSetSize"));
+  startRound();
+}
+
+// adds up to numNewBeliefs beliefs to the belief set, found by random
+// walks from the root that choose actions uniformly at random.  the
+// root is always the first belief in the set.
+void PBVI::collectBeliefs(int numNewBeliefs)
+{
+  unsigned int targetSize = beliefSet.size() + std::max(1, numNewBeliefs);
+  int maxSteps = PBVI_COLLECT_STEPS_FACTOR * std::max(1, numNewBeliefs);
+  int numSteps = 0;
+
+  while (beliefSet.size() < targetSize && numSteps < maxSteps) {
+    MDPNode* cn = bounds->getRootNode();
+    FOR (depth, collectMaxDepth) {
+      if (inBeliefSet.end() == inBeliefSet.find(cn)) {
+	beliefSet.push_back(cn);
+	inBeliefSet[cn] = true;
+	if (beliefSet.size() >= targetSize) break;
+      }
+      if (cn->isTerminal) break;
+      if (cn->isFringe()) {
+	bounds->expand(*cn);
+      }
+      numSteps++;
+
+      // sample a successor
+      MDPQEntry& Qa = cn->Q[rng.uniformInt(problem->getNumActions())];
+      double r = rng.unitRand();
+      MDPNode* next = NULL;
+      FOR (o, Qa.getNumOutcomes()) {
+	MDPEdge* e = Qa.outcomes[o];
+	if (NULL == e) continue;
+	next = e->nextState;
+	r -= e->obsProb;
+	if (r <= 0) break;
+      }
+      if (NULL == next) break;
+      cn = next;
+    }
+  }
+
+  if (zmdpDebugLevelG >= 1) {
+    printf("-*- PBVI::collectBeliefs: belief set now has %d beliefs\n",
+	   (int) beliefSet.size());
+  }
+}
+
+// starts a new backup round over the whole belief set in random order
+void PBVI::startRound(void)
+{
+  pending = beliefSet;
+  for (int i = pending.size()-1; i > 0; i--) {
+    std::swap(pending[i], pending[rng.uniformInt(i+1)]);
+  }
+  pendingStartLB.resize(pending.size());
+  FOR (i, pending.size()) {
+    pendingStartLB[i] = pending[i]->lbVal;
+  }
+  nextPending = 0;
+}
+
+// fills the batch with the next pending beliefs whose lower bound has
+// not improved since the round started
+void PBVI::fillBatch(void)
+{
+  batch.clear();
+  while ((int) batch.size() < batchSize && nextPending < (int) pending.size()) {
+    MDPNode* cn = pending[nextPending];
+    double startLB = pendingStartLB[nextPending];
+    nextPending++;
+
+    if (cn->isTerminal) continue;
+    // the root is never skipped, so the upper bound reported for it in
+    // the bounds log is refreshed every round
+    double currentLB = inner_prod(lowerBound->getPlaneForNode(*cn).alpha, cn->s);
+    if (currentLB > startLB + ZMDP_BOUNDS_PRUNE_EPS
+	&& cn != bounds->getRootNode()) {
+      numBeliefsSkipped++;
+      continue;
+    }
+
+    if (cn->isFringe()) {
+      bounds->expand(*cn);
+    }
+    batch.push_back(cn);
+  }
+}
+
+// backs up every node in the batch.  the per-action backups are
+// computed in parallel against the bounds as they were before the
+// batch, then the results are inserted in batch order.
+void PBVI::backupBatch(void)
+{
+  int numActions = problem->getNumActions();
+  betas.resize(batch.size() * numActions);
+  if (NULL != backupPool) {
+    backupPool->run(betas.size(), &pbviBackupTask, this);
+  } else {
+    FOR (i, betas.size()) {
+      pbviBackupTask(this, i);
+    }
+  }
+
+  FOR (j, batch.size()) {
+    MDPNode& cn = *batch[j];
+    double oldLBVal = cn.lbVal;
+    double oldUBVal = cn.ubVal;
+
+    // lower bound: keep the best action's plane, as in
+    // MaxPlanesLowerBound::getNewLBPlane()
+    double val, maxVal = -99e+20;
+    int maxAction = -1;
+    FOR (a, numActions) {
+      val = inner_prod(betas[j*numActions + a].alpha, cn.s);
+      cn.Q[a].lbVal = val;
+      if (val > maxVal) {
+	maxVal = val;
+	maxAction = a;
+      }
+    }
+    LBPlane* newPlane = new LBPlane(betas[j*numActions + maxAction]);
+    // stamp the plane with its insertion time so the maxPlanes cache
+    // sees it as newer than any node updated earlier in the batch
+    newPlane->numBackupsAtCreation = bounds->numBackups;
+    lowerBound->setPlaneForNode(cn, newPlane);
+    lowerBound->addLBPlane(newPlane);
+
+    // upper bound
+    maxVal = -99e+20;
+    FOR (a, numActions) {
+      maxVal = std::max(maxVal, cn.Q[a].ubVal);
+    }
+    upperBound->setUBForNode(cn, maxVal, true);
+
+    if (cn.lbVal != oldLBVal || cn.ubVal != oldUBVal) {
+      cn.boundsVersion++;
+    }
+    bounds->numBackups++;
+    trackBackup(cn);
+  }
+  lowerBound->maybePrune(bounds->numBackups);
+}
+
+bool PBVI::doTrial(MDPNode& cn)
+{
+  if (nextPending >= (int) pending.size()) {
+    numRounds++;
+    collectBeliefs(beliefSet.size());
+    startRound();
+  }
+
+  fillBatch();
+  if (!batch.empty()) {
+    if (zmdpDebugLevelG >= 1) {
+      printf("-*- PBVI::doTrial: round %d, backing up %d beliefs\n",
+	     numRounds+1, (int) batch.size());
+    }
+    backupBatch();
+  }
+
+  numTrials++;
+
+  return (cn.ubVal - cn.lbVal < targetPrecision);
+}
+
+void PBVI::finishLogging(void)
+{
+  RTDPCore::finishLogging();
+  printf("pbvi: %d beliefs in set, %d rounds completed, %d backups skipped because the belief had already improved\n",
+	 (int) beliefSet.size(), numRounds, numBeliefsSkipped);
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
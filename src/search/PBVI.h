@@ -0,0 +1,87 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    PBVI.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+
+#ifndef INCPBVI_h
+#define INCPBVI_h
+
+#include <vector>
+
+#include "RTDPCore.h"
+#include "ThreadPool.h"
+#include "MaxPlanesLowerBound.h"
+#include "SawtoothUpperBound.h"
+
+namespace zmdp {
+
+// point-based batch value iteration.  rather than backing up states
+// along trials, PBVI collects a set of beliefs by simulation and backs
+// up the whole set in rounds.  within a round, beliefs are visited in
+// random order and a belief is skipped if the backups of other beliefs
+// have already improved its lower bound (as in Perseus).  backups are
+// computed in batches spread across a thread pool; the new planes and
+// points are inserted in batch order, so results do not depend on the
+// number of threads.  after each round the belief set is doubled.
+// requires the maxPlanes lower bound and the sawtooth upper bound.
+struct PBVI : public RTDPCore {
+  MaxPlanesLowerBound* lowerBound;
+  SawtoothUpperBound* upperBound;
+  ThreadPool* backupPool;
+  int batchSize;
+  int collectMaxDepth;
+
+  std::vector<MDPNode*> beliefSet;
+  EXT_NAMESPACE::hash_map<MDPNode*, bool> inBeliefSet;
+
+  // the current round
+  std::vector<MDPNode*> pending;
+  std::vector<double> pendingStartLB;
+  int nextPending;
+
+  // the current batch
+  std::vector<MDPNode*> batch;
+  std::vector<LBPlane> betas;
+
+  int numRounds;
+  int numBeliefsSkipped;
+
+  PBVI(void);
+  ~PBVI(void);
+
+  void derivedClassInit(void);
+  void collectBeliefs(int numNewBeliefs);
+  void startRound(void);
+  void fillBatch(void);
+  void backupBatch(void);
+  bool doTrial(MDPNode& cn);
+  void finishLogging(void);
+};
+
+}; // namespace zmdp
+
+#endif /* INCPBVI_h */
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
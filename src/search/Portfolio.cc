@@ -0,0 +1,273 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    Portfolio.cc
+ @brief   Runs several search strategies that share one set of bounds.
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTime.h"
+#include "MatrixUtils.h"
+#include "Portfolio.h"
+
+using namespace std;
+using namespace sla;
+using namespace MatrixUtils;
+
+namespace zmdp {
+
+PortfolioMemberStats::PortfolioMemberStats(void) :
+  numTrials(0),
+  numBackups(0),
+  elapsedSeconds(0),
+  lbGain(0),
+  numLBGains(0),
+  ubGain(0),
+  numUBGains(0),
+  finished(false)
+{}
+
+// the member whose trial the current thread is running, or -1
+static __thread int currentMemberG = -1;
+
+Portfolio::Portfolio(const std::vector<RTDPCore*>& _members,
+		     const std::vector<std::string>& _memberNames) :
+  members(_members),
+  memberNames(_memberNames),
+  stats(_members.size()),
+  memberPool(NULL),
+  roundDone(false),
+  searchDone(false),
+  stopRequested(0),
+  bestRootLB(-99e+20),
+  bestRootUB(99e+20)
+{
+  pthread_rwlockattr_t attr;
+  pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+  // each thread holds the read lock almost all the time, so the default
+  // reader preference would starve threads waiting to apply a backup
+  pthread_rwlockattr_setkind_np(&attr,
+				PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+  pthread_rwlock_init(&boundsLock, &attr);
+  pthread_rwlockattr_destroy(&attr);
+  pthread_mutex_init(&mutex, NULL);
+}
+
+Portfolio::~Portfolio(void)
+{
+  FOR_EACH (memberP, members) {
+    delete *memberP;
+  }
+  if (NULL != memberPool) {
+    delete memberPool;
+    memberPool = NULL;
+  }
+  pthread_rwlock_destroy(&boundsLock);
+  pthread_mutex_destroy(&mutex);
+}
+
+void Portfolio::getNodeHandler(MDPNode& cn)
+{
+  void** slots = new void*[members.size()];
+  FOR (i, members.size()) {
+    slots[i] = NULL;
+  }
+  cn.searchData = slots;
+}
+
+void Portfolio::staticGetNodeHandler(MDPNode& s, void* handlerData)
+{
+  Portfolio* x = (Portfolio*) handlerData;
+  x->getNodeHandler(s);
+}
+
+// called with the write lock held, in the thread that changed the root,
+// so the improvement can be credited to the member running there
+void Portfolio::rootChangeHandler(MDPNode& root)
+{
+  int i = currentMemberG;
+  pthread_mutex_lock(&mutex);
+  if (root.lbVal > bestRootLB) {
+    if (-1 != i) {
+      stats[i].lbGain += root.lbVal - bestRootLB;
+      stats[i].numLBGains++;
+    }
+    bestRootLB = root.lbVal;
+  }
+  if (root.ubVal < bestRootUB) {
+    if (-1 != i) {
+      stats[i].ubGain += bestRootUB - root.ubVal;
+      stats[i].numUBGains++;
+    }
+    bestRootUB = root.ubVal;
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+void Portfolio::staticRootChangeHandler(MDPNode& root, void* handlerData)
+{
+  Portfolio* x = (Portfolio*) handlerData;
+  x->rootChangeHandler(root);
+}
+
+void Portfolio::trackMemberBackup(int memberIndex, const MDPNode& backedUpNode)
+{
+  pthread_mutex_lock(&mutex);
+  stats[memberIndex].numBackups++;
+  if (useLogBackups) {
+    backedUpNodes.push_back(&backedUpNode);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+// the caller holds mutex and the read lock
+bool Portfolio::getIsSearchDone(const MDPNode& root) const
+{
+  if (root.ubVal - root.lbVal < targetPrecision) return true;
+  if (__atomic_load_n(&bounds->numBackups, __ATOMIC_RELAXED) >= terminateNumBackups) {
+    return true;
+  }
+  FOR_EACH (stP, stats) {
+    if (!stP->finished) return false;
+  }
+  return true;
+}
+
+static void portfolioMemberTask(void* taskData, int memberIndex)
+{
+  Portfolio* x = (Portfolio*) taskData;
+  x->runMember(memberIndex);
+}
+
+// runs trials of one member until the round is over
+void Portfolio::runMember(int i)
+{
+  PortfolioMemberStats& st = stats[i];
+  MDPNode& root = *bounds->root;
+
+  currentMemberG = i;
+  pthread_rwlock_rdlock(&boundsLock);
+  while (1) {
+    pthread_mutex_lock(&mutex);
+    bool inTime = (timevalToSeconds(getTime() - roundStartTime) < roundSeconds);
+    bool startTrial = !roundDone && !st.finished
+      && (inTime || numInTimeTrialsRunning > 0);
+    if (startTrial && inTime) numInTimeTrialsRunning++;
+    pthread_mutex_unlock(&mutex);
+    if (!startTrial) break;
+
+    if (zmdpDebugLevelG >= 1) {
+      printf("-*- Portfolio::runMember: running %s\n",
+	     memberNames[i].c_str());
+    }
+    timeval startTime = getTime();
+    bool memberDone = members[i]->doTrial(root);
+    double elapsed = timevalToSeconds(getTime() - startTime);
+
+    pthread_mutex_lock(&mutex);
+    if (inTime) numInTimeTrialsRunning--;
+    st.elapsedSeconds += elapsed;
+    st.numTrials++;
+    numTrials++;
+    if (memberDone) st.finished = true;
+    if (getIsSearchDone(root)) {
+      // stop the other members, interrupting their current trials
+      roundDone = true;
+      searchDone = true;
+      __atomic_store_n(&stopRequested, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+  pthread_rwlock_unlock(&boundsLock);
+  currentMemberG = -1;
+}
+
+bool Portfolio::doTrial(MDPNode& cn)
+{
+  bestRootLB = std::max(bestRootLB, cn.lbVal);
+  bestRootUB = std::min(bestRootUB, cn.ubVal);
+
+  roundStartTime = getTime();
+  numInTimeTrialsRunning = 0;
+  roundDone = false;
+  bounds->sharedLock = &boundsLock;
+  memberPool->run(members.size(), &portfolioMemberTask, this);
+  bounds->sharedLock = NULL;
+
+  return searchDone;
+}
+
+void Portfolio::derivedClassInit(void)
+{
+  if (NULL != bounds->threadPool) {
+    fprintf(stderr, "ERROR: searchStrategy='portfolio' already runs its strategies in parallel, so it requires nodeExpansionThreads=1 (-h for help)\n");
+    exit(EXIT_FAILURE);
+  }
+  roundSeconds = config->getDouble("portfolioRoundSeconds");
+  if (NULL == memberPool) {
+    memberPool = new ThreadPool(members.size());
+  }
+
+  // must be registered before the members' handlers, which fill in
+  // the array allocated here
+  bounds->addGetNodeHandler(&Portfolio::staticGetNodeHandler, this);
+  bounds->setRootChangeHandler(&Portfolio::staticRootChangeHandler, this);
+  FOR (i, members.size()) {
+    members[i]->initPortfolioMember(this, i);
+  }
+}
+
+void Portfolio::finishLogging(void)
+{
+  RTDPCore::finishLogging();
+  printf("portfolio: %-8s %8s %10s %10s %12s %6s %12s %6s\n",
+	 "strategy", "trials", "backups", "seconds",
+	 "lb gain", "(#)", "ub gain", "(#)");
+  FOR (i, members.size()) {
+    const PortfolioMemberStats& st = stats[i];
+    printf("portfolio: %-8s %8d %10d %10.3f %12g %6d %12g %6d%s\n",
+	   memberNames[i].c_str(), st.numTrials, st.numBackups,
+	   st.elapsedSeconds, st.lbGain, st.numLBGains,
+	   st.ubGain, st.numUBGains,
+	   st.finished ? " (done)" : "");
+  }
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,108 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision: 1.1 $  $Author: trey $  $Date: 2007-07-11 15:40:27 $
+
+ @file    Portfolio.h
+ @brief   Runs several search strategies that share one set of bounds.
+
+ Copyright (c) 2007, Trey Smith.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+
+#ifndef INCPortfolio_h
+#define INCPortfolio_h
+
+#include <string>
+#include <vector>
+
+#include "RTDPCore.h"
+
+namespace zmdp {
+
+struct PortfolioMemberStats {
+  int numTrials;
+  int numBackups;
+  double elapsedSeconds;
+  // total improvement of the best root bounds found so far made by this
+  // member's backups, and the number of backups that improved each
+  // bound
+  double lbGain;
+  int numLBGains;
+  double ubGain;
+  int numUBGains;
+  bool finished;
+
+  PortfolioMemberStats(void);
+};
+
+// runs several search strategies concurrently against the same bounds.
+// each call to doTrial() is one round, in which every member that is
+// not done runs trials in its own thread for about
+// portfolioRoundSeconds, so every bound improvement made by one
+// strategy is immediately available to the others.  the threads share
+// the bounds through BoundPairCore::sharedLock.  the search is done
+// when the root bounds are within targetPrecision, or when every member
+// reports that it is done.  each node's search data is an array with
+// one entry per member (see RTDPCore::getSearchData()).
+struct Portfolio : public RTDPCore {
+  std::vector<RTDPCore*> members;
+  std::vector<std::string> memberNames;
+  std::vector<PortfolioMemberStats> stats;
+  ThreadPool* memberPool;
+  double roundSeconds;
+  pthread_rwlock_t boundsLock;
+
+  // mutex protects stats, backedUpNodes, and the fields below
+  pthread_mutex_t mutex;
+  timeval roundStartTime;
+  // trials are only started during the first roundSeconds of a round,
+  // except that while a trial started in that time is still running, the
+  // other members keep going rather than wait for it
+  int numInTimeTrialsRunning;
+  bool roundDone;
+  bool searchDone;
+  // set when searchDone is, and read without holding mutex by members
+  // in the middle of their trials (see RTDPCore::getStopRequested())
+  int stopRequested;
+  // the best root bounds seen so far, used to attribute improvements
+  double bestRootLB;
+  double bestRootUB;
+
+  Portfolio(const std::vector<RTDPCore*>& _members,
+	    const std::vector<std::string>& _memberNames);
+  ~Portfolio(void);
+
+  void getNodeHandler(MDPNode& cn);
+  static void staticGetNodeHandler(MDPNode& cn, void* handlerData);
+  void rootChangeHandler(MDPNode& root);
+  static void staticRootChangeHandler(MDPNode& root, void* handlerData);
+  void trackMemberBackup(int memberIndex, const MDPNode& backedUpNode);
+  bool getIsSearchDone(const MDPNode& root) const;
+  void runMember(int memberIndex);
+
+  bool doTrial(MDPNode& cn);
+  void derivedClassInit(void);
+  void finishLogging(void);
+};
+
+}; // namespace zmdp
+
+#endif /* INCPortfolio_h */
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -76,7 +76,7 @@ void RTDP::trialRecurse(MDPNode& cn, int depth)
   bounds->update(cn, &maxUBAction);
   trackBackup(cn);
 
-  int simulatedOutcome = bounds->getSimulatedOutcome(cn, maxUBAction);
+  int simulatedOutcome = bounds->getSimulatedOutcome(cn, maxUBAction, rng);
 
   if (zmdpDebugLevelG >= 1) {
     printf("  trialRecurse: depth=%d a=%d o=%d ubVal=%g\n",
@@ -37,7 +37,9 @@
 #include "Pomdp.h"
 #include "RTDPCore.h"
 #include "BoundPairCore.h"
+#include "WarmStartInitializer.h"
 #include "StateLog.h"
+#include "Portfolio.h"
 
 using namespace std;
 using namespace sla;
@@ -47,7 +49,9 @@ namespace zmdp {
 
 RTDPCore::RTDPCore(void) :
   boundsFile(NULL),
-  initialized(false)
+  initialized(false),
+  portfolioOwner(NULL),
+  searchDataSlot(-1)
 {}
 
 void RTDPCore::setBounds(BoundPairCore* _bounds)
@@ -78,9 +82,41 @@ void RTDPCore::init(void)
 
   derivedClassInit();
 
+  // warm start nodes are created after derivedClassInit() so that they
+  // get search data from the node handlers
+  if (WarmStartInitializer::getIsEnabled(config)) {
+    WarmStartInitializer wsi(problem, config);
+    wsi.warmStart((BoundPair*) bounds, targetPrecision);
+  }
+
+  initialized = true;
+}
+
+// the owner has already initialized the bounds, so this only sets up
+// the fields the search itself uses
+void RTDPCore::initPortfolioMember(Portfolio* owner, int memberIndex)
+{
+  portfolioOwner = owner;
+  searchDataSlot = memberIndex;
+  problem = owner->problem;
+  config = owner->config;
+  bounds = owner->bounds;
+  targetPrecision = owner->targetPrecision;
+  terminateNumBackups = owner->terminateNumBackups;
+  useLogBackups = false;
+  numTrials = 0;
+  rng.seed(getRandomSeed(), ZMDP_RS_FIRST_PORTFOLIO_MEMBER + memberIndex);
+
+  derivedClassInit();
   initialized = true;
 }
 
+bool RTDPCore::getStopRequested(void) const
+{
+  return (NULL != portfolioOwner)
+    && __atomic_load_n(&portfolioOwner->stopRequested, __ATOMIC_RELAXED);
+}
+
 void RTDPCore::planInit(MDP* _problem,
 			const ZMDPConfig* _config)
 {
@@ -96,11 +132,16 @@ void RTDPCore::planInit(MDP* _problem,
 
   // backup logging setup
   useLogBackups = config->getBool("useLogBackups");
+  useBinaryLogs = config->getBool("useBinaryLogs");
   stateIndexOutputFile = config->getString("stateIndexOutputFile");
   backupsOutputFile = config->getString("backupsOutputFile");
   boundValuesOutputFile = config->getString("boundValuesOutputFile");
   qValuesOutputFile = config->getString("qValuesOutputFile");
 
+  // the search gets its own stream so that its trajectory depends only on
+  // the seed, not on how much randomness other modules have used
+  rng.seed(getRandomSeed(), ZMDP_RS_SEARCH);
+
   if (useTimeWithoutHeuristic) {
     init();
   }
@@ -163,7 +204,9 @@ ValueInterval RTDPCore::getValueAt(const state_vector& s) const
 
 void RTDPCore::trackBackup(const MDPNode& backedUpNode)
 {
-  if (useLogBackups) {
+  if (NULL != portfolioOwner) {
+    portfolioOwner->trackMemberBackup(searchDataSlot, backedUpNode);
+  } else if (useLogBackups) {
     backedUpNodes.push_back(&backedUpNode);
   }
 }
@@ -186,9 +229,9 @@ void RTDPCore::maybeLogBackups(void)
     }
   }
 
-  index.writeToFile(stateIndexOutputFile);
+  index.writeToFile(stateIndexOutputFile, useBinaryLogs);
   if (useLogBackups) {
-    log.writeToFile(backupsOutputFile);
+    log.writeToFile(backupsOutputFile, useBinaryLogs);
     index.writeBoundValuesToFile(boundValuesOutputFile, *bounds);
   }
   if (qValuesOutputFile != "none") {
@@ -199,6 +242,8 @@ void RTDPCore::maybeLogBackups(void)
 void RTDPCore::finishLogging(void)
 {
   maybeLogBackups();
+  bounds->printApproximationStats();
+  bounds->printDirtyTrackingStats();
 }
 
 }; // namespace zmdp
@@ -37,6 +37,7 @@
 
 namespace zmdp {
 
+struct Portfolio;
 
 // data structure used by LRTDP and HDP: stack with O(1) element existence check
 struct NodeStack {
@@ -86,16 +87,38 @@ struct RTDPCore : public Solver {
   int terminateNumBackups;
 
   bool useLogBackups;
+  bool useBinaryLogs;
   std::string stateIndexOutputFile;
   std::string backupsOutputFile;
   std::string boundValuesOutputFile;
   std::string qValuesOutputFile;
   std::vector<const MDPNode*> backedUpNodes;
+  // used by algorithms that simulate trajectories (RTDP, LRTDP)
+  RandomStream rng;
+  // set if this object searches as one member of a Portfolio, which owns
+  // the bounds and the backup log
+  Portfolio* portfolioOwner;
+  // if portfolioOwner is set, the searchData field of each node points
+  // to an array with one entry per member, and this is the index of the
+  // entry for this object.  otherwise -1.
+  int searchDataSlot;
 
   RTDPCore(void);
 
   void setBounds(BoundPairCore* _bounds);
   void init(void);
+  void initPortfolioMember(Portfolio* owner, int memberIndex);
+
+  // returns true if this object is a Portfolio member and the search
+  // has ended, in which case long-running trials should stop early
+  bool getStopRequested(void) const;
+
+  // returns the search data this object keeps for cn
+  void*& getSearchData(const MDPNode& cn) const {
+    MDPNode& n = (MDPNode&) cn;
+    if (-1 == searchDataSlot) return n.searchData;
+    return ((void**) n.searchData)[searchDataSlot];
+  }
 
   // different derived classes (RTDP variants) will implement these
   // in varying ways
@@ -78,28 +78,28 @@ int StateIndex::getStateId(const state_vector& s)
   }
 }
 
-void StateIndex::writeToFile(const std::string& outFile) const
+void StateIndex::writeToFile(const std::string& outFile, bool binary) const
 {
-  std::ofstream out(outFile.c_str());
-  if (!out) {
-    fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
-	    outFile.c_str(), strerror(errno));
-    exit(EXIT_FAILURE);
-  }
-
-  out << "# This file is an index of states (or POMDP beliefs) referenced in other log\n"
-      << "# files.  Each state is given a unique id number in the line of the form\n"
-      << "# 'state <id>'.  (Note that the id numbers are guaranteed to appear in order\n"
-      << "# starting with 0.)  Subsequent lines after each 'state' line specify the\n"
-      << "# state as a sparse vector.  Each line has the form '<index> <value>'\n"
-      << "# specifying one entry of the vector, and entries that do not appear have\n"
-      << "# value 0.\n";
+  if (binary) {
+    BinaryLogWriter out(outFile, BL_STATE_INDEX);
+    FOR_EACH (e, entries) {
+      out.writeState(**e);
+    }
+  } else {
+    std::ofstream out(outFile.c_str());
+    if (!out) {
+      fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
+	      outFile.c_str(), strerror(errno));
+      exit(EXIT_FAILURE);
+    }
 
-  FOR (i, entries.size()) {
-    out << "state " << i << endl;
-    const state_vector& v = *entries[i];
-    FOR_CV (v) {
-      out << CV_INDEX(v) << " " << setprecision(20) << CV_VAL(v) << endl;
+    writeTextLogHeader(out, BL_STATE_INDEX);
+    BinaryLogRecord rec;
+    rec.type = BL_STATE;
+    FOR (i, entries.size()) {
+      rec.stateId = i;
+      rec.state = *entries[i];
+      writeTextLogRecord(out, rec);
     }
   }
 
@@ -110,6 +110,24 @@ void StateIndex::writeToFile(const std::string& outFile) const
 
 void StateIndex::readFromFile(const std::string& inFile)
 {
+  if (BinaryLogReader::isBinaryLog(inFile)) {
+    BinaryLogReader in(inFile);
+    if (BL_STATE_INDEX != in.kind) {
+      fprintf(stderr, "ERROR: %s is not a state index\n", inFile.c_str());
+      exit(EXIT_FAILURE);
+    }
+    entries.clear();
+    lookup.clear();
+    BinaryLogRecord rec;
+    while (in.next(rec)) {
+      getStateId(rec.state);
+    }
+    if (zmdpDebugLevelG >= 1) {
+      printf("read index of %d states from %s\n", (int)entries.size(), inFile.c_str());
+    }
+    return;
+  }
+
   std::ifstream in(inFile.c_str());
   if (!in) {
     fprintf(stderr, "ERROR: couldn't open %s for reading: %s\n",
@@ -234,22 +252,25 @@ void StateLog::addState(const state_vector& s)
   entries.push_back(index->getStateId(s));
 }
 
-void StateLog::writeToFile(const std::string& outFile) const
+void StateLog::writeToFile(const std::string& outFile, bool binary) const
 {
-  std::ofstream out(outFile.c_str());
-  if (!out) {
-    fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
-	    outFile.c_str(), strerror(errno));
-    exit(EXIT_FAILURE);
-  }
-
-  out << "# This file is a log of backups.  All backups performed by the heuristic\n"
-      << "# search algorithm appear in order.  The line for a backup gives the\n"
-      << "# index number of the backed up state; these index numbers reference states\n"
-      << "# listed in the state index file.\n";
+  if (binary) {
+    BinaryLogWriter out(outFile, BL_BACKUPS);
+    FOR_EACH (e, entries) {
+      out.writeBackup(*e);
+    }
+  } else {
+    std::ofstream out(outFile.c_str());
+    if (!out) {
+      fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
+	      outFile.c_str(), strerror(errno));
+      exit(EXIT_FAILURE);
+    }
 
-  FOR_EACH (e, entries) {
-    out << (*e) << endl;
+    writeTextLogHeader(out, BL_BACKUPS);
+    FOR_EACH (e, entries) {
+      out << (*e) << endl;
+    }
   }
 
   if (zmdpDebugLevelG >= 1) {
@@ -259,6 +280,23 @@ void StateLog::writeToFile(const std::string& outFile) const
 
 void StateLog::readFromFile(const std::string& inFile)
 {
+  if (BinaryLogReader::isBinaryLog(inFile)) {
+    BinaryLogReader in(inFile);
+    if (BL_BACKUPS != in.kind) {
+      fprintf(stderr, "ERROR: %s is not a backups log\n", inFile.c_str());
+      exit(EXIT_FAILURE);
+    }
+    entries.clear();
+    BinaryLogRecord rec;
+    while (in.next(rec)) {
+      entries.push_back(rec.stateId);
+    }
+    if (zmdpDebugLevelG >= 1) {
+      printf("read log of %d backups from %s\n", (int)entries.size(), inFile.c_str());
+    }
+    return;
+  }
+
   std::ifstream in(inFile.c_str());
   if (!in) {
     fprintf(stderr, "ERROR: couldn't open %s for reading: %s\n",
@@ -30,6 +30,7 @@
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTypes.h"
 #include "BoundPairCore.h"
+#include "BinaryLog.h"
 
 using namespace sla;
 
@@ -43,7 +44,9 @@ struct StateIndex {
   StateIndex(int _numStateDimensions);
   ~StateIndex(void);
   int getStateId(const state_vector& s);
-  void writeToFile(const std::string& outFile) const;
+  // writes the index in text form, or in binary form (see BinaryLog.h)
+  // if binary is set.  readFromFile() accepts either form.
+  void writeToFile(const std::string& outFile, bool binary = false) const;
   void readFromFile(const std::string& inFile);
 
   void writeBoundValuesToFile(const std::string& outFile,
@@ -59,7 +62,8 @@ struct StateLog {
 
   StateLog(StateIndex* _index);
   void addState(const state_vector& s);
-  void writeToFile(const std::string& outFile) const;
+  // as with StateIndex, readFromFile() accepts either form
+  void writeToFile(const std::string& outFile, bool binary = false) const;
 
   void readFromFile(const std::string& inFile);
   size_t size(void) const { return entries.size(); }